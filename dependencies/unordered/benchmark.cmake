@@ -0,0 +1,10 @@
+# https://github.com/google/benchmark
+# for benchmarking
+
+CPMAddPackage(NAME benchmark
+	GITHUB_REPOSITORY google/benchmark
+	VERSION 1.8.3
+	OPTIONS "BENCHMARK_ENABLE_TESTING OFF" "BENCHMARK_ENABLE_INSTALL OFF" "BENCHMARK_INSTALL_DOCS OFF"
+	EXCLUDE_FROM_ALL TRUE
+	SYSTEM TRUE
+)
@@ -22,6 +22,13 @@ install(TARGETS
 # Package sample application executable
 install(FILES $<TARGET_FILE:app-console> DESTINATION bin)
 
+# Package tool executables
+install(PROGRAMS $<TARGET_FILE:log-decode> DESTINATION bin)
+if(UNIX)
+	install(PROGRAMS $<TARGET_FILE:log-query> DESTINATION bin)
+	install(PROGRAMS $<TARGET_FILE:log-tail> DESTINATION bin)
+endif()
+
 # Redistribute dependency headers
 install(DIRECTORY "${CPM_PACKAGE_cxxopts_SOURCE_DIR}/include/" DESTINATION include FILES_MATCHING PATTERN "*.h*")
 install(DIRECTORY "${CPM_PACKAGE_fmt_SOURCE_DIR}/include/" DESTINATION include)
@@ -45,6 +52,8 @@ endif()
 
 # Generate & install project config file
 string(JOIN "\n" file_content
+	"include(CMakeFindDependencyMacro)"
+	"find_dependency(Threads)  # for static builds of the project library"
 	"include(\"\${CMAKE_CURRENT_LIST_DIR}/${export_name}-targets.cmake\")"
 	"")  # Empty line
 
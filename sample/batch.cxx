@@ -0,0 +1,379 @@
+#include "batch.hxx"
+
+#include <algorithm>  // for std::max
+#include <charconv>  // for std::from_chars
+#include <chrono>
+#include <exception>  // for std::terminate
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>  // for std::pair, std::swap
+
+#include <project.hxx>
+
+using namespace project;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Record
+{
+	std::uint64_t sequence {0};
+	bool end {false};  // no records follow in this lane
+	bool keep {true};
+	std::string line;
+	std::vector<std::pair<std::size_t, std::size_t>> fields;  // offset & size in line; not views, as lines move
+	std::string text;  // as emitted
+};
+
+using Queue = SpscRing<Record>;
+
+struct StageStats
+{
+	std::uint64_t records {0};
+	std::uint64_t kept {0};  // passed on to the next stage
+	Clock::duration busy {0};  // not counting waits on queues
+};
+
+struct QueueStats
+{
+	std::uint64_t pushes {0};
+	std::uint64_t depth {0};  // sum of the depth after each push
+	std::size_t max_depth {0};
+	std::uint64_t full {0};  // pushes which had to wait
+};
+
+/// One worker thread with its two queues, from the reader and to the emitter.
+struct Lane
+{
+	explicit Lane(std::size_t const capacity)
+	    : in {capacity}
+	    , out {capacity}
+	{}
+
+	Queue in;
+	Queue out;
+	QueueStats in_stats;  // written by the reader
+	QueueStats out_stats;  // written by the worker
+	StageStats parse;
+	StageStats transform;
+	StageStats filter;
+};
+
+/// Call \p attempt until it succeeds, yielding, then sleeping, between tries. Return the time spent waiting.
+template <typename F>
+auto until(F&& attempt) -> Clock::duration
+{
+	if (attempt()) {
+		return Clock::duration::zero();
+	}
+
+	auto const started {Clock::now()};
+	for (unsigned tries {0}; !attempt(); ++tries) {
+		if (tries < 64) {
+			std::this_thread::yield();
+		}
+		else {
+			std::this_thread::sleep_for(std::chrono::microseconds {50});
+		}
+	}
+	return Clock::now() - started;
+}
+
+/// Swap \p record into \p queue, waiting while it is full. Return the time spent waiting.
+auto push(Queue& queue, QueueStats& stats, Record& record) -> Clock::duration
+{
+	auto const waited {until([&] { return queue.try_push_with([&](Record& slot) { std::swap(slot, record); }); })};
+
+	auto const depth {queue.size()};
+	++stats.pushes;
+	stats.depth += depth;
+	stats.max_depth = std::max(stats.max_depth, depth);
+	stats.full += waited > Clock::duration::zero();
+	return waited;
+}
+
+/// Swap the oldest record in \p queue into \p record, waiting while it is empty. Return the time spent waiting.
+auto pop(Queue& queue, Record& record) -> Clock::duration
+{
+	return until([&] { return queue.try_pop_with([&](Record& slot) { std::swap(slot, record); }); });
+}
+
+void parse(Record& record, char const delimiter)
+{
+	record.fields.clear();
+	std::size_t begin {0};
+	for (auto end {record.line.find(delimiter)}; end != std::string::npos; end = record.line.find(delimiter, begin)) {
+		record.fields.emplace_back(begin, end - begin);
+		begin = end + 1;
+	}
+	record.fields.emplace_back(begin, record.line.size() - begin);
+}
+
+void transform(Record& record, BatchOptions const& options)
+{
+	if (options.fields.empty()) {
+		record.text.assign(record.line);
+		return;
+	}
+
+	record.text.clear();
+	for (std::size_t i {0}; i < options.fields.size(); ++i) {
+		if (i > 0) {
+			record.text += options.delimiter;
+		}
+		auto const field {options.fields[i] - 1};
+		if (field < record.fields.size()) {
+			auto const [offset, size] {record.fields[field]};
+			record.text.append(record.line, offset, size);
+		}
+	}
+}
+
+auto filter(Record const& record, BatchOptions const& options) -> bool
+{
+	return options.grep.empty() || record.text.find(options.grep) != std::string::npos;
+}
+
+/// Time the call of \p stage, from \p started, and count the record as passed on; return when it ended.
+template <typename F>
+auto timed(StageStats& stats, Clock::time_point const started, F&& stage) -> Clock::time_point
+{
+	stage();
+	auto const ended {Clock::now()};
+	++stats.records;
+	++stats.kept;
+	stats.busy += ended - started;
+	return ended;
+}
+
+void work(Lane& lane, BatchOptions const& options)
+{
+	trace::Scope const scope {"batch.worker"};
+	Record record;
+
+	for (;;) {
+		pop(lane.in, record);
+		if (record.end) {
+			push(lane.out, lane.out_stats, record);
+			return;
+		}
+
+		auto at {Clock::now()};
+		at = timed(lane.parse, at, [&] { parse(record, options.delimiter); });
+		at = timed(lane.transform, at, [&] { transform(record, options); });
+		timed(lane.filter, at, [&] { record.keep = filter(record, options); });
+		if (!record.keep) {
+			--lane.filter.kept;
+		}
+
+		PROJECT_LOG_CATEGORY_DEBUG("batch", "record", log::kv("sequence", record.sequence),
+		                           log::kv("fields", record.fields.size()), log::kv("kept", record.keep));
+
+		push(lane.out, lane.out_stats, record);
+	}
+}
+
+/// Write the kept records in sequence, taking them from the lanes in turn.
+auto emit(std::vector<std::unique_ptr<Lane>>& lanes, std::FILE* out) -> StageStats
+{
+	trace::Scope const scope {"batch.emit"};
+	StageStats stats;
+	Clock::duration waited {0};
+	auto const started {Clock::now()};
+	Record record;
+
+	for (std::uint64_t next {0};; ++next) {
+		waited += pop(lanes[next % lanes.size()]->out, record);
+		if (record.end) {
+			break;
+		}
+		if (record.sequence != next) {
+			std::terminate();  // lanes are first-in, first-out: cannot happen
+		}
+
+		++stats.records;
+		if (record.keep) {
+			std::fwrite(record.text.data(), 1, record.text.size(), out);
+			std::fputc('\n', out);
+			++stats.kept;
+		}
+	}
+
+	std::fflush(out);
+	stats.busy = Clock::now() - started - waited;
+	return stats;
+}
+
+/// Deal the lines of \p in to the lanes in turn, then an end marker to each.
+auto read(std::FILE* in, std::vector<std::unique_ptr<Lane>>& lanes) -> StageStats
+{
+	trace::Scope const scope {"batch.read"};
+	StageStats stats;
+	Clock::duration waited {0};
+	auto const started {Clock::now()};
+	Record record;
+	std::string partial;  // a line split across reads
+
+	auto const deal {[&](std::string_view line) {
+		if (!line.empty() && line.back() == '\r') {
+			line.remove_suffix(1);
+		}
+		auto& lane {*lanes[stats.records % lanes.size()]};
+		record.sequence = stats.records++;
+		record.line.assign(line);
+		waited += push(lane.in, lane.in_stats, record);
+	}};
+
+	char buffer[1 << 16];
+	while (auto const size {std::fread(buffer, 1, sizeof buffer, in)}) {
+		std::string_view rest {buffer, size};
+		for (auto end {rest.find('\n')}; end != std::string_view::npos; end = rest.find('\n')) {
+			if (partial.empty()) {
+				deal(rest.substr(0, end));
+			}
+			else {
+				partial.append(rest.substr(0, end));
+				deal(partial);
+				partial.clear();
+			}
+			rest.remove_prefix(end + 1);
+		}
+		partial.append(rest);
+	}
+	if (!partial.empty()) {
+		deal(partial);
+	}
+
+	for (auto& lane : lanes) {
+		record.end = true;
+		waited += push(lane->in, lane->in_stats, record);
+	}
+
+	stats.kept = stats.records;
+	stats.busy = Clock::now() - started - waited;
+	return stats;
+}
+
+auto microseconds(Clock::duration const duration) -> std::uint64_t
+{
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+
+/// \p records per second of \p duration, or zero if it is too short to tell.
+auto rate(std::uint64_t const records, Clock::duration const duration) -> std::uint64_t
+{
+	auto const seconds {std::chrono::duration<double> {duration}.count()};
+	return seconds > 0 ? static_cast<std::uint64_t>(static_cast<double>(records) / seconds) : 0;
+}
+
+void report_stage(std::string_view const stage, StageStats const& stats)
+{
+	PROJECT_LOG_CATEGORY_INFO("batch", "stage", log::kv("stage", stage), log::kv("records", stats.records),
+	                          log::kv("kept", stats.kept), log::kv("busy_us", microseconds(stats.busy)),
+	                          log::kv("records_per_s", rate(stats.records, stats.busy)));
+}
+
+void report_queues(std::string_view const queues, std::size_t const capacity, QueueStats const& stats)
+{
+	auto const mean {stats.pushes ? (stats.depth + stats.pushes / 2) / stats.pushes : 0};
+
+	PROJECT_LOG_CATEGORY_INFO("batch", "queues", log::kv("queues", queues), log::kv("capacity", capacity),
+	                          log::kv("pushes", stats.pushes), log::kv("mean_depth", mean),
+	                          log::kv("max_depth", stats.max_depth), log::kv("full_waits", stats.full));
+}
+
+/// Sum \p from into \p into, for stages and queues run by several lanes.
+void add(StageStats& into, StageStats const& from)
+{
+	into.records += from.records;
+	into.kept += from.kept;
+	into.busy += from.busy;
+}
+
+void add(QueueStats& into, QueueStats const& from)
+{
+	into.pushes += from.pushes;
+	into.depth += from.depth;
+	into.max_depth = std::max(into.max_depth, from.max_depth);
+	into.full += from.full;
+}
+
+}  // namespace
+
+auto run_batch(std::FILE* in, std::FILE* out, BatchOptions const& options) -> std::uint64_t
+{
+	auto const workers {options.workers ? options.workers : std::max(1u, std::thread::hardware_concurrency())};
+	auto const started {Clock::now()};
+
+	std::vector<std::unique_ptr<Lane>> lanes;
+	for (unsigned i {0}; i < workers; ++i) {
+		lanes.push_back(std::make_unique<Lane>(options.queue));
+	}
+
+	std::vector<std::thread> threads;
+	for (auto& lane : lanes) {
+		threads.emplace_back([&lane = *lane, &options] { work(lane, options); });
+	}
+
+	StageStats emitted;
+	std::thread emitter {[&] { emitted = emit(lanes, out); }};
+
+	auto const read_stats {read(in, lanes)};
+
+	emitter.join();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	auto const elapsed {Clock::now() - started};
+
+	StageStats parsed;
+	StageStats transformed;
+	StageStats filtered;
+	QueueStats dealt;
+	QueueStats collected;
+	for (auto const& lane : lanes) {
+		add(parsed, lane->parse);
+		add(transformed, lane->transform);
+		add(filtered, lane->filter);
+		add(dealt, lane->in_stats);
+		add(collected, lane->out_stats);
+	}
+
+	report_stage("read", read_stats);
+	report_stage("parse", parsed);
+	report_stage("transform", transformed);
+	report_stage("filter", filtered);
+	report_stage("emit", emitted);
+	report_queues("read->worker", lanes.front()->in.capacity(), dealt);
+	report_queues("worker->emit", lanes.front()->out.capacity(), collected);
+
+	PROJECT_LOG_CATEGORY_INFO("batch", "done", log::kv("records", read_stats.records), log::kv("written", emitted.kept),
+	                          log::kv("workers", workers), log::kv("elapsed_us", microseconds(elapsed)),
+	                          log::kv("records_per_s", rate(read_stats.records, elapsed)));
+
+	return emitted.kept;
+}
+
+auto parse_field_list(std::string_view list) -> std::vector<std::size_t>
+{
+	std::vector<std::size_t> result;
+
+	while (!list.empty()) {
+		auto const comma {std::min(list.find(','), list.size())};
+		auto const item {list.substr(0, comma)};
+		std::size_t field {0};
+
+		auto const [end, error] {std::from_chars(item.data(), item.data() + item.size(), field)};
+		if (error != std::errc {} || end != item.data() + item.size() || field == 0) {
+			throw std::invalid_argument {"invalid field list: expected numbers from 1, separated by commas"};
+		}
+
+		result.push_back(field);
+		list.remove_prefix(std::min(comma + 1, list.size()));
+	}
+
+	return result;
+}
@@ -0,0 +1,41 @@
+#ifndef BATCH_HXX
+#define BATCH_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// How run_batch() processes records.
+struct BatchOptions
+{
+	unsigned workers {0};  ///< Threads running parse, transform and filter. Zero: one per hardware thread.
+	std::size_t queue {1024};  ///< Capacity of each queue between threads.
+	char delimiter {'\t'};  ///< Separates fields, when parsed and when emitted.
+	std::vector<std::size_t> fields;  ///< Transform: keep these fields, counted from 1, in this order. Empty: all.
+	std::string grep;  ///< Filter: keep records which contain this once transformed. Empty: all.
+};
+
+/** @brief Stream the lines of \p in through a pipeline of stages to \p out, in order.
+@code
+read ─┬─> [parse → transform → filter] ─┬─> emit
+      └─> [parse → transform → filter] ─┘       one lane per worker thread
+@endcode
+    The reader deals records to the workers in turn, numbering them; the
+    emitter collects them in the same turn, checking the numbers, so output
+    keeps input order. Every hop is a bounded SpscRing: a thread which finds
+    its next queue full waits, which holds back the stages before it.
+
+    At exit, each stage's throughput and each queue's depth are logged at
+    Info in category "batch"; each record at Debug.
+
+    @return The number of records written.
+ */
+auto run_batch(std::FILE* in, std::FILE* out, BatchOptions const& options) -> std::uint64_t;
+
+/// Parse a list of field numbers as for BatchOptions::fields, e.g. "3,1". Throw std::invalid_argument if invalid.
+auto parse_field_list(std::string_view list) -> std::vector<std::size_t>;
+
+#endif  // BATCH_HXX
@@ -6,28 +6,130 @@
 #include <project.hxx>
 
 Cli::Cli(int const argc, char const* argv[])
-    : Cli {argv[0]}
 {
-	parse(argc, argv);
+	if (!parse_fast(argc, argv)) {
+		_values = {};
+		parse(argc, argv);
+	}
+
+	// If user provides --help: print version number & help text, then exit without error.
+	if (_values[Help]) {
+		std::cout << "Project " << project::version() << '\n';
+		std::cout << options(argv[0]).help() << std::endl;
+		std::exit(0);
+	}
+
+	// If user provides --version: print version number, then exit without error.
+	if (_values[Version]) {
+		std::cout << "Project " << project::version() << std::endl;
+		std::exit(0);
+	}
 }
 
-Cli::Cli(char const* argv_0)
-    : _program_name {}
-    , _options {basename(argv_0), "My example application using my library\n"}
-    , _result {}
+auto Cli::parse_fast(int const argc, char const* argv[]) -> bool
 {
-	_options.set_width(80);
+	for (int i {1}; i < argc; ++i) {
+		std::string_view const argument {argv[i]};
+		std::string_view name;
+		std::optional<std::string_view> value;
+		Spec const* spec {nullptr};
+
+		if (argument.size() > 2 && argument.substr(0, 2) == "--") {
+			name = argument.substr(2);
+			if (auto const equals {name.find('=')}; equals != std::string_view::npos) {
+				value = name.substr(equals + 1);
+				name = name.substr(0, equals);
+			}
+		}
+		else if (argument.size() == 2 && argument[0] == '-') {
+			name = argument.substr(1);
+		}
+
+		for (auto const& candidate : Specs) {
+			if (name == candidate.long_name || (name.size() == 1 && name[0] == candidate.short_name)) {
+				spec = &candidate;
+				break;
+			}
+		}
+
+		if (!spec || _values[spec->option]) {
+			return false;  // unknown, positional or repeated
+		}
+		if (!spec->takes_value) {
+			if (value) {
+				return false;
+			}
+			value = argument;  // a flag holds its own spelling
+		}
+		else if (!value && i + 1 < argc && (argv[i + 1][0] != '-' || argv[i + 1][1] == '\0')) {
+			value = argv[++i];  // the next argument, unless it looks like an option; "-" alone is a value
+		}
+
+		if (!value || value->empty()) {
+			return false;
+		}
+		_values[spec->option] = value;
+	}
+
+	return true;
+}
+
+void Cli::parse(int const argc, char const* argv[])
+{
+	auto parser {options(argv[0])};
+	cxxopts::ParseResult result {};
+
+	try {
+		result = parser.parse(argc, argv);
+	} catch (cxxopts::exceptions::parsing const& e) {
+		// If user provides invalid options: print help text, then exit with error.
+		// Since this is an error condition, print to stderr.
+		std::cerr << "Error parsing options:\n\t" << e.what() << "\n\n";
+		std::cerr << parser.help() << std::endl;
+		std::exit(1);
+	}
+
+	for (auto const& spec : Specs) {
+		std::string const name {spec.long_name};
+		if (result.count(name)) {
+			_owned[spec.option] = spec.takes_value ? result[name].as<std::string>() : name;
+			_values[spec.option] = _owned[spec.option];
+		}
+	}
+}
+
+auto Cli::options(char const* argv_0) -> cxxopts::Options
+{
+	cxxopts::Options options {basename(argv_0), "My example application using my library\n"};
+	options.set_width(80);
 
 	// clang-format off
-	_options.add_options()
+	options.add_options()
 		("h,help", "Print usage")
 		("v,version", "Print version")
+		("trace-out", "Trace the run, then write a timeline for Perfetto or chrome://tracing to FILE",
+			cxxopts::value<std::string>(), "FILE")
 #if ENABLE_LOGGING
 		("l,log-level", "Set log level. LEVEL=error|warning|info|debug|trace",
 			cxxopts::value<std::string>()->default_value("none"), "LEVEL")
+		("log-config", "Apply the level spec in FILE, and again when it changes or on SIGHUP",
+			cxxopts::value<std::string>(), "FILE")
 #endif
 		;  // terminate add_options()
+
+	// Values are all strings, as parse() copies them out as such; main() converts them.
+	options.add_options("Batch")
+		("batch", "Stream the lines of FILE, or of standard input if \"-\", through parse, transform, filter "
+			"and emit stages on worker threads, then exit", cxxopts::value<std::string>(), "FILE")
+		("workers", "Worker threads, one per CPU by default", cxxopts::value<std::string>(), "N")
+		("queue", "Records each queue between threads holds (default 1024)", cxxopts::value<std::string>(), "N")
+		("d,delimiter", "Field separator, one character or \\t (default)", cxxopts::value<std::string>(), "C")
+		("f,fields", "Transform: keep fields in LIST, from 1, e.g. 3,1", cxxopts::value<std::string>(), "LIST")
+		("grep", "Filter: keep records which contain TEXT once transformed", cxxopts::value<std::string>(), "TEXT")
+		;  // terminate add_options()
 	// clang-format on
+
+	return options;
 }
 
 auto Cli::basename(char const* argv_0) -> char const*
@@ -37,44 +139,47 @@ auto Cli::basename(char const* argv_0) -> char const*
 	return _program_name.c_str();
 }
 
-void Cli::parse(int const argc, char const* argv[])
+auto Cli::log_level() const -> std::optional<std::string_view>
 {
-	cxxopts::ParseResult result {};
+	return _values[LogLevel];
+}
 
-	try {
-		result = _options.parse(argc, argv);
-	} catch (cxxopts::exceptions::parsing const& e) {
-		// If user provides invalid options: print help text, then exit with error.
-		// Since this is an error condition, print to stderr.
-		std::cerr << "Error parsing options:\n\t" << e.what() << "\n\n";
-		std::cerr << _options.help() << std::endl;
-		std::exit(1);
-	}
+auto Cli::log_config() const -> std::optional<std::string_view>
+{
+	return _values[LogConfig];
+}
 
-	auto const version_string {"Project " + std::string {project::version()}};
+auto Cli::trace_out() const -> std::optional<std::string_view>
+{
+	return _values[TraceOut];
+}
 
-	// If user provides --help: print version number & help text, then exit without error.
-	if (result.count("help")) {
-		std::cout << version_string << '\n';
-		std::cout << _options.help() << std::endl;
-		std::exit(0);
-	}
+auto Cli::batch() const -> std::optional<std::string_view>
+{
+	return _values[Batch];
+}
 
-	// If user provides --version: print version number, then exit without error.
-	if (result.count("version")) {
-		std::cout << version_string << std::endl;
-		std::exit(0);
-	}
+auto Cli::workers() const -> std::optional<std::string_view>
+{
+	return _values[Workers];
+}
 
-	_result = result;
+auto Cli::queue() const -> std::optional<std::string_view>
+{
+	return _values[Queue];
 }
 
-auto Cli::log_level() const -> std::optional<std::string>
+auto Cli::delimiter() const -> std::optional<std::string_view>
 {
-	if (_result.count("log-level")) {
-		return _result["log-level"].as<std::string>();
-	}
-	else {
-		return std::nullopt;
-	}
+	return _values[Delimiter];
+}
+
+auto Cli::fields() const -> std::optional<std::string_view>
+{
+	return _values[Fields];
+}
+
+auto Cli::grep() const -> std::optional<std::string_view>
+{
+	return _values[Grep];
 }
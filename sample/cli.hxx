@@ -1,8 +1,11 @@
 #ifndef CLI_HXX
 #define CLI_HXX
 
+#include <array>
+#include <cstddef>
 #include <optional>
 #include <string>
+#include <string_view>
 
 #include <cxxopts.hpp>
 
@@ -15,22 +18,82 @@ public:
 	    @li invalid options: print error message & help text, then exit with error.
 	    @li @c --help : print version number & help text, then exit without error.
 	    @li @c --version : print version number, then exit without error.
+
+	    Options spelled as in the table below, each given at most once, are
+	    found in place without allocating; values view @p argv. Anything else
+	    (grouped short options, positional arguments...) is parsed by cxxopts,
+	    which also reports errors and prints help.
 	 */
 	Cli(int argc, char const* argv[]);
 
-	auto log_level() const -> std::optional<std::string>;
+	Cli(Cli const&) = delete;  // values may view strings it owns
+	auto operator=(Cli const&) -> Cli& = delete;
+
+	auto log_level() const -> std::optional<std::string_view>;
+	auto log_config() const -> std::optional<std::string_view>;
+	auto trace_out() const -> std::optional<std::string_view>;
+
+	auto batch() const -> std::optional<std::string_view>;
+	auto workers() const -> std::optional<std::string_view>;
+	auto queue() const -> std::optional<std::string_view>;
+	auto delimiter() const -> std::optional<std::string_view>;
+	auto fields() const -> std::optional<std::string_view>;
+	auto grep() const -> std::optional<std::string_view>;
 
 private:
-	explicit Cli(char const* argv_0);
+	enum Option : std::size_t
+	{
+		Help,
+		Version,
+		TraceOut,
+		Batch,
+		Workers,
+		Queue,
+		Delimiter,
+		Fields,
+		Grep,
+		LogLevel,
+		LogConfig,
+		OptionCount,
+	};
+
+	struct Spec
+	{
+		Option option;
+		char short_name;  // '\0' if none
+		std::string_view long_name;
+		bool takes_value;
+	};
+
+	// Keep in step with options().
+	static Spec constexpr Specs[] {
+	    {Help, 'h', "help", false},
+	    {Version, 'v', "version", false},
+	    {TraceOut, '\0', "trace-out", true},
+	    {Batch, '\0', "batch", true},
+	    {Workers, '\0', "workers", true},
+	    {Queue, '\0', "queue", true},
+	    {Delimiter, 'd', "delimiter", true},
+	    {Fields, 'f', "fields", true},
+	    {Grep, '\0', "grep", true},
+#if ENABLE_LOGGING
+	    {LogLevel, 'l', "log-level", true},
+	    {LogConfig, '\0', "log-config", true},
+#endif
+	};
+
+	/// Parse the common cases described above; false if cxxopts must.
+	auto parse_fast(int argc, char const* argv[]) -> bool;
 
 	void parse(int argc, char const* argv[]);
 
-	auto basename(char const* argv_0) -> char const*;
+	auto options(char const* argv_0) -> cxxopts::Options;
 
-	std::string _program_name;  // Must initialize before `_options`
+	auto basename(char const* argv_0) -> char const*;
 
-	cxxopts::Options _options;
-	cxxopts::ParseResult _result;
+	std::array<std::optional<std::string_view>, OptionCount> _values {};
+	std::array<std::string, OptionCount> _owned;  // values copied out of cxxopts
+	std::string _program_name;
 };
 
 #endif  // CLI_HXX
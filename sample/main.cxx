@@ -1,30 +1,59 @@
 #define _CRT_SECURE_NO_WARNINGS 1
+#include <cerrno>
+#include <cstdio>  // for std::fopen
 #include <cstdlib>  // for std::getenv
+#include <cstring>  // for std::strerror
 #undef _CRT_SECURE_NO_WARNINGS
 
+#include <charconv>  // for std::from_chars
+#include <exception>
 #include <iostream>
 #include <optional>
 #include <string>
+#include <stdexcept>
+#include <string_view>
 
+#include <batch.hxx>
 #include <cli.hxx>
 #include <project.hxx>
 
 using namespace project;
 
 namespace {
-void set_log_level(std::optional<std::string> const& cli_level = std::nullopt);
-auto get_env_var(char const* name) -> std::optional<std::string>;
+void set_log_level(std::optional<std::string_view> cli_level = std::nullopt);
+auto get_env_var(char const* name) -> std::optional<std::string_view>;
+auto batch(Cli const& cli, std::string_view input) -> int;
 }  // namespace
 
 int main(int const argc, char const* argv[])
 {
 	Cli const cli {argc, argv};  // May call std::exit(); see Cli constructor documentation.
 
+	if (auto const path {cli.trace_out()}) {
+		trace::start();
+		trace::write_at_exit(std::string {path.value()});
+	}
+	trace::Scope const scope {"main"};
+
 #if ENABLE_LOGGING
 	set_log_level(cli.log_level());
+#ifndef _WIN32
+	if (auto const path {cli.log_config()}) {
+		try {
+			log::start_reload({std::string {path.value()}});
+		} catch (std::exception const& e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+	}
+#endif
 	log::print_enabled_levels();
 #endif
 
+	if (auto const input {cli.batch()}) {
+		return batch(cli, input.value());
+	}
+
 	std::cout << "Welcome!" << std::endl;
 
 	return 0;
@@ -32,7 +61,7 @@ int main(int const argc, char const* argv[])
 
 namespace {
 
-void set_log_level(std::optional<std::string> const& cli_level)
+void set_log_level(std::optional<std::string_view> const cli_level)
 {
 	log::Level level {log::Level::None};
 
@@ -47,10 +76,71 @@ void set_log_level(std::optional<std::string> const& cli_level)
 	log::set_level(level);
 }
 
-auto get_env_var(char const* name) -> std::optional<std::string>
+auto get_env_var(char const* name) -> std::optional<std::string_view>
 {
 	char const* value {std::getenv(name)};
-	return value ? std::make_optional(value) : std::nullopt;
+	return value ? std::make_optional<std::string_view>(value) : std::nullopt;
+}
+
+/// Parse \p text as a positive number for \p option. Throw std::invalid_argument if it is not one.
+template <typename T>
+auto positive(std::string_view const text, char const* option) -> T
+{
+	T value {0};
+	auto const [end, error] {std::from_chars(text.data(), text.data() + text.size(), value)};
+	if (error != std::errc {} || end != text.data() + text.size() || value == 0) {
+		throw std::invalid_argument {std::string {option} + " expects a positive number"};
+	}
+	return value;
+}
+
+/// Run --batch over the lines of \p input, "-" for standard input. Return the exit status.
+auto batch(Cli const& cli, std::string_view const input) -> int
+{
+	BatchOptions options;
+
+	try {
+		if (auto const workers {cli.workers()}) {
+			options.workers = positive<unsigned>(workers.value(), "--workers");
+		}
+		if (auto const queue {cli.queue()}) {
+			options.queue = positive<std::size_t>(queue.value(), "--queue");
+		}
+		if (auto const delimiter {cli.delimiter()}) {
+			if (delimiter.value() == "\\t") {
+				options.delimiter = '\t';
+			}
+			else if (delimiter->size() == 1) {
+				options.delimiter = delimiter->front();
+			}
+			else {
+				throw std::invalid_argument {"--delimiter expects one character"};
+			}
+		}
+		if (auto const fields {cli.fields()}) {
+			options.fields = parse_field_list(fields.value());
+		}
+		if (auto const grep {cli.grep()}) {
+			options.grep = grep.value();
+		}
+	} catch (std::invalid_argument const& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	std::string const path {input};
+	std::FILE* in {input == "-" ? stdin : std::fopen(path.c_str(), "rb")};
+	if (!in) {
+		std::cerr << "cannot read " << path << ": " << std::strerror(errno) << std::endl;
+		return 1;
+	}
+
+	run_batch(in, stdout, options);
+
+	if (in != stdin) {
+		std::fclose(in);
+	}
+	return 0;
 }
 
 }  // namespace
@@ -12,6 +12,9 @@ target_sources(${target}  # parent scope defines ${target}
 	PRIVATE
 		${source_dir}/main.cxx
 
+		${source_dir}/batch.cxx
+		${source_dir}/batch.hxx
+
 		${source_dir}/cli.cxx
 		${source_dir}/cli.hxx
 )
@@ -7,6 +7,23 @@
 
 // Include all public headers
 #include <log.hxx>
+#include <log_async.hxx>
+#include <log_binary.hxx>
+#include <log_category.hxx>
+#include <log_compress.hxx>
+#include <log_crash.hxx>
+#include <log_fd.hxx>
+#include <log_fields.hxx>
+#include <log_index.hxx>
+#include <log_limit.hxx>
+#include <log_mapped.hxx>
+#include <log_pattern.hxx>
+#include <log_reload.hxx>
+#include <log_shm.hxx>
+#include <log_sink.hxx>
+#include <metrics.hxx>
+#include <spsc_ring.hxx>
+#include <trace.hxx>
 #include <version.h>
 
 namespace project {
@@ -1,65 +1,130 @@
 #include "log.hxx"
+#include "log_async.hxx"
+#include "log_category.hxx"
+#include "log_pattern.hxx"
+#include "log_sink.hxx"
 
 #include <algorithm>
-#include <cctype>
 #include <cstdio>
-#include <iterator>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace project::log {
 
 namespace detail {
-Level LogLevel {Level::Info};
-std::FILE* LogTarget {stderr};  // https://en.cppreference.com/w/cpp/io/c/FILE
-}  // namespace detail
+std::atomic<Level> LogLevel {Level::Info};
+std::atomic<Level> GlobalLevel {Level::Info};
+std::atomic<std::FILE*> LogTarget {stderr};  // https://en.cppreference.com/w/cpp/io/c/FILE
 
-auto level_from(std::string_view const level) -> Level
+namespace {
+// One buffer per nesting level of Line; a formatter may log while its own message is being formatted.
+struct LineBuffers
 {
-	std::string level_lowercase;
-	std::transform(level.begin(), level.end(), std::back_inserter(level_lowercase), [](unsigned char const c) {
-		return static_cast<char>(std::tolower(c));
-	});
+	~LineBuffers()
+	{
+		destroyed = true;
+	}
 
-	auto result {Level::None};
+	std::vector<std::unique_ptr<fmt::memory_buffer>> buffers;
+	static thread_local bool destroyed;  // as for ThreadBuffer
+};
+thread_local bool LineBuffers::destroyed {false};
+thread_local std::size_t LineDepth {0};
 
-	if (level_lowercase == "trace") {
-		result = Level::Trace;
+auto line_buffer(std::optional<fmt::memory_buffer>& spare) -> fmt::memory_buffer&
+{
+	if (LineBuffers::destroyed) {
+		return spare.emplace();
 	}
-	else if (level_lowercase == "debug") {
-		result = Level::Debug;
+
+	thread_local LineBuffers lines;
+	if (LineDepth == lines.buffers.size()) {
+		lines.buffers.push_back(std::make_unique<fmt::memory_buffer>());
 	}
-	else if (level_lowercase == "info" || level_lowercase == "status") {
-		result = Level::Info;
+	auto& buffer {*lines.buffers[LineDepth++]};
+	buffer.clear();
+	return buffer;
+}
+}  // namespace
+
+Line::Line(Level const level, Site const* site)
+    : _buffer {line_buffer(_spare)}
+    , _level {level}
+    , _site {site}
+    , _timestamp {now()}
+    , _thread {thread_id()}
+    , _pattern {nullptr}
+    , _body {0}
+    , _fields {~std::size_t {0}}  // no fields
+{
+	if (!backend_running() && !current_routes() && current_encoding() == Encoding::Text) {
+		_pattern = &current_pattern();
+		_pattern->format_prefix(_buffer, {level, site, _timestamp, _thread, {}, {}, nullptr});
+		_body = _buffer.size();
 	}
-	else if (level_lowercase == "warning" || level_lowercase == "warn") {
-		result = Level::Warning;
+}
+
+Line::~Line()
+{
+	if (!_spare) {
+		--LineDepth;
+	}
+}
+
+void Line::submit()
+{
+	auto const end {std::min(_fields, _buffer.size())};
+	std::string_view const message {_buffer.data() + _body, end - _body};
+	std::string_view const fields {_buffer.data() + end, _buffer.size() - end};
+
+	Event const event {_level, _site, _timestamp, _thread, message, fields, nullptr};
+
+	if (async_submit(event)) {
+		return;
 	}
-	else if (level_lowercase == "error") {
-		result = Level::Error;
+
+	if (_pattern && !current_routes()) {
+		_pattern->format_suffix(_buffer, event);  // may reallocate; message is not used after this
+		_buffer.push_back('\n');
+		write_target(_buffer.data(), _buffer.size());
+		return;
 	}
 
-	return result;
+	// The backend stopped or the sink changed since the prefix was (or was not) written.
+	deliver(event);
 }
 
+void write_deferred(Level const level, Site const* site, Packed const& packed)
+{
+	Event const event {level, site, now(), thread_id(), {}, {}, &packed};
+
+	if (!async_submit(event)) {
+		deliver(event);
+	}
+}
+}  // namespace detail
+
 void set_level(Level const level)
 {
-	detail::LogLevel = level;
+	detail::set_global_level(level);  // also updates categories which follow the global level
 }
 
 auto get_level() -> Level
 {
-	return detail::LogLevel;
+	return detail::GlobalLevel.load(std::memory_order_relaxed);
 }
 
 void set_target(std::FILE* target)
 {
-	detail::LogTarget = target;
+	detail::LogTarget.store(target, std::memory_order_release);
 }
 
 auto get_target() -> std::FILE*
 {
-	return detail::LogTarget;
+	return detail::LogTarget.load(std::memory_order_acquire);
 }
 
 void print_enabled_levels()
@@ -83,7 +148,7 @@ void print_enabled_levels()
 
 	char const* msg_ptr {levels.data()};
 
-	switch (detail::LogLevel) {
+	switch (std::min(get_level(), MinLevel)) {  // levels below the compiled floor are never printed
 	case Level::Error:   levels[error_end]   = '\0'; break;
 	case Level::Warning: levels[warning_end] = '\0'; break;
 	case Level::Info:    levels[info_end]    = '\0'; break;
@@ -93,7 +158,7 @@ void print_enabled_levels()
 	}
 	// clang-format on
 
-	fmt::print(detail::LogTarget, "Logging: {}\n", msg_ptr);
+	fmt::print(get_target(), "Logging: {}\n", msg_ptr);
 }
 
 }  // namespace project::log
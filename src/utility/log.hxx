@@ -1,12 +1,20 @@
 #ifndef LOG_HXX
 #define LOG_HXX
 
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
 #include <cstdio>  // for std::FILE
+#include <optional>
+#include <string>
 #include <string_view>
-#include <utility>  // for std::forward
+#include <tuple>
+#include <utility>  // for std::forward, std::index_sequence
 
-#include <fmt/core.h>
+#include <fmt/format.h>  // for fmt::memory_buffer
 
+#include <log_args.hxx>
+#include <log_fields.hxx>
 #include <project_dll-export.h>
 
 namespace project::log {
@@ -33,21 +41,193 @@ enum class Level
 	Trace,
 };
 
+/// Source location of a log call, captured at compile time by the PROJECT_LOG_* macros.
+struct Site
+{
+	char const* file;
+	std::uint32_t line;
+	char const* function;
+	Level level;
+	char const* category {nullptr};  ///< Set by the PROJECT_LOG_CATEGORY_* macros.
+};
+
+class Pattern;
+
+namespace detail {
+// Read on every log call; relaxed loads keep that cheap while making set_level()/set_target() race-free.
+// LogLevel is the global level clipped to the levels some sink accepts, so one compare rejects
+// a message no output wants.
+DLL extern std::atomic<Level> LogLevel;
+DLL extern std::atomic<std::FILE*> LogTarget;
+
+/** @brief Thread-local buffer which one message is formatted into, then delivered from.
+
+    While text goes to the log target, the whole line (see set_pattern()) is
+    formatted into the same buffer and written with one call; otherwise the
+    message alone is handed on. Either way nothing is allocated once the
+    buffer has grown to fit. A message logged while formatting another, e.g.
+    from a formatter, gets a buffer of its own.
+ */
+class DLL Line
+{
+public:
+	Line(Level level, Site const* site);
+	~Line();
+
+	Line(Line const&) = delete;
+	auto operator=(Line const&) -> Line& = delete;
+
+	auto out() -> fmt::appender
+	{
+		return fmt::appender {_buffer};
+	}
+
+	/// End the message; what is appended to the returned buffer from now on is its fields.
+	auto fields() -> fmt::memory_buffer&
+	{
+		_fields = _buffer.size();
+		return _buffer;
+	}
+
+	/// Deliver the message to the backend if it is running, else to the sink or log target.
+	void submit();
+
+private:
+	std::optional<fmt::memory_buffer> _spare;  // used once the thread's buffers are destroyed, at exit
+	fmt::memory_buffer& _buffer;
+	Level _level;
+	Site const* _site;
+	std::uint64_t _timestamp;
+	std::uint32_t _thread;
+	Pattern const* _pattern;  // set if the prefix was written
+	std::size_t _body;  // offset of the message, after any prefix
+	std::size_t _fields;  // offset of the fields, if any, after the message
+};
+
+/// True while captured arguments are preferred to formatted messages; see detail::update_deferral().
+DLL extern std::atomic<bool> DeferFormatting;
+
+/// Deliver a message whose arguments were captured instead of formatted.
+DLL void write_deferred(Level level, Site const* site, Packed const& packed);
+
+template <typename... Args>
+std::size_t constexpr field_count {(std::size_t {is_field_v<Args>} + ... + 0)};
+
+/// True if every Field follows every format argument.
+template <typename... Args>
+auto constexpr fields_trail() -> bool
+{
+	bool const is_field[] {is_field_v<Args>..., false};
+	for (auto i {sizeof...(Args) - field_count<Args...>}; i < sizeof...(Args); ++i) {
+		if (!is_field[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/// Format the message from the first arguments of \p args, then encode the rest as fields.
+template <typename Tuple, std::size_t... Format, std::size_t... Fields>
+void emit_fields(Level const level, Site const* site, Tuple const& args, std::index_sequence<Format...>,
+                 std::index_sequence<Fields...>)
+{
+	Line line {level, site};
+	fmt::format_to(line.out(), std::get<Format>(args)...);
+
+	auto& out {line.fields()};
+	auto const encoding {current_encoding()};
+	(append_field(out, std::get<sizeof...(Format) + Fields>(args), encoding), ...);
+
+	line.submit();
+}
+
+/// Format (or capture) and deliver a message which already passed the level checks.
+template <typename... Args>
+void emit(Level const level, Site const* site, Args&&... args)
+{
+	if constexpr (field_count<Args...> > 0) {
+		static_assert(fields_trail<Args...>(), "log fields (kv()) must follow the format arguments");
+		auto constexpr fields {field_count<Args...>};
+		emit_fields(level, site, std::forward_as_tuple(std::forward<Args>(args)...),
+		            std::make_index_sequence<sizeof...(Args) - fields> {}, std::make_index_sequence<fields> {});
+	}
+	else {
+		if constexpr (deferrable<Args...>) {
+			if (DeferFormatting.load(std::memory_order_relaxed)) {
+				Packed packed;
+				if (pack(packed, args...)) {
+					write_deferred(level, site, packed);
+					return;
+				}
+			}
+		}
+		Line line {level, site};
+		fmt::format_to(line.out(), std::forward<Args>(args)...);
+		line.submit();
+	}
+}
+}  // namespace detail
+
 namespace detail {
-DLL extern Level LogLevel;
-DLL extern std::FILE* LogTarget;
+struct LevelName
+{
+	std::string_view name;
+	Level level;
+};
+
+/** @brief Every level name, at (size + 2 * last character) % 8: a perfect hash.
+
+    It ignores ASCII case too, since 2 * ('a' - 'A') is a multiple of 8.
+ */
+LevelName constexpr LevelNames[8] {
+    {"warn", Level::Warning},
+    {"error", Level::Error},
+    {"info", Level::Info},
+    {"debug", Level::Debug},
+    {"status", Level::Info},
+    {"warning", Level::Warning},
+    {"none", Level::None},
+    {"trace", Level::Trace},
+};
+
+/// Level named \p text in any ASCII case, or nothing if it names none.
+auto constexpr parse_level(std::string_view const text) -> std::optional<Level>
+{
+	if (text.empty()) {
+		return std::nullopt;
+	}
+
+	auto const& entry {LevelNames[(text.size() + 2u * static_cast<unsigned char>(text.back())) % 8]};
+	if (text.size() != entry.name.size()) {
+		return std::nullopt;
+	}
+
+	// Names are all lowercase letters, which only a letter of either case matches once 0x20 is set.
+	unsigned mismatch {0};
+	for (std::size_t i {0}; i < text.size(); ++i) {
+		mismatch |= static_cast<unsigned char>(text[i] | 0x20) ^ static_cast<unsigned char>(entry.name[i]);
+	}
+	if (mismatch != 0) {
+		return std::nullopt;
+	}
+	return entry.level;
+}
 }  // namespace detail
 
 /** @brief Convert a string to a logging severity level.
-    @param level Options are: error warning info debug trace.
+    @param level Options are: error warning info debug trace, in any case.
     @return Corresponding Level or Level::None if \p level is invalid or empty.
 
     std::string_view is constructible via e.g. cast from std::string const&
     (std::basic_string::operator basic_string_view())
     or via std::basic_string_view(char const* cstr) etc.
 
+    Needs no allocation: one table lookup, then one comparison.
  */
-DLL auto level_from(std::string_view level) -> Level;
+auto constexpr level_from(std::string_view const level) -> Level
+{
+	return detail::parse_level(level).value_or(Level::None);
+}
 
 /// Convert a logging severity level to a string.
 auto constexpr level_label(Level level) -> std::string_view
@@ -77,13 +257,39 @@ DLL void print_enabled_levels();
 #define ENABLE_LOGGING 0
 #endif
 
-/// Emit a log message.
+#ifndef PROJECT_LOG_MIN_LEVEL
+#define PROJECT_LOG_MIN_LEVEL 5  // Level::Trace
+#endif
+
+/// Least-severe level compiled in. Set by the PROJECT_LOG_MIN_LEVEL CMake cache variable.
+Level constexpr MinLevel {static_cast<Level>(PROJECT_LOG_MIN_LEVEL)};
+
+/// True if messages at \p level are compiled in. Calls at other levels compile to nothing.
+auto constexpr compiled(Level const level) -> bool
+{
+	return ENABLE_LOGGING && level != Level::None && level <= MinLevel;
+}
+
+/// True if messages at \p level pass the global log level.
+inline auto enabled(Level const level) -> bool
+{
+	return detail::LogLevel.load(std::memory_order_relaxed) >= level;
+}
+
+/** @brief Emit a log message: \p args are a format string, its arguments, then any fields (see kv()).
+
+    While formatting is deferred (see AsyncOptions::defer_formatting), a
+    format string given as an array of char const is kept by pointer until
+    the backend formats it, so it must be a string literal, or live as long;
+    its arguments are copied. Give any other format as a std::string_view or
+    std::string: it is then formatted at once.
+ */
 template <typename... Args>
 void print(Level level, Args&&... args)
 {
 #if ENABLE_LOGGING
-	if (detail::LogLevel >= level) {
-		fmt::print(detail::LogTarget, "{}: {}\n", level_label(level), fmt::format(std::forward<Args>(args)...));
+	if (level <= MinLevel && enabled(level)) {
+		detail::emit(level, nullptr, std::forward<Args>(args)...);
 	}
 #else
 	(void) level;
@@ -91,61 +297,109 @@ void print(Level level, Args&&... args)
 #endif
 }
 
+/** @brief Emit a log message from a call site captured by a PROJECT_LOG_* macro.
+
+    The macro has already checked the level, so this does not check it again.
+ */
+template <typename... Args>
+void print(Site const& site, Args&&... args)
+{
+	detail::emit(site.level, &site, std::forward<Args>(args)...);
+}
+
 /// Emit an error message.
 template <typename... Args>
 void error(Args&&... args)
 {
-#if ENABLE_LOGGING
-	print(Level::Error, std::forward<Args>(args)...);
-#else
-	((void) args, ...);
-#endif
+	if constexpr (compiled(Level::Error)) {
+		print(Level::Error, std::forward<Args>(args)...);
+	}
+	else {
+		((void) args, ...);
+	}
 }
 
 /// Emit a warning message.
 template <typename... Args>
 void warning(Args&&... args)
 {
-#if ENABLE_LOGGING
-	print(Level::Warning, std::forward<Args>(args)...);
-#else
-	((void) args, ...);
-#endif
+	if constexpr (compiled(Level::Warning)) {
+		print(Level::Warning, std::forward<Args>(args)...);
+	}
+	else {
+		((void) args, ...);
+	}
 }
 
 /// Emit an informational message.
 template <typename... Args>
 void info(Args&&... args)
 {
-#if ENABLE_LOGGING
-	print(Level::Info, std::forward<Args>(args)...);
-#else
-	((void) args, ...);
-#endif
+	if constexpr (compiled(Level::Info)) {
+		print(Level::Info, std::forward<Args>(args)...);
+	}
+	else {
+		((void) args, ...);
+	}
 }
 
 /// Emit a debugging message.
 template <typename... Args>
 void debug(Args&&... args)
 {
-#if ENABLE_LOGGING
-	print(Level::Debug, std::forward<Args>(args)...);
-#else
-	((void) args, ...);
-#endif
+	if constexpr (compiled(Level::Debug)) {
+		print(Level::Debug, std::forward<Args>(args)...);
+	}
+	else {
+		((void) args, ...);
+	}
 }
 
 /// Emit a trace message.
 template <typename... Args>
 void trace(Args&&... args)
 {
-#if ENABLE_LOGGING
-	print(Level::Trace, std::forward<Args>(args)...);
-#else
-	((void) args, ...);
-#endif
+	if constexpr (compiled(Level::Trace)) {
+		print(Level::Trace, std::forward<Args>(args)...);
+	}
+	else {
+		((void) args, ...);
+	}
 }
 
 }  // namespace project::log
 
+#if defined(__GNUC__) || defined(__clang__)
+#define PROJECT_LOG_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#else
+#define PROJECT_LOG_UNLIKELY(condition) (condition)
+#endif
+
+/** @brief Emit a log message at \p level, evaluating the arguments only if it is enabled.
+
+    Unlike log::debug() etc., no argument expression is evaluated when the
+    level is compiled out or disabled at runtime, e.g.
+    `PROJECT_LOG_DEBUG("{}", expensive_to_string(x));`
+
+    The call site (file, line, function) is captured in a static constant.
+    The format string must be a string literal.
+ */
+#define PROJECT_LOG_AT(level, ...) \
+	do { \
+		if constexpr (::project::log::compiled(level)) { \
+			if (PROJECT_LOG_UNLIKELY(::project::log::enabled(level))) { \
+				static ::project::log::Site constexpr project_log_site {__FILE__, __LINE__, __func__, level}; \
+				::project::log::print(project_log_site, __VA_ARGS__); \
+			} \
+		} \
+	} while (false)
+
+// clang-format off
+#define PROJECT_LOG_ERROR(...)   PROJECT_LOG_AT(::project::log::Level::Error, __VA_ARGS__)
+#define PROJECT_LOG_WARNING(...) PROJECT_LOG_AT(::project::log::Level::Warning, __VA_ARGS__)
+#define PROJECT_LOG_INFO(...)    PROJECT_LOG_AT(::project::log::Level::Info, __VA_ARGS__)
+#define PROJECT_LOG_DEBUG(...)   PROJECT_LOG_AT(::project::log::Level::Debug, __VA_ARGS__)
+#define PROJECT_LOG_TRACE(...)   PROJECT_LOG_AT(::project::log::Level::Trace, __VA_ARGS__)
+// clang-format on
+
 #endif
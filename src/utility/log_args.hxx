@@ -0,0 +1,189 @@
+#ifndef LOG_ARGS_HXX
+#define LOG_ARGS_HXX
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>  // for std::memcpy
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include <fmt/format.h>
+
+namespace project::log::detail {
+
+/** @brief Capture log arguments by value so they can be formatted later, on another thread.
+
+    Arguments are normalized to a small set of stored types and copied into a
+    fixed-size byte array; strings are copied as a length prefix plus bytes.
+    Each distinct argument type list instantiates one Schema: a table of stored
+    types plus the function which decodes the bytes and formats them.
+ */
+enum class ArgType : std::uint8_t
+{
+	Bool,
+	Char,
+	Int,  // std::int64_t
+	UInt,  // std::uint64_t
+	Float,
+	Double,
+	String,  // std::uint32_t length, then bytes
+	Pointer,  // std::uintptr_t
+};
+
+std::size_t constexpr ArgCapacity {192};
+
+using FormatFn = void (*)(fmt::memory_buffer& out, std::string_view format, std::byte const* data);
+
+struct Schema
+{
+	ArgType const* types;
+	std::size_t count;
+	FormatFn format;
+};
+
+/// Format string and arguments, captured by value.
+struct Packed
+{
+	std::string_view format;
+	Schema const* schema {nullptr};
+	std::size_t size {0};
+	std::array<std::byte, ArgCapacity> data;
+};
+
+/// Integer types which fmt formats as numbers, i.e. not bool or a character type.
+template <typename T>
+bool constexpr is_integer_v {std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char>
+                             && !std::is_same_v<T, wchar_t> && !std::is_same_v<T, char16_t>
+                             && !std::is_same_v<T, char32_t>};
+
+// clang-format off
+template <typename T, typename = void>
+struct Stored { static bool constexpr capturable {false}; };
+
+template <> struct Stored<bool>   { static bool constexpr capturable {true}; using type = bool;   static ArgType constexpr tag {ArgType::Bool};   };
+template <> struct Stored<char>   { static bool constexpr capturable {true}; using type = char;   static ArgType constexpr tag {ArgType::Char};   };
+template <> struct Stored<float>  { static bool constexpr capturable {true}; using type = float;  static ArgType constexpr tag {ArgType::Float};  };
+template <> struct Stored<double> { static bool constexpr capturable {true}; using type = double; static ArgType constexpr tag {ArgType::Double}; };
+
+template <typename T>
+struct Stored<T, std::enable_if_t<is_integer_v<T> && std::is_signed_v<T>>>
+{ static bool constexpr capturable {true}; using type = std::int64_t; static ArgType constexpr tag {ArgType::Int}; };
+
+template <typename T>
+struct Stored<T, std::enable_if_t<is_integer_v<T> && std::is_unsigned_v<T>>>
+{ static bool constexpr capturable {true}; using type = std::uint64_t; static ArgType constexpr tag {ArgType::UInt}; };
+
+template <typename T>
+struct Stored<T, std::enable_if_t<std::is_convertible_v<T, std::string_view> && !std::is_same_v<T, std::nullptr_t>>>
+{ static bool constexpr capturable {true}; using type = std::string_view; static ArgType constexpr tag {ArgType::String}; };
+
+template <>
+struct Stored<void const*> { static bool constexpr capturable {true}; using type = void const*; static ArgType constexpr tag {ArgType::Pointer}; };
+template <>
+struct Stored<void*> : Stored<void const*> {};
+// clang-format on
+
+template <typename T>
+using stored_t = typename Stored<std::decay_t<T>>::type;
+
+/** @brief True if the first argument is a string literal and every other argument can be captured.
+
+    A literal cannot be told apart from another array of char const, so any
+    such array passes: it is kept by pointer, and must outlive the deferred
+    call, as arrays with static storage duration do. Arguments, arrays
+    included, are copied.
+ */
+template <typename Format, typename... Args>
+bool constexpr deferrable {std::is_array_v<std::remove_reference_t<Format>>
+                           && std::is_same_v<std::remove_extent_t<std::remove_reference_t<Format>>, char const>
+                           && (Stored<std::decay_t<Args>>::capturable && ...)};
+
+template <typename T>
+auto put(Packed& packed, T const& value) -> bool
+{
+	using S = stored_t<T>;
+
+	if constexpr (std::is_same_v<S, std::string_view>) {
+		if constexpr (std::is_pointer_v<T>) {
+			if (value == nullptr) {
+				return false;  // let the caller's fmt::format report it
+			}
+		}
+
+		std::string_view const text {value};
+		auto const length {static_cast<std::uint32_t>(text.size())};
+
+		if (packed.size + sizeof length + text.size() > ArgCapacity) {
+			return false;
+		}
+		std::memcpy(packed.data.data() + packed.size, &length, sizeof length);
+		std::memcpy(packed.data.data() + packed.size + sizeof length, text.data(), text.size());
+		packed.size += sizeof length + text.size();
+	}
+	else {
+		S const stored {static_cast<S>(value)};
+
+		if (packed.size + sizeof stored > ArgCapacity) {
+			return false;
+		}
+		std::memcpy(packed.data.data() + packed.size, &stored, sizeof stored);
+		packed.size += sizeof stored;
+	}
+	return true;
+}
+
+template <typename S>
+auto get(std::byte const*& data) -> S
+{
+	if constexpr (std::is_same_v<S, std::string_view>) {
+		std::uint32_t length;
+		std::memcpy(&length, data, sizeof length);
+		std::string_view const text {reinterpret_cast<char const*>(data + sizeof length), length};
+		data += sizeof length + length;
+		return text;
+	}
+	else {
+		S value;
+		std::memcpy(&value, data, sizeof value);
+		data += sizeof value;
+		return value;
+	}
+}
+
+template <typename... S>
+void format_packed(fmt::memory_buffer& out, std::string_view const format, [[maybe_unused]] std::byte const* data)
+{
+	std::tuple<S...> values {get<S>(data)...};  // braced initialization decodes left-to-right
+	std::apply(
+	    [&](auto&... value) {
+		    fmt::vformat_to(std::back_inserter(out), format, fmt::make_format_args(value...));
+	    },
+	    values);
+}
+
+template <typename... S>
+std::array<ArgType, sizeof...(S)> constexpr arg_types {Stored<S>::tag...};
+
+template <typename... S>
+Schema constexpr schema {arg_types<S...>.data(), sizeof...(S), &format_packed<S...>};
+
+/// Keep \p format, up to its first null character, and copy \p args into \p packed. Return false if they do not fit.
+template <std::size_t N, typename... Args>
+auto pack(Packed& packed, char const (&format)[N], Args const&... args) -> bool
+{
+	std::size_t length {0};
+	while (length < N && format[length] != '\0') {  // an array may be larger than the text it holds
+		++length;
+	}
+	packed.format = std::string_view {format, length};
+	packed.schema = &schema<stored_t<Args>...>;
+	packed.size = 0;
+	return (put(packed, args) && ...);
+}
+
+}  // namespace project::log::detail
+
+#endif  // LOG_ARGS_HXX
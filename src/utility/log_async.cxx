@@ -0,0 +1,395 @@
+#include "log_async.hxx"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>  // for std::memcpy
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include "log_limit.hxx"
+#include "log_sink.hxx"
+#include "mpsc_ring.hxx"
+
+namespace project::log {
+
+namespace {
+
+struct Record
+{
+	Level level {Level::None};
+	Site const* site {nullptr};  // set by the PROJECT_LOG_* macros
+	std::uint64_t timestamp {0};
+	std::uint32_t thread {0};
+	std::string message;  // used unless packed.schema is set
+	std::string fields;
+	detail::Packed packed;
+};
+
+class Backend
+{
+public:
+	~Backend()
+	{
+		stop();
+	}
+
+	void start(AsyncOptions const& options)
+	{
+		std::lock_guard const control {_control};
+
+		if (_running.load(std::memory_order_relaxed)) {
+			return;
+		}
+
+		_ring = std::make_unique<project::detail::MpscRing<Record>>(options.capacity);
+		_overflow = options.overflow;
+		_completed.store(0, std::memory_order_relaxed);
+		_flush_target.store(0, std::memory_order_relaxed);
+		_stopping.store(false, std::memory_order_relaxed);
+		_defer.store(options.defer_formatting, std::memory_order_relaxed);
+
+		// Capture the drop baseline before any producer can reach the new ring.
+		_thread = std::thread {&Backend::run, this, _dropped.load(std::memory_order_relaxed)};
+		_running.store(true, std::memory_order_release);
+		detail::update_deferral();
+	}
+
+	void stop()
+	{
+		std::lock_guard const control {_control};
+
+		if (!_running.load(std::memory_order_relaxed)) {
+			return;
+		}
+
+		// New messages go straight to the target while the backend drains what is already queued.
+		_defer.store(false, std::memory_order_relaxed);
+		detail::update_deferral();
+		_running.store(false, std::memory_order_seq_cst);
+
+		// Producers which saw the backend running may still be claiming or filling slots. Once they are out,
+		// every claimed slot is published, so the backend drains them all, and start() may replace the ring.
+		while (_producers.load(std::memory_order_seq_cst) > 0) {
+			std::this_thread::yield();
+		}
+
+		_stopping.store(true, std::memory_order_release);
+		_wake.notify_one();
+		_thread.join();
+	}
+
+	auto running() const -> bool
+	{
+		return _running.load(std::memory_order_acquire);
+	}
+
+	auto defers() const -> bool
+	{
+		return _defer.load(std::memory_order_relaxed);
+	}
+
+	auto submit(Event const& event) -> bool
+	{
+		if (!running()) {
+			return false;  // spare every synchronous call the shared count below
+		}
+		Producer const producer {*this};
+		if (!producer.entered) {
+			return false;
+		}
+
+		push([&](Record& record) {
+			record.level = event.level;
+			record.site = event.site;
+			record.timestamp = event.timestamp;
+			record.thread = event.thread;
+
+			if (auto const* packed {event.packed}) {
+				record.message.clear();
+				record.fields.clear();
+				record.packed.format = packed->format;
+				record.packed.schema = packed->schema;
+				record.packed.size = packed->size;
+				std::memcpy(record.packed.data.data(), packed->data.data(), packed->size);  // only the bytes in use
+			}
+			else {
+				record.message.assign(event.message.data(), event.message.size());  // reuses the slot's capacity
+				record.fields.assign(event.fields.data(), event.fields.size());
+				record.packed.schema = nullptr;
+			}
+		});
+		return true;
+	}
+
+	void flush()
+	{
+		if (!running()) {
+			detail::flush_output();
+			return;
+		}
+		Producer const producer {*this};  // keeps the ring alive
+		if (!producer.entered) {
+			detail::flush_output();
+			return;
+		}
+
+		auto const target {_ring->claimed()};
+
+		auto previous {_flush_target.load(std::memory_order_relaxed)};
+		while (previous < target
+		       && !_flush_target.compare_exchange_weak(previous, target, std::memory_order_release)) {
+		}
+		_wake.notify_one();
+
+		std::unique_lock lock {_mutex};
+		_done.wait(lock, [&] { return _completed.load(std::memory_order_acquire) >= target; });
+	}
+
+	auto dropped() const -> std::uint64_t
+	{
+		return _dropped.load(std::memory_order_relaxed);
+	}
+
+	/// Hand \p write the text being batched for the log target, then each queued message as a line.
+	void drain(void (*write)(char const* data, std::size_t size)) const noexcept
+	{
+		if (!_ring) {
+			return;
+		}
+
+		if (auto const size {_batch_size.load(std::memory_order_acquire)}; size > 0) {
+			write(_batch_data.load(std::memory_order_relaxed), size);
+		}
+
+		_ring->peek_pending([&](Record const& record) {
+			auto const level {level_label(record.level)};
+			write(level.data(), level.size());
+			write(": ", 2);
+			if (record.packed.schema) {
+				write(record.packed.format.data(), record.packed.format.size());  // formatting is not signal-safe
+			}
+			else {
+				write(record.message.data(), record.message.size());
+				write(record.fields.data(), record.fields.size());
+			}
+			write("\n", 1);
+		});
+	}
+
+private:
+	/// Counts a thread in _producers for its lifetime; entered if the backend was running once counted.
+	struct Producer
+	{
+		explicit Producer(Backend& backend)
+		    : backend {backend}
+		{
+			// Pairs with stop(): either it waits for this thread, or this thread sees it stopped.
+			backend._producers.fetch_add(1, std::memory_order_seq_cst);
+			entered = backend._running.load(std::memory_order_seq_cst);
+		}
+
+		~Producer()
+		{
+			backend._producers.fetch_sub(1, std::memory_order_release);
+		}
+
+		Producer(Producer const&) = delete;
+		auto operator=(Producer const&) -> Producer& = delete;
+
+		Backend& backend;
+		bool entered {false};
+	};
+
+	static std::size_t constexpr BatchSize {256};
+	static std::size_t constexpr BatchBytes {16 * 1024};  // write text out early past this size
+
+	/// Fill a slot in place with \p fill. When full, wait for the backend, which pops until producers are out, or drop.
+	template <typename F>
+	void push(F const& fill)
+	{
+		while (!_ring->try_push_with(fill)) {
+			if (_overflow != Overflow::Block) {
+				_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			_wake.notify_one();
+			std::this_thread::yield();
+		}
+
+		if (_sleeping.load(std::memory_order_seq_cst)) {
+			_wake.notify_one();
+		}
+	}
+
+	void run(std::uint64_t reported)
+	{
+		fmt::memory_buffer buffer;
+		buffer.reserve(2 * BatchBytes);  // with early writes, messages up to BatchBytes never grow it
+
+		auto const write_batch {[&] {
+			detail::write_target(buffer.data(), buffer.size());
+			_batch_size.store(0, std::memory_order_release);
+			buffer.clear();
+		}};
+		std::size_t completed {0};
+
+		for (;;) {
+			std::size_t count {0};
+			auto const* const routes {detail::current_routes()};  // nullptr: text to the log target
+
+			auto const deliver {[&](Event const& event) {
+				if (routes) {
+					routes->write(event);
+				}
+				else {
+					format_text(buffer, event);
+					_batch_data.store(buffer.data(), std::memory_order_relaxed);
+					_batch_size.store(buffer.size(), std::memory_order_release);  // for drain()
+					if (buffer.size() >= BatchBytes) {
+						write_batch();
+					}
+				}
+			}};
+
+			auto const consume {[&](Record const& record) {
+				auto const* const packed {record.packed.schema ? &record.packed : nullptr};
+				deliver({record.level, record.site, record.timestamp, record.thread, record.message, record.fields,
+				         packed});
+			}};
+
+			while (count < BatchSize && _ring->try_pop_with(consume)) {
+				++count;
+			}
+
+			if (_overflow == Overflow::DropAndCount) {
+				auto const dropped {_dropped.load(std::memory_order_relaxed)};
+				if (dropped != reported) {
+					auto const message {fmt::format("Dropped {} log messages", dropped - reported)};
+					deliver({Level::Warning, nullptr, detail::now(), detail::thread_id(), message, {}, nullptr});
+					reported = dropped;
+				}
+			}
+
+			if (buffer.size() > 0) {
+				write_batch();
+			}
+
+			completed += count;
+
+			if (count < BatchSize || _flush_target.load(std::memory_order_acquire) > completed) {
+				if (routes) {
+					routes->flush();
+				}
+				else {
+					std::fflush(get_target());
+				}
+				{
+					std::lock_guard const lock {_mutex};
+					_completed.store(completed, std::memory_order_release);
+				}
+				_done.notify_all();
+			}
+
+			if (count > 0) {
+				continue;
+			}
+
+			// A producer may have claimed a slot without having filled it yet; keep draining until it has.
+			if (_stopping.load(std::memory_order_acquire) && _ring->claimed() == completed) {
+				break;
+			}
+
+			std::unique_lock lock {_mutex};
+			_sleeping.store(true, std::memory_order_seq_cst);
+			if (_ring->claimed() == completed && !_stopping.load(std::memory_order_acquire)) {
+				// Bounded wait: a producer that raced with the sleeping flag is picked up on timeout.
+				_wake.wait_for(lock, std::chrono::milliseconds {10});
+			}
+			_sleeping.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	std::unique_ptr<project::detail::MpscRing<Record>> _ring;
+	Overflow _overflow {Overflow::Block};
+	std::thread _thread;
+
+	std::mutex _control;  // serializes start() and stop()
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _done;
+
+	std::atomic<bool> _running {false};
+	std::atomic<bool> _defer {false};
+	std::atomic<bool> _stopping {false};
+	std::atomic<bool> _sleeping {false};
+	std::atomic<std::size_t> _producers {0};  // threads in submit() or flush()
+	std::atomic<std::uint64_t> _dropped {0};
+	std::atomic<std::size_t> _completed {0};
+	std::atomic<std::size_t> _flush_target {0};
+
+	// Text formatted by run() but not yet written; read only by drain().
+	std::atomic<char const*> _batch_data {nullptr};
+	std::atomic<std::size_t> _batch_size {0};
+};
+
+auto backend() -> Backend&
+{
+	static Backend instance;
+	return instance;
+}
+
+}  // namespace
+
+void start_backend(AsyncOptions const& options)
+{
+	backend().start(options);
+}
+
+void stop_backend()
+{
+	backend().stop();
+}
+
+auto backend_running() -> bool
+{
+	return backend().running();
+}
+
+void flush()
+{
+	detail::report_pending();
+	backend().flush();
+}
+
+auto dropped_count() -> std::uint64_t
+{
+	return backend().dropped();
+}
+
+namespace detail {
+
+auto async_submit(Event const& event) -> bool
+{
+	return backend().submit(event);
+}
+
+auto async_defers() -> bool
+{
+	return backend().running() && backend().defers();
+}
+
+void async_drain(void (*write)(char const* data, std::size_t size)) noexcept
+{
+	backend().drain(write);
+}
+
+}  // namespace detail
+
+}  // namespace project::log
@@ -0,0 +1,80 @@
+#ifndef LOG_ASYNC_HXX
+#define LOG_ASYNC_HXX
+
+#include <cstddef>
+#include <cstdint>
+
+#include <log.hxx>
+
+#include <project_dll-export.h>
+
+namespace project::log {
+
+struct Event;
+
+/// What a producer does when the asynchronous queue is full.
+enum class Overflow
+{
+	Block,  ///< Wait for the backend to free a slot.
+	DropNewest,  ///< Discard the message.
+	DropAndCount,  ///< Discard the message; the backend reports how many were lost.
+};
+
+struct AsyncOptions
+{
+	std::size_t capacity {8192};  ///< Queued messages; rounded up to a power of two.
+	Overflow overflow {Overflow::Block};
+
+	/** Let the backend run fmt instead of the caller. Producers copy the format
+	    string pointer and their arguments into the queue, which requires every
+	    format string given as a char array to be a string literal, or outlive
+	    the call as one does (see print()). Calls whose arguments cannot be
+	    captured (e.g. user-defined formatters) are formatted eagerly.
+	 */
+	bool defer_formatting {false};
+};
+
+/** @brief Hand messages to a background thread instead of writing them on the caller.
+
+    Producers push formatted messages into a bounded lock-free queue; one backend
+    thread drains it to the log target in batches. Does nothing if the backend
+    is already running.
+
+    The backend is stopped (and drained) at exit.
+ */
+DLL void start_backend(AsyncOptions const& options = {});
+
+/// Drain all queued messages, then join the backend thread. Later messages are written synchronously.
+DLL void stop_backend();
+
+DLL auto backend_running() -> bool;
+
+/** @brief Block until every message emitted before this call has reached the log target.
+
+    Counts of repeated or suppressed messages not yet reported (see PROJECT_LOG_DEDUPLICATED and
+    PROJECT_LOG_RATE_LIMITED) are emitted first.
+ */
+DLL void flush();
+
+/// Number of messages discarded because the queue was full.
+DLL auto dropped_count() -> std::uint64_t;
+
+namespace detail {
+/// Copy \p event, and its message or captured arguments, into the queue if the backend is running.
+auto async_submit(Event const& event) -> bool;
+
+/// True while the backend runs with AsyncOptions::defer_formatting.
+auto async_defers() -> bool;
+
+/** @brief Hand \p write the text not yet written by the backend, and each queued message as a line.
+
+    Async-signal-safe, for install_crash_handlers(): reads the queue without
+    consuming it, so a message may be handed over twice. Captured arguments
+    are not formatted; their format string stands in.
+ */
+void async_drain(void (*write)(char const* data, std::size_t size)) noexcept;
+}  // namespace detail
+
+}  // namespace project::log
+
+#endif  // LOG_ASYNC_HXX
@@ -0,0 +1,352 @@
+#include "log_binary.hxx"
+
+#include <algorithm>  // for std::min
+#include <cstddef>
+#include <cstring>  // for std::memcpy
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/args.h>
+
+namespace project::log {
+
+namespace {
+
+char constexpr Magic[] {'P', 'L', 'O', 'G'};
+std::uint16_t constexpr ByteOrder {0x0102};
+
+char constexpr Definition {'D'};
+char constexpr PackedRecord {'P'};
+char constexpr MessageRecord {'M'};
+
+std::size_t constexpr ReadChunk {std::size_t {1} << 16};  // bytes of a string read at a time; see Reader::read()
+
+template <typename T>
+void put(fmt::memory_buffer& out, T const value)
+{
+	auto const* bytes {reinterpret_cast<char const*>(&value)};
+	out.append(bytes, bytes + sizeof value);
+}
+
+void put_string(fmt::memory_buffer& out, char const* text)
+{
+	std::string_view const view {text ? text : ""};
+	auto const length {static_cast<std::uint16_t>(std::min<std::size_t>(view.size(), UINT16_MAX))};
+	put(out, length);
+	out.append(view.data(), view.data() + length);
+}
+
+}  // namespace
+
+BinarySink::BinarySink(std::FILE* out)
+    : _out {out}
+{
+	_buffer.append(Magic, Magic + sizeof Magic);
+	put(_buffer, Version);
+	put(_buffer, ByteOrder);
+	detail::write_file(_out, _buffer.data(), _buffer.size());
+	_buffer.clear();
+}
+
+void BinarySink::write(Event const& event)
+{
+	std::lock_guard const lock {_mutex};
+
+	auto const id {define(event)};
+
+	if (auto const* packed {event.packed}) {
+		put(_buffer, PackedRecord);
+		put(_buffer, id);
+		put(_buffer, event.timestamp);
+		put(_buffer, event.thread);
+		put(_buffer, static_cast<std::uint8_t>(event.level));
+		put(_buffer, static_cast<std::uint16_t>(packed->size));
+		auto const* data {reinterpret_cast<char const*>(packed->data.data())};
+		_buffer.append(data, data + packed->size);
+	}
+	else {
+		put(_buffer, MessageRecord);
+		put(_buffer, id);
+		put(_buffer, event.timestamp);
+		put(_buffer, event.thread);
+		put(_buffer, static_cast<std::uint8_t>(event.level));
+		put(_buffer, static_cast<std::uint32_t>(event.message.size() + event.fields.size()));
+		_buffer.append(event.message.data(), event.message.data() + event.message.size());
+		_buffer.append(event.fields.data(), event.fields.data() + event.fields.size());  // decoded as part of the text
+	}
+
+	detail::write_file(_out, _buffer.data(), _buffer.size());  // one call per record keeps records whole
+	_buffer.clear();
+}
+
+void BinarySink::flush()
+{
+	std::lock_guard const lock {_mutex};
+	std::fflush(_out);
+}
+
+auto BinarySink::define(Event const& event) -> std::uint32_t
+{
+	auto const* packed {event.packed};
+	Key const key {event.site, packed ? packed->format.data() : nullptr, packed ? packed->schema : nullptr};
+
+	if (auto const found {_ids.find(key)}; found != _ids.end()) {
+		return found->second;
+	}
+
+	auto const id {static_cast<std::uint32_t>(_ids.size() + 1)};
+	_ids.emplace(key, id);
+
+	auto const* site {event.site};
+
+	put(_buffer, Definition);
+	put(_buffer, id);
+	put(_buffer, site ? site->line : std::uint32_t {0});
+
+	if (packed) {
+		put(_buffer, static_cast<std::uint8_t>(packed->schema->count));
+		for (std::size_t i {0}; i < packed->schema->count; ++i) {
+			put(_buffer, packed->schema->types[i]);
+		}
+	}
+	else {
+		put(_buffer, std::uint8_t {0});
+	}
+
+	put_string(_buffer, site ? site->file : nullptr);
+	put_string(_buffer, site ? site->function : nullptr);
+	put_string(_buffer, site ? site->category : nullptr);
+
+	// Formats are string literals (see detail::deferrable), but not necessarily null-terminated views.
+	auto const format {packed ? packed->format : std::string_view {}};
+	auto const length {static_cast<std::uint16_t>(std::min<std::size_t>(format.size(), UINT16_MAX))};
+	put(_buffer, length);
+	_buffer.append(format.data(), format.data() + length);
+
+	return id;
+}
+
+namespace {
+
+class Reader
+{
+public:
+	explicit Reader(std::FILE* in)
+	    : _in {in}
+	{}
+
+	template <typename T>
+	auto read(T& value) -> bool
+	{
+		return std::fread(&value, sizeof value, 1, _in) == 1;
+	}
+
+	/// Read \p size bytes into \p text, growing it only as they arrive: a damaged size fails at the end of input.
+	auto read(std::string& text, std::size_t const size) -> bool
+	{
+		text.clear();
+		while (text.size() < size) {
+			auto const at {text.size()};
+			auto const chunk {std::min(size - at, ReadChunk)};
+			text.resize(at + chunk);
+			if (std::fread(text.data() + at, 1, chunk, _in) != chunk) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	auto read_string(std::string& text) -> bool
+	{
+		std::uint16_t length;
+		return read(length) && read(text, length);
+	}
+
+private:
+	std::FILE* _in;
+};
+
+struct Format
+{
+	std::vector<detail::ArgType> types;
+	std::string file;
+	std::string function;
+	std::string category;
+	std::string format;
+	std::uint32_t line {0};
+
+	Site site {};  // points into the strings above, once they are in place
+
+	/// The call site as written, or nullptr for an event which had none.
+	auto call_site() -> Site const*
+	{
+		if (file.empty() && function.empty()) {
+			return nullptr;
+		}
+		site = {file.c_str(), line, function.c_str(), Level::None, category.empty() ? nullptr : category.c_str()};
+		return &site;
+	}
+};
+
+/// Decode \p data as the arguments of \p format, then format them into \p out. False if \p data is short.
+auto format_arguments(fmt::memory_buffer& out, Format const& format, std::string_view data) -> bool
+{
+	using detail::ArgType;
+
+	fmt::dynamic_format_arg_store<fmt::format_context> args;
+
+	auto take = [&](auto& value) {
+		if (data.size() < sizeof value) {
+			return false;
+		}
+		std::memcpy(&value, data.data(), sizeof value);
+		data.remove_prefix(sizeof value);
+		return true;
+	};
+	auto push = [&](auto value) {
+		if (!take(value)) {
+			return false;
+		}
+		args.push_back(value);
+		return true;
+	};
+
+	for (auto const type : format.types) {
+		bool ok {false};
+
+		switch (type) {
+		// clang-format off
+		case ArgType::Bool:    ok = push(bool {});          break;
+		case ArgType::Char:    ok = push(char {});          break;
+		case ArgType::Int:     ok = push(std::int64_t {});  break;
+		case ArgType::UInt:    ok = push(std::uint64_t {}); break;
+		case ArgType::Float:   ok = push(float {});         break;
+		case ArgType::Double:  ok = push(double {});        break;
+		case ArgType::Pointer: ok = push(static_cast<void const*>(nullptr)); break;
+		// clang-format on
+		case ArgType::String: {
+			std::uint32_t length {0};
+			ok = take(length) && data.size() >= length;
+			if (ok) {
+				args.push_back(std::string {data.substr(0, length)});  // the store keeps its own copy
+				data.remove_prefix(length);
+			}
+			break;
+		}
+		}
+
+		if (!ok) {
+			return false;
+		}
+	}
+
+	auto const mark {out.size()};
+	try {
+		fmt::vformat_to(std::back_inserter(out), format.format, args);
+	} catch (fmt::format_error const& e) {
+		out.resize(mark);
+		fmt::format_to(std::back_inserter(out), "[format error: {}] {}", e.what(), format.format);
+	}
+	return true;
+}
+
+auto valid(std::uint8_t const level) -> bool
+{
+	return level <= static_cast<std::uint8_t>(Level::Trace);
+}
+
+}  // namespace
+
+auto decode_binary(std::FILE* in, std::FILE* out) -> bool
+{
+	Reader reader {in};
+
+	char magic[sizeof Magic];
+	std::uint16_t version;
+	std::uint16_t byte_order;
+
+	if (!reader.read(magic) || std::memcmp(magic, Magic, sizeof Magic) != 0 || !reader.read(version)
+	    || version != BinarySink::Version || !reader.read(byte_order) || byte_order != ByteOrder)
+	{
+		return false;  // not ours, or written on a host with the other byte order
+	}
+
+	std::unordered_map<std::uint32_t, Format> formats;
+	fmt::memory_buffer message;
+	fmt::memory_buffer text;
+	std::string bytes;
+
+	char tag;
+	while (reader.read(tag)) {
+		if (tag == Definition) {
+			std::uint32_t id;
+			std::uint8_t count;
+			Format format;
+
+			if (!reader.read(id) || !reader.read(format.line) || !reader.read(count)) {
+				return false;
+			}
+			format.types.resize(count);
+			for (auto& type : format.types) {
+				if (!reader.read(type) || type > detail::ArgType::Pointer) {
+					return false;
+				}
+			}
+			if (!reader.read_string(format.file) || !reader.read_string(format.function)
+			    || !reader.read_string(format.category) || !reader.read_string(format.format))
+			{
+				return false;
+			}
+			formats.insert_or_assign(id, std::move(format));
+			continue;
+		}
+
+		if (tag != PackedRecord && tag != MessageRecord) {
+			return false;
+		}
+
+		std::uint32_t id;
+		std::uint64_t timestamp;
+		std::uint32_t thread;
+		std::uint8_t level;
+
+		if (!reader.read(id) || !reader.read(timestamp) || !reader.read(thread) || !reader.read(level)
+		    || !valid(level))
+		{
+			return false;
+		}
+
+		auto const found {formats.find(id)};
+		if (found == formats.end()) {
+			return false;
+		}
+
+		message.clear();
+
+		if (tag == PackedRecord) {
+			std::uint16_t size;
+			if (!reader.read(size) || !reader.read(bytes, size) || !format_arguments(message, found->second, bytes)) {
+				return false;
+			}
+		}
+		else {
+			std::uint32_t size;
+			if (!reader.read(size) || !reader.read(bytes, size)) {
+				return false;
+			}
+			message.append(bytes.data(), bytes.data() + bytes.size());
+		}
+
+		text.clear();
+		format_text(text, {static_cast<Level>(level), found->second.call_site(), timestamp, thread,
+		                   {message.data(), message.size()}, {}, nullptr});
+		std::fwrite(text.data(), 1, text.size(), out);
+	}
+
+	return std::feof(in) != 0;
+}
+
+}  // namespace project::log
@@ -0,0 +1,73 @@
+#ifndef LOG_BINARY_HXX
+#define LOG_BINARY_HXX
+
+#include <cstdint>
+#include <cstdio>  // for std::FILE
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include <fmt/format.h>
+
+#include <log_sink.hxx>
+
+#include <project_dll-export.h>
+
+namespace project::log {
+
+/** @brief Sink which writes compact binary records instead of text.
+
+    Each record holds a call-site id, a timestamp, the level, and the captured
+    arguments exactly as queued (see AsyncOptions::defer_formatting). Format
+    strings and call-site metadata are written once, in a definition record
+    emitted the first time an id is used. Messages which could not be captured
+    are stored pre-formatted, followed by their fields (see kv()).
+
+    Use decode_binary() or the `log-decode` tool to read the output as text.
+
+    Layout (integers in host byte order):
+@code
+header:     "PLOG" u16:version u16:0x0102
+definition: 'D' u32:id u32:line u8:count u8[count]:types str:file str:function str:category str:format
+packed:     'P' u32:id u64:timestamp u32:thread u8:level u16:size u8[size]:arguments
+message:    'M' u32:id u64:timestamp u32:thread u8:level u32:size u8[size]:text
+@endcode
+    where str is a u16 length followed by that many bytes.
+ */
+class DLL BinarySink : public Sink
+{
+public:
+	static std::uint16_t constexpr Version {2};
+
+	/// Write the header to \p out, which must be opened in binary mode and outlive the sink.
+	explicit BinarySink(std::FILE* out);
+
+	void write(Event const& event) override;
+	void flush() override;
+
+	auto deferred() const -> bool override
+	{
+		return true;
+	}
+
+private:
+	using Key = std::tuple<Site const*, char const*, detail::Schema const*>;
+
+	auto define(Event const& event) -> std::uint32_t;
+
+	std::mutex _mutex;
+	std::FILE* _out;
+	std::map<Key, std::uint32_t> _ids;
+	fmt::memory_buffer _buffer;  // reused for each record
+};
+
+/** @brief Expand a binary log written by BinarySink to text, laid out by the current pattern (see set_pattern()).
+
+    @return false if \p in is not a binary log or ends inside a record;
+            everything before the damaged record is still written to \p out.
+ */
+DLL auto decode_binary(std::FILE* in, std::FILE* out) -> bool;
+
+}  // namespace project::log
+
+#endif  // LOG_BINARY_HXX
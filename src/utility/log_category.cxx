@@ -0,0 +1,226 @@
+#include "log_category.hxx"
+
+#include <algorithm>  // for std::min
+#include <functional>  // for std::less
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace project::log {
+
+namespace {
+
+struct Registry
+{
+	std::mutex mutex;
+	std::map<std::string, std::unique_ptr<Category>, std::less<>> categories;
+	Level routed {Level::Trace};  // without sinks, the log target takes every level
+	std::vector<std::unique_ptr<LevelConfig const>> configs;  // every config published, the current one last
+};
+
+auto registry() -> Registry&
+{
+	static Registry instance;
+	return instance;
+}
+
+std::atomic<LevelConfig const*> Current {nullptr};
+
+}  // namespace
+
+Category::Category(std::string_view const name, Level const level)
+    : _level {level}
+    , _overridden {false}
+    , _override {Level::None}
+    , _name {name}
+{}
+
+void Category::set_level(Level const level)
+{
+	auto& instance {registry()};
+	std::lock_guard const lock {instance.mutex};
+	_overridden = true;
+	_override = level;
+	_level.store(std::min(level, instance.routed), std::memory_order_relaxed);
+}
+
+void Category::reset_level()
+{
+	std::lock_guard const lock {registry().mutex};
+	_overridden = false;
+	_level.store(detail::LogLevel.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void Category::follow(Level const global, Level const routed)
+{
+	_level.store(_overridden ? std::min(_override, routed) : global, std::memory_order_relaxed);
+}
+
+auto category(std::string_view const name) -> Category&
+{
+	auto& [mutex, categories, routed, configs] {registry()};
+	std::lock_guard const lock {mutex};
+
+	auto found {categories.find(name)};
+
+	if (found == categories.end()) {
+		std::unique_ptr<Category> created {new Category {name, detail::LogLevel.load(std::memory_order_relaxed)}};
+		found = categories.emplace(std::string {name}, std::move(created)).first;
+	}
+
+	return *found->second;
+}
+
+auto parse_levels(std::string_view const spec) -> LevelSpec
+{
+	auto const trim = [](std::string_view text) {
+		auto const first {text.find_first_not_of(" \t")};
+		if (first == std::string_view::npos) {
+			return std::string_view {};
+		}
+		return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+	};
+	auto const invalid = [](std::string_view const entry) {
+		return std::invalid_argument {fmt::format("invalid log level \"{}\"", entry)};
+	};
+
+	LevelSpec result;
+	std::size_t begin {0};
+	auto equals {std::string_view::npos};  // in the current entry
+
+	for (std::size_t i {0}; i <= spec.size(); ++i) {
+		if (i < spec.size() && spec[i] != ',') {
+			if (spec[i] == '=' && equals == std::string_view::npos) {
+				equals = i;
+			}
+			continue;
+		}
+
+		auto const entry {trim(spec.substr(begin, i - begin))};
+
+		if (equals == std::string_view::npos) {
+			if (!entry.empty()) {
+				auto const level {detail::parse_level(entry)};
+				if (!level) {
+					throw invalid(entry);
+				}
+				result.global = level;
+			}
+		}
+		else {
+			auto const name {trim(spec.substr(begin, equals - begin))};
+			auto const level {detail::parse_level(trim(spec.substr(equals + 1, i - equals - 1)))};
+			if (name.empty() || !level) {
+				throw invalid(entry);
+			}
+			result.categories.emplace_back(name, *level);
+		}
+
+		begin = i + 1;
+		equals = std::string_view::npos;
+	}
+
+	return result;
+}
+
+auto configure(std::string_view const spec) -> LevelConfig const&
+{
+	auto const levels {parse_levels(spec)};
+
+	std::vector<Category*> named;  // created before locking, as category() locks too
+	for (auto const& [name, level] : levels.categories) {
+		named.push_back(&category(name));
+	}
+
+	auto& instance {registry()};
+	std::lock_guard const lock {instance.mutex};
+
+	auto const* const previous {Current.load(std::memory_order_relaxed)};
+	auto const global {levels.global.value_or(detail::GlobalLevel.load(std::memory_order_relaxed))};
+
+	auto next {std::make_unique<LevelConfig>()};
+	next->generation = previous ? previous->generation + 1 : 1;
+	next->spec = spec;
+	next->global = global;
+
+	// Categories the previous config set follow the global level again, unless set below.
+	if (previous) {
+		for (auto const& [name, level] : previous->categories) {
+			if (auto const found {instance.categories.find(name)}; found != instance.categories.end()) {
+				found->second->_overridden = false;
+			}
+		}
+	}
+	for (std::size_t i {0}; i < named.size(); ++i) {
+		named[i]->_overridden = true;
+		named[i]->_override = levels.categories[i].second;
+		next->categories.emplace_back(levels.categories[i].first, levels.categories[i].second);
+	}
+
+	detail::GlobalLevel.store(global, std::memory_order_relaxed);
+	auto const clipped {std::min(global, instance.routed)};
+	detail::LogLevel.store(clipped, std::memory_order_relaxed);
+	for (auto& [name, category] : instance.categories) {
+		category->follow(clipped, instance.routed);  // from the flags set above
+	}
+
+	Current.store(instance.configs.emplace_back(std::move(next)).get(), std::memory_order_release);
+	return *instance.configs.back();
+}
+
+auto current_config() -> LevelConfig const*
+{
+	return Current.load(std::memory_order_acquire);
+}
+
+void set_levels(std::string_view const spec)
+{
+	auto const levels {parse_levels(spec)};
+
+	if (levels.global) {
+		set_level(*levels.global);
+	}
+	for (auto const& [name, level] : levels.categories) {
+		category(name).set_level(level);
+	}
+}
+
+namespace detail {
+
+void set_global_level(Level const level)
+{
+	auto& instance {registry()};
+	std::lock_guard const lock {instance.mutex};
+
+	GlobalLevel.store(level, std::memory_order_relaxed);
+
+	auto const clipped {std::min(level, instance.routed)};
+	LogLevel.store(clipped, std::memory_order_relaxed);
+
+	for (auto& [name, category] : instance.categories) {
+		category->follow(clipped, instance.routed);
+	}
+}
+
+void set_routed_level(Level const level)
+{
+	auto& instance {registry()};
+	std::lock_guard const lock {instance.mutex};
+
+	instance.routed = level;
+
+	auto const clipped {std::min(GlobalLevel.load(std::memory_order_relaxed), level)};
+	LogLevel.store(clipped, std::memory_order_relaxed);
+
+	for (auto& [name, category] : instance.categories) {
+		category->follow(clipped, level);
+	}
+}
+
+}  // namespace detail
+
+}  // namespace project::log
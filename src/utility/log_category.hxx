@@ -0,0 +1,177 @@
+#ifndef LOG_CATEGORY_HXX
+#define LOG_CATEGORY_HXX
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>  // for std::forward, std::pair
+#include <vector>
+
+#include <log.hxx>
+#include <mpsc_ring.hxx>  // for detail::CacheLine
+
+#include <project_dll-export.h>
+
+namespace project::log {
+
+class Category;
+
+/// Find or create the category named \p name.
+DLL auto category(std::string_view name) -> Category&;
+
+/// Levels parsed from a spec such as "info,net=trace,db=warn"; see parse_levels().
+struct LevelSpec
+{
+	std::optional<Level> global;  ///< From the last entry without a name, e.g. "info".
+	std::vector<std::pair<std::string_view, Level>> categories;  ///< From name=level entries, in order.
+};
+
+/** @brief Parse a comma-separated list of levels, each optionally qualified by a category name, in one pass.
+
+    Levels are matched as by level_from(), but an unknown one is an error.
+    Whitespace around names and levels is ignored, as are empty entries.
+    Category names refer into \p spec.
+    Throw std::invalid_argument naming the first invalid entry.
+ */
+DLL auto parse_levels(std::string_view spec) -> LevelSpec;
+
+/** @brief Set the global level and category levels given by \p spec.
+
+    If it is invalid, throw as parse_levels() and change nothing.
+ */
+DLL void set_levels(std::string_view spec);
+
+/// Levels applied by configure(). Never changed once published.
+struct LevelConfig
+{
+	std::uint64_t generation;  ///< Counts the configs published, from 1.
+	std::string spec;  ///< As given to configure().
+	Level global;  ///< The global level once applied.
+	std::vector<std::pair<std::string, Level>> categories;  ///< The category levels it set, in spec order.
+};
+
+/** @brief Apply \p spec as the whole level configuration, then publish it as current_config().
+
+    Like set_levels(), but categories the previous config gave a level and
+    \p spec does not follow the global level again. The levels are applied
+    under one lock, so concurrent calls do not interleave. If \p spec is
+    invalid, throw as parse_levels() and change nothing.
+ */
+DLL auto configure(std::string_view spec) -> LevelConfig const&;
+
+/** @brief The config last applied by configure(), or nullptr if none.
+
+    Read with one acquire load and no lock. Configs are kept until exit, so
+    the pointer stays valid, and what it points to never changes.
+ */
+DLL auto current_config() -> LevelConfig const*;
+
+namespace detail {
+/// The level set by set_level(). LogLevel holds it clipped to the levels some output accepts.
+extern std::atomic<Level> GlobalLevel;
+
+/// Set the global level and every category which follows it, atomically with respect to category().
+void set_global_level(Level level);
+
+/// Clip the global and category levels to \p level, the least-severe level any output accepts.
+void set_routed_level(Level level);
+}  // namespace detail
+
+/** @brief Named subsystem whose log level may differ from the global one.
+
+    A category follows the global level (see set_level()) until it is given its
+    own. Either is clipped to the levels some sink accepts (see add_sink()), so
+    a message no sink wants fails this check. Its effective level lives on its
+    own cache line and is read with a single relaxed load, so checking it never
+    takes a lock.
+
+    Categories live until exit; references to them never dangle.
+ */
+class DLL Category
+{
+public:
+	Category(Category const&) = delete;
+	auto operator=(Category const&) -> Category& = delete;
+
+	auto name() const -> std::string_view
+	{
+		return _name;
+	}
+
+	/// Effective level: the override if one is set, else the global level; clipped as above.
+	auto level() const -> Level
+	{
+		return _level.load(std::memory_order_relaxed);
+	}
+
+	auto enabled(Level const level) const -> bool
+	{
+		return this->level() >= level;
+	}
+
+	/// Override the global level for this category.
+	void set_level(Level level);
+
+	/// Follow the global level again.
+	void reset_level();
+
+private:
+	friend auto category(std::string_view name) -> Category&;
+	friend auto configure(std::string_view spec) -> LevelConfig const&;
+	friend void detail::set_global_level(Level level);
+	friend void detail::set_routed_level(Level level);
+
+	Category(std::string_view name, Level level);
+
+	/// Recompute the effective level from the clipped global level and the routed level. Call with the lock held.
+	void follow(Level global, Level routed);
+
+	alignas(project::detail::CacheLine) std::atomic<Level> _level;
+	bool _overridden;  // guarded by the category registry lock
+	Level _override;  // guarded by the category registry lock
+	std::string _name;
+};
+
+/// Emit a log message if \p category enables \p level.
+template <typename... Args>
+void print(Category const& category, Level level, Args&&... args)
+{
+#if ENABLE_LOGGING
+	if (level <= MinLevel && category.enabled(level)) {
+		detail::emit(level, nullptr, std::forward<Args>(args)...);
+	}
+#else
+	(void) category;
+	(void) level;
+	((void) args, ...);
+#endif
+}
+
+}  // namespace project::log
+
+/** @brief Like PROJECT_LOG_AT(), but checks the level of the category named \p name.
+
+    The category is looked up once per call site; later calls read its cached level.
+ */
+#define PROJECT_LOG_CATEGORY_AT(name, level, ...) \
+	do { \
+		if constexpr (::project::log::compiled(level)) { \
+			static ::project::log::Category const& project_log_category {::project::log::category(name)}; \
+			if (PROJECT_LOG_UNLIKELY(project_log_category.enabled(level))) { \
+				static ::project::log::Site constexpr project_log_site {__FILE__, __LINE__, __func__, level, name}; \
+				::project::log::print(project_log_site, __VA_ARGS__); \
+			} \
+		} \
+	} while (false)
+
+// clang-format off
+#define PROJECT_LOG_CATEGORY_ERROR(name, ...)   PROJECT_LOG_CATEGORY_AT(name, ::project::log::Level::Error, __VA_ARGS__)
+#define PROJECT_LOG_CATEGORY_WARNING(name, ...) PROJECT_LOG_CATEGORY_AT(name, ::project::log::Level::Warning, __VA_ARGS__)
+#define PROJECT_LOG_CATEGORY_INFO(name, ...)    PROJECT_LOG_CATEGORY_AT(name, ::project::log::Level::Info, __VA_ARGS__)
+#define PROJECT_LOG_CATEGORY_DEBUG(name, ...)   PROJECT_LOG_CATEGORY_AT(name, ::project::log::Level::Debug, __VA_ARGS__)
+#define PROJECT_LOG_CATEGORY_TRACE(name, ...)   PROJECT_LOG_CATEGORY_AT(name, ::project::log::Level::Trace, __VA_ARGS__)
+// clang-format on
+
+#endif  // LOG_CATEGORY_HXX
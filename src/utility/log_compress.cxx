@@ -0,0 +1,487 @@
+#include "log_compress.hxx"
+
+#include <algorithm>  // for std::clamp, std::max, std::min
+#include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>  // for std::memcmp, std::memcpy, std::memmove, std::strerror
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace project::log {
+
+namespace {
+
+char constexpr Magic[] {'P', 'L', 'Z'};
+std::size_t constexpr HeaderSize {sizeof Magic + 1};
+std::size_t constexpr FrameSize {12};  // the fixed part of a frame
+std::uint32_t constexpr Stored {0x8000'0000};  // in payload_size: the payload is the text
+std::uint32_t constexpr MaxText {std::uint32_t {1} << 26};  // guards decoding against damaged sizes
+
+// The codec, in the style of LZ4: each sequence is a token byte, whose high
+// nibble is the literal count and low nibble the match length less MinMatch,
+// either extended by bytes of 255 and a final smaller byte when it reads 15;
+// the literals; then a u16 offset back to the match. The last sequence has
+// literals only, and ends the input.
+std::size_t constexpr MinMatch {4};
+std::size_t constexpr MaxOffset {0xFFFF};
+int constexpr HashBits {12};
+
+void put_u32(char* const out, std::uint32_t const value)
+{
+	for (int i {0}; i < 4; ++i) {
+		out[i] = static_cast<char>(value >> (8 * i));
+	}
+}
+
+auto get_u32(char const* const in) -> std::uint32_t
+{
+	std::uint32_t value {0};
+	for (int i {0}; i < 4; ++i) {
+		value |= std::uint32_t {static_cast<unsigned char>(in[i])} << (8 * i);
+	}
+	return value;
+}
+
+auto read32(char const* const at) -> std::uint32_t
+{
+	std::uint32_t value;
+	std::memcpy(&value, at, sizeof value);
+	return value;
+}
+
+auto hash(std::uint32_t const sequence) -> std::size_t
+{
+	return (sequence * 2654435761u) >> (32 - HashBits);
+}
+
+/// Append \p length as the extension bytes of a nibble which reads 15.
+void put_length(fmt::memory_buffer& out, std::size_t length)
+{
+	for (; length >= 255; length -= 255) {
+		out.push_back(static_cast<char>(255));
+	}
+	out.push_back(static_cast<char>(length));
+}
+
+void put_sequence(fmt::memory_buffer& out, char const* const literals, std::size_t const count,
+                  std::size_t const offset, std::size_t const match)
+{
+	auto const extra {match - MinMatch};
+	out.push_back(static_cast<char>((std::min<std::size_t>(count, 15) << 4) | std::min<std::size_t>(extra, 15)));
+	if (count >= 15) {
+		put_length(out, count - 15);
+	}
+	out.append(literals, literals + count);
+	out.push_back(static_cast<char>(offset & 0xFF));
+	out.push_back(static_cast<char>(offset >> 8));
+	if (extra >= 15) {
+		put_length(out, extra - 15);
+	}
+}
+
+void put_last(fmt::memory_buffer& out, char const* const literals, std::size_t const count)
+{
+	out.push_back(static_cast<char>(std::min<std::size_t>(count, 15) << 4));
+	if (count >= 15) {
+		put_length(out, count - 15);
+	}
+	out.append(literals, literals + count);
+}
+
+/// Read the extension bytes of a nibble which reads 15, adding them to \p length. False past the end.
+auto get_length(char const* const data, std::size_t const size, std::size_t& at, std::size_t& length) -> bool
+{
+	for (;;) {
+		if (at == size) {
+			return false;
+		}
+		auto const byte {static_cast<unsigned char>(data[at++])};
+		length += byte;
+		if (byte != 255) {
+			return true;
+		}
+	}
+}
+
+/// Append a frame holding \p text to \p out.
+void put_frame(fmt::memory_buffer& out, char const* const text, std::size_t const size)
+{
+	auto const start {out.size()};
+	out.resize(start + FrameSize);
+	detail::compress(text, size, out);
+
+	auto payload {static_cast<std::uint32_t>(out.size() - start - FrameSize)};
+	if (payload >= size) {
+		out.resize(start + FrameSize);
+		out.append(text, text + size);
+		payload = static_cast<std::uint32_t>(size) | Stored;
+	}
+
+	put_u32(out.data() + start, static_cast<std::uint32_t>(size));
+	put_u32(out.data() + start + 4, payload);
+	put_u32(out.data() + start + 8, detail::checksum(text, size));
+}
+
+}  // namespace
+
+namespace detail {
+
+void compress(char const* const data, std::size_t const size, fmt::memory_buffer& out)
+{
+	std::array<std::uint32_t, std::size_t {1} << HashBits> table {};  // last position of each hashed sequence
+	std::size_t anchor {0};  // first byte not yet written
+	std::size_t at {0};
+	std::size_t misses {0};
+
+	while (at + MinMatch <= size) {
+		auto const sequence {read32(data + at)};
+		auto& slot {table[hash(sequence)]};
+		std::size_t const candidate {slot};
+		slot = static_cast<std::uint32_t>(at);
+
+		if (candidate >= at || at - candidate > MaxOffset || read32(data + candidate) != sequence) {
+			at += 1 + (misses++ >> 6);  // speeds through text which does not compress
+			continue;
+		}
+
+		auto length {MinMatch};
+		while (at + length < size && data[candidate + length] == data[at + length]) {
+			++length;
+		}
+
+		put_sequence(out, data + anchor, at - anchor, at - candidate, length);
+		at += length;
+		anchor = at;
+		misses = 0;
+	}
+
+	put_last(out, data + anchor, size - anchor);
+}
+
+auto decompress(char const* const data, std::size_t const size, char* const out, std::size_t const capacity) -> bool
+{
+	std::size_t in {0};
+	std::size_t written {0};
+
+	for (;;) {
+		if (in == size) {
+			return false;
+		}
+		auto const token {static_cast<unsigned char>(data[in++])};
+
+		auto count {static_cast<std::size_t>(token >> 4u)};
+		if (count == 15 && !get_length(data, size, in, count)) {
+			return false;
+		}
+		if (count > size - in || count > capacity - written) {
+			return false;
+		}
+		std::memcpy(out + written, data + in, count);
+		in += count;
+		written += count;
+
+		if (in == size) {
+			return written == capacity;  // the last sequence
+		}
+
+		if (size - in < 2) {
+			return false;
+		}
+		auto const offset {std::size_t {static_cast<unsigned char>(data[in])} |
+		                   std::size_t {static_cast<unsigned char>(data[in + 1])} << 8u};
+		in += 2;
+
+		auto length {static_cast<std::size_t>(token & 15u) + MinMatch};
+		if ((token & 15u) == 15 && !get_length(data, size, in, length)) {
+			return false;
+		}
+		if (offset == 0 || offset > written || length > capacity - written) {
+			return false;
+		}
+
+		auto const* from {out + written - offset};
+		if (offset >= length) {
+			std::memcpy(out + written, from, length);
+		}
+		else {
+			for (std::size_t i {0}; i < length; ++i) {  // overlaps: repeats the last offset bytes
+				out[written + i] = from[i];
+			}
+		}
+		written += length;
+	}
+}
+
+auto checksum(char const* const data, std::size_t const size) -> std::uint32_t
+{
+	std::uint32_t hash {2166136261u};
+	for (std::size_t i {0}; i < size; ++i) {
+		hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+	}
+	return hash;
+}
+
+}  // namespace detail
+
+/** Blocks circulate between the writers and the compressor: writers fill
+    `current`, queue it and take a free block; the compressor writes the
+    queued blocks in order, then frees them. There are max_pending + 1 blocks.
+ */
+struct CompressedSink::State
+{
+	using Block = std::unique_ptr<fmt::memory_buffer>;
+
+	std::FILE* out;
+	CompressedSinkOptions options;
+
+	std::mutex mutex;
+	std::condition_variable queued;  // for the compressor
+	std::condition_variable freed;  // for writers
+	Block current;
+	std::uint64_t oldest {0};  // timestamp of the first record in current
+	std::deque<Block> queue;
+	std::vector<Block> free;
+	std::uint64_t submitted {0};
+	std::uint64_t written {0};
+	bool stopping {false};
+	std::thread compressor;
+
+	/// Queue the current block, if not empty, then wait for a free one.
+	void submit(std::unique_lock<std::mutex>& lock)
+	{
+		if (current->size() == 0) {
+			return;
+		}
+
+		queue.push_back(std::move(current));
+		++submitted;
+		queued.notify_one();
+
+		freed.wait(lock, [&] { return !free.empty(); });
+		current = std::move(free.back());
+		free.pop_back();
+		current->clear();
+	}
+
+	void run()
+	{
+		fmt::memory_buffer frame;
+		bool failing {false};
+
+		std::unique_lock lock {mutex};
+		for (;;) {
+			queued.wait(lock, [&] { return stopping || !queue.empty(); });
+			if (queue.empty()) {
+				return;
+			}
+			auto block {std::move(queue.front())};
+			queue.pop_front();
+			lock.unlock();
+
+			frame.clear();
+			put_frame(frame, block->data(), block->size());
+			bool const ok {detail::write_file(out, frame.data(), frame.size()) && std::fflush(out) == 0};
+
+			if (!ok && !failing) {
+				auto const message {fmt::format("{}: cannot write compressed log block: {}\n",
+				                                level_label(Level::Error), std::strerror(errno))};
+				std::fwrite(message.data(), 1, message.size(), get_target());
+			}
+			failing = !ok;
+
+			lock.lock();
+			free.push_back(std::move(block));
+			++written;
+			freed.notify_all();
+		}
+	}
+};
+
+CompressedSink::CompressedSink(std::FILE* const out, CompressedSinkOptions options)
+    : _state {std::make_unique<State>()}
+{
+	auto& state {*_state};
+	state.out = out;
+	state.options = options;
+	state.options.block_size = std::clamp<std::size_t>(state.options.block_size, 1, MaxText / 2);
+	state.options.max_pending = std::max<std::size_t>(state.options.max_pending, 1);
+
+	auto const make_block = [&] {
+		auto block {std::make_unique<fmt::memory_buffer>()};
+		block->reserve(state.options.block_size + 1024);
+		return block;
+	};
+	state.current = make_block();
+	for (std::size_t i {0}; i < state.options.max_pending; ++i) {
+		state.free.push_back(make_block());
+	}
+
+	char header[HeaderSize] {'P', 'L', 'Z', static_cast<char>(Version)};
+	std::fwrite(header, 1, sizeof header, out);
+	std::fflush(out);
+
+	state.compressor = std::thread {[&state] { state.run(); }};
+}
+
+CompressedSink::~CompressedSink()
+{
+	flush();
+
+	auto& state {*_state};
+	{
+		std::lock_guard const lock {state.mutex};
+		state.stopping = true;
+	}
+	state.queued.notify_one();
+	state.compressor.join();
+}
+
+void CompressedSink::write(Event const& event)
+{
+	auto& state {*_state};
+	std::unique_lock lock {state.mutex};
+
+	auto& block {*state.current};
+	if (block.size() == 0) {
+		state.oldest = event.timestamp;
+	}
+	format_text(block, event);
+
+	auto const max_delay {static_cast<std::uint64_t>(state.options.max_delay.count())};
+	bool const due {event.timestamp >= state.oldest && event.timestamp - state.oldest >= max_delay};
+
+	if (block.size() >= state.options.block_size || due) {
+		state.submit(lock);
+	}
+}
+
+void CompressedSink::flush()
+{
+	auto& state {*_state};
+	std::unique_lock lock {state.mutex};
+
+	state.submit(lock);
+	auto const target {state.submitted};
+	state.freed.wait(lock, [&] { return state.written >= target; });
+}
+
+void CompressedSink::drain() noexcept
+{
+	auto const& state {*_state};
+
+	// Store the blocks not yet compressed as they are: compressing allocates, which is not async-signal-safe.
+	auto const store {[&](fmt::memory_buffer const& block) {
+		if (block.size() == 0) {
+			return;
+		}
+		char frame[FrameSize];
+		put_u32(frame, static_cast<std::uint32_t>(block.size()));
+		put_u32(frame + 4, static_cast<std::uint32_t>(block.size()) | Stored);
+		put_u32(frame + 8, detail::checksum(block.data(), block.size()));
+		detail::write_direct(state.out, frame, sizeof frame);
+		detail::write_direct(state.out, block.data(), block.size());
+	}};
+
+	for (auto const& block : state.queue) {
+		store(*block);
+	}
+	if (state.current) {
+		store(*state.current);
+	}
+}
+
+auto CompressedReader::feed(char const* const data, std::size_t const size, fmt::memory_buffer& out) -> bool
+{
+	if (_failed) {
+		return false;
+	}
+	_pending.append(data, data + size);
+
+	auto const* const bytes {_pending.data()};
+	std::size_t at {0};
+
+	if (!_started) {
+		auto const seen {std::min(_pending.size(), sizeof Magic)};
+		if (std::memcmp(bytes, Magic, seen) != 0) {
+			_failed = true;
+			return false;
+		}
+		if (_pending.size() < HeaderSize) {
+			return true;
+		}
+		if (static_cast<std::uint8_t>(bytes[sizeof Magic]) != CompressedSink::Version) {
+			_failed = true;
+			return false;
+		}
+		_started = true;
+		at = HeaderSize;
+	}
+
+	while (_pending.size() - at >= FrameSize) {
+		auto const text_size {get_u32(bytes + at)};
+		auto const payload_field {get_u32(bytes + at + 4)};
+		auto const payload_size {payload_field & ~Stored};
+		bool const stored {(payload_field & Stored) != 0};
+
+		if (text_size > MaxText || payload_size > MaxText || (stored && payload_size != text_size)) {
+			_failed = true;
+			break;
+		}
+		if (_pending.size() - at - FrameSize < payload_size) {
+			break;  // wait for the rest of the frame
+		}
+
+		auto const* const payload {bytes + at + FrameSize};
+		auto const start {out.size()};
+		out.resize(start + text_size);
+
+		bool const ok {stored ? (std::memcpy(out.data() + start, payload, text_size), true)
+		                      : detail::decompress(payload, payload_size, out.data() + start, text_size)};
+		if (!ok || detail::checksum(out.data() + start, text_size) != get_u32(bytes + at + 8)) {
+			out.resize(start);
+			_failed = true;
+			break;
+		}
+		at += FrameSize + payload_size;
+	}
+
+	auto const rest {_pending.size() - at};
+	std::memmove(_pending.data(), _pending.data() + at, rest);
+	_pending.resize(rest);
+	return !_failed;
+}
+
+auto decode_compressed(std::FILE* const in, std::FILE* const out, bool const follow) -> bool
+{
+	CompressedReader reader;
+	fmt::memory_buffer text;
+	std::vector<char> chunk(std::size_t {64} << 10);
+
+	for (;;) {
+		auto const count {std::fread(chunk.data(), 1, chunk.size(), in)};
+
+		if (count > 0) {
+			bool const ok {reader.feed(chunk.data(), count, text)};
+			std::fwrite(text.data(), 1, text.size(), out);
+			text.clear();
+			if (!ok) {
+				return false;
+			}
+			if (follow) {
+				std::fflush(out);
+			}
+			continue;
+		}
+
+		if (!follow || std::ferror(in)) {
+			return reader.started() && reader.pending() == 0 && !std::ferror(in);
+		}
+		std::clearerr(in);  // forget the end of file, and wait for more
+		std::this_thread::sleep_for(std::chrono::milliseconds {100});
+	}
+}
+
+}  // namespace project::log
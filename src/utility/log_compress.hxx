@@ -0,0 +1,136 @@
+#ifndef LOG_COMPRESS_HXX
+#define LOG_COMPRESS_HXX
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>  // for std::FILE
+#include <memory>  // for std::unique_ptr
+
+#include <fmt/format.h>
+
+#include <log_sink.hxx>
+
+#include <project_dll-export.h>
+
+namespace project::log {
+
+/// When a CompressedSink closes a block.
+struct CompressedSinkOptions
+{
+	/// Compress once the block holds this much text. Larger blocks compress better but are lost whole if torn.
+	std::size_t block_size {std::size_t {64} << 10};
+
+	/// Compress once the oldest record of the block is this old, checked as records arrive.
+	std::chrono::nanoseconds max_delay {std::chrono::seconds {1}};
+
+	/// Blocks waiting for the compressor before writers wait too.
+	std::size_t max_pending {4};
+};
+
+/** @brief Sink which writes text in compressed blocks.
+
+    Records are formatted into a block; once full (see CompressedSinkOptions),
+    the block is handed to a background thread which compresses it, writes
+    its frame and flushes \p out, so a reader following the file sees whole
+    blocks only. flush() closes the current block and waits until every block
+    is written.
+
+    The codec is a byte-oriented LZ77 variant in the style of LZ4: fast to
+    encode and decode, typically shrinking log text 3 times or more. A block
+    which does not shrink is stored as is. Each frame carries a checksum of
+    its text, so a torn or damaged block is detected, and everything before
+    it is still read.
+
+    Use decode_compressed() or `log-decode --compressed` to read the output.
+
+    Layout (integers in little-endian byte order):
+@code
+header: "PLZ" u8:version
+frame:  u32:text_size u32:payload_size u32:checksum u8[payload_size]:payload
+@endcode
+    The top bit of payload_size is set if the payload is the text itself;
+    checksum is the 32-bit FNV-1a hash of the text.
+ */
+class DLL CompressedSink : public Sink
+{
+public:
+	static std::uint8_t constexpr Version {1};
+
+	/// Write the header to \p out, which must be opened in binary mode and outlive the sink.
+	explicit CompressedSink(std::FILE* out, CompressedSinkOptions options = {});
+	~CompressedSink() override;
+
+	CompressedSink(CompressedSink const&) = delete;
+	auto operator=(CompressedSink const&) -> CompressedSink& = delete;
+
+	void write(Event const& event) override;
+	void flush() override;
+
+	/// Write the blocks not yet written, uncompressed; see Sink::drain().
+	void drain() noexcept override;
+
+private:
+	struct State;
+
+	std::unique_ptr<State> _state;
+};
+
+/** @brief Expands a compressed log as its bytes arrive, in pieces of any size.
+
+    Keeps the bytes of an incomplete frame until the rest is fed.
+ */
+class DLL CompressedReader
+{
+public:
+	/** @brief Append the text of every frame completed by \p data to \p out.
+
+	    @return false if the bytes are not a compressed log, or a frame is
+	            damaged; the reader then stays failed.
+	 */
+	auto feed(char const* data, std::size_t size, fmt::memory_buffer& out) -> bool;
+
+	/// Whether the header has been read.
+	auto started() const -> bool
+	{
+		return _started;
+	}
+
+	/// Bytes kept of an incomplete frame (or header).
+	auto pending() const -> std::size_t
+	{
+		return _pending.size();
+	}
+
+private:
+	fmt::memory_buffer _pending;
+	bool _started {false};
+	bool _failed {false};
+};
+
+/** @brief Expand a compressed log written by CompressedSink to text.
+
+    If \p follow, wait at the end of \p in for more frames, like `tail -f`,
+    returning only on damage or a read error.
+
+    @return false if \p in is not a compressed log, ends inside a frame, or
+            holds a damaged frame; the text of every frame before is still
+            written to \p out.
+ */
+DLL auto decode_compressed(std::FILE* in, std::FILE* out, bool follow = false) -> bool;
+
+namespace detail {
+
+/// Append \p size bytes at \p data to \p out, compressed.
+DLL void compress(char const* data, std::size_t size, fmt::memory_buffer& out);
+
+/// Expand \p size compressed bytes at \p data into exactly \p capacity bytes at \p out. False if damaged.
+DLL auto decompress(char const* data, std::size_t size, char* out, std::size_t capacity) -> bool;
+
+DLL auto checksum(char const* data, std::size_t size) -> std::uint32_t;
+
+}  // namespace detail
+
+}  // namespace project::log
+
+#endif  // LOG_COMPRESS_HXX
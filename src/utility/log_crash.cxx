@@ -0,0 +1,165 @@
+#include "log_crash.hxx"
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>  // for std::abort
+#include <exception>  // for std::set_terminate
+#include <iterator>  // for std::size
+#include <mutex>
+#include <string_view>
+
+#include <signal.h>  // for sigaction, sigaltstack
+#include <unistd.h>
+
+#include "log_async.hxx"
+#include "log_sink.hxx"
+
+namespace project::log {
+
+namespace {
+
+int constexpr Signals[] {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+// Guarded by Mutex, except that handlers read Previous once installed.
+std::mutex Mutex;
+bool Installed {false};
+struct sigaction Previous[std::size(Signals)];
+std::terminate_handler PreviousTerminate {nullptr};
+
+std::atomic<bool> Draining {false};  // set by the first handler to run
+
+alignas(16) char AltStack[64 * 1024];  // room to run the handler after a stack overflow
+
+auto signal_name(int const signal) -> std::string_view
+{
+	switch (signal) {
+	case SIGSEGV: return "SIGSEGV";
+	case SIGBUS: return "SIGBUS";
+	case SIGFPE: return "SIGFPE";
+	case SIGILL: return "SIGILL";
+	case SIGABRT: return "SIGABRT";
+	default: return "signal";
+	}
+}
+
+/// Write to the log target's descriptor with write(2) only.
+void write_target(char const* data, std::size_t size) noexcept
+{
+	auto const fd {::fileno(get_target())};
+
+	while (size > 0) {
+		auto const written {::write(fd, data, size)};
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			return;
+		}
+		data += written;
+		size -= static_cast<std::size_t>(written);
+	}
+}
+
+/// Write a line naming \p cause and \p what, then everything pending. Only the first call does anything.
+void drain(std::string_view const cause, std::string_view const what) noexcept
+{
+	if (Draining.exchange(true)) {
+		return;
+	}
+
+	auto const level {level_label(Level::Error)};
+	write_target(level.data(), level.size());
+	write_target(": ", 2);
+	write_target(cause.data(), cause.size());
+	write_target(what.data(), what.size());
+	write_target("\n", 1);
+
+	detail::async_drain(write_target);
+
+	if (auto const* const routes {detail::current_routes()}) {
+		for (std::size_t i {0}; i < routes->count; ++i) {
+			routes->sinks[i]->drain();
+		}
+	}
+}
+
+void on_signal(int const signal)
+{
+	auto const error {errno};
+
+	drain("fatal signal ", signal_name(signal));
+
+	// Hand the signal on: restore the handler installed before this one; it runs once this returns.
+	for (std::size_t i {0}; i < std::size(Signals); ++i) {
+		if (Signals[i] == signal) {
+			::sigaction(signal, &Previous[i], nullptr);
+		}
+	}
+	::raise(signal);
+
+	errno = error;
+}
+
+void on_terminate()
+{
+	drain("std::terminate called", {});
+
+	if (PreviousTerminate) {
+		PreviousTerminate();
+	}
+	std::abort();
+}
+
+}  // namespace
+
+void install_crash_handlers()
+{
+	std::lock_guard const lock {Mutex};
+
+	if (Installed) {
+		return;
+	}
+
+	std::fflush(get_target());
+	detail::flush_output();  // sinks' stdio buffers too, before they are bypassed
+	detail::DirectTarget.store(true, std::memory_order_relaxed);
+	Draining.store(false, std::memory_order_relaxed);
+
+	stack_t stack {};
+	stack.ss_sp = AltStack;
+	stack.ss_size = sizeof AltStack;
+	::sigaltstack(&stack, nullptr);
+
+	struct sigaction action {};
+	action.sa_handler = on_signal;
+	action.sa_flags = SA_ONSTACK;
+	::sigemptyset(&action.sa_mask);
+
+	for (std::size_t i {0}; i < std::size(Signals); ++i) {
+		::sigaction(Signals[i], &action, &Previous[i]);
+	}
+	PreviousTerminate = std::set_terminate(on_terminate);
+
+	Installed = true;
+}
+
+void uninstall_crash_handlers()
+{
+	std::lock_guard const lock {Mutex};
+
+	if (!Installed) {
+		return;
+	}
+
+	for (std::size_t i {0}; i < std::size(Signals); ++i) {
+		::sigaction(Signals[i], &Previous[i], nullptr);
+	}
+	std::set_terminate(PreviousTerminate);
+	detail::DirectTarget.store(false, std::memory_order_relaxed);
+
+	Installed = false;
+}
+
+}  // namespace project::log
@@ -0,0 +1,33 @@
+#ifndef LOG_CRASH_HXX
+#define LOG_CRASH_HXX
+
+#include <project_dll-export.h>
+
+namespace project::log {
+
+/** @brief Write out pending log records if the process dies from a fatal signal or std::terminate().
+
+    Handles SIGSEGV, SIGBUS, SIGFPE, SIGILL and SIGABRT (on an alternate stack
+    for the installing thread, so stack overflows are caught too), and
+    std::terminate(). The handler writes a line naming the cause, then, using
+    write(2) only:
+    - the text the backend has formatted but not written, and each message
+      still queued for it (see start_backend()),
+    - the records each sink has buffered (see Sink::drain()),
+    then hands the signal on to the handler installed before, or the default
+    action.
+
+    While installed, text for the log target, and for a FileSink, BinarySink
+    or CompressedSink, is written straight to its file descriptor instead of
+    through stdio, so none sits in a stdio buffer.
+
+    Available on POSIX systems only. Calling it again has no effect.
+ */
+DLL void install_crash_handlers();
+
+/// Restore the handlers replaced by install_crash_handlers(), and stdio output to the log target.
+DLL void uninstall_crash_handlers();
+
+}  // namespace project::log
+
+#endif  // LOG_CRASH_HXX
@@ -0,0 +1,206 @@
+#include "log_fd.hxx"
+
+#include <algorithm>  // for std::clamp, std::min
+#include <cerrno>
+#include <climits>  // for IOV_MAX
+#include <cstdio>
+#include <cstring>  // for std::strerror
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace project::log {
+
+namespace {
+
+#ifdef IOV_MAX
+std::size_t constexpr MaxIov {IOV_MAX};
+#else
+std::size_t constexpr MaxIov {16};  // the POSIX minimum
+#endif
+
+#ifdef MSG_NOSIGNAL
+int constexpr NoSignal {MSG_NOSIGNAL};
+#else
+int constexpr NoSignal {0};  // SO_NOSIGPIPE is set on the socket instead
+#endif
+
+}  // namespace
+
+struct FdSink::Batch
+{
+	std::vector<fmt::memory_buffer> records;  // one per slot, reused so formatting stops allocating
+	std::vector<::iovec> iov;
+	std::size_t pending {0};
+	std::size_t bytes {0};
+	std::uint64_t oldest {0};  // timestamp of the first pending record
+};
+
+FdSink::FdSink(int const fd, bool const owned, FdSinkOptions options)
+    : _fd {fd}
+    , _owned {owned}
+    , _options {options}
+    , _batch {std::make_unique<Batch>()}
+{
+	_options.batch_records = std::clamp(_options.batch_records, std::size_t {1}, MaxIov);
+	_batch->records.resize(_options.batch_records);
+	_batch->iov.resize(_options.batch_records);
+}
+
+FdSink::~FdSink()
+{
+	std::lock_guard const lock {_mutex};
+
+	write_pending();
+
+	if (_owned) {
+		::close(_fd);
+	}
+}
+
+auto FdSink::connect(std::string const& path, FdSinkOptions options) -> std::shared_ptr<FdSink>
+{
+	::sockaddr_un address {};
+	address.sun_family = AF_UNIX;
+
+	if (path.size() >= sizeof address.sun_path) {
+		throw std::system_error {ENAMETOOLONG, std::generic_category(), "cannot connect log sink to " + path};
+	}
+	path.copy(address.sun_path, path.size());
+
+	int const fd {::socket(AF_UNIX, SOCK_STREAM, 0)};
+	if (fd < 0) {
+		throw std::system_error {errno, std::generic_category(), "cannot connect log sink to " + path};
+	}
+
+	::fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+	int const on {1};
+	::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof on);
+#endif
+
+	if (::connect(fd, reinterpret_cast<::sockaddr const*>(&address), sizeof address) != 0) {
+		auto const error {errno};
+		::close(fd);
+		throw std::system_error {error, std::generic_category(), "cannot connect log sink to " + path};
+	}
+
+	auto sink {std::make_shared<FdSink>(fd, true, options)};
+	sink->_socket = true;
+	return sink;
+}
+
+void FdSink::write(Event const& event)
+{
+	std::lock_guard const lock {_mutex};
+
+	auto& batch {*_batch};
+	auto& record {batch.records[batch.pending]};
+
+	record.clear();
+	format_text(record, event);
+
+	if (batch.pending++ == 0) {
+		batch.oldest = event.timestamp;
+	}
+	batch.bytes += record.size();
+
+	auto const max_delay {static_cast<std::uint64_t>(_options.max_delay.count())};
+	bool const due {event.timestamp >= batch.oldest && event.timestamp - batch.oldest >= max_delay};
+
+	if (batch.pending == batch.records.size() || batch.bytes >= _options.batch_bytes || due) {
+		write_pending();
+	}
+}
+
+void FdSink::flush()
+{
+	std::lock_guard const lock {_mutex};
+	write_pending();
+}
+
+void FdSink::drain() noexcept
+{
+	auto const& batch {*_batch};
+
+	for (std::size_t i {0}; i < batch.pending && i < batch.records.size(); ++i) {
+		auto const* data {batch.records[i].data()};
+		auto size {batch.records[i].size()};
+
+		while (size > 0) {
+			auto const written {::write(_fd, data, size)};
+			if (written < 0 && errno == EINTR) {
+				continue;
+			}
+			if (written <= 0) {
+				return;
+			}
+			data += written;
+			size -= static_cast<std::size_t>(written);
+		}
+	}
+}
+
+void FdSink::write_pending()
+{
+	auto& batch {*_batch};
+	auto const count {batch.pending};
+
+	batch.pending = 0;
+	batch.bytes = 0;
+
+	for (std::size_t i {0}; i < count; ++i) {
+		batch.iov[i] = {batch.records[i].data(), batch.records[i].size()};
+	}
+
+	std::size_t first {0};
+
+	while (first < count) {
+		auto* const iov {batch.iov.data() + first};
+		auto const size {count - first};
+
+		::ssize_t written;
+		if (_socket) {
+			::msghdr message {};
+			message.msg_iov = iov;
+			message.msg_iovlen = static_cast<decltype(message.msg_iovlen)>(size);
+			written = ::sendmsg(_fd, &message, NoSignal);
+		}
+		else {
+			written = ::writev(_fd, iov, static_cast<int>(size));
+		}
+
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (!_failing) {
+				auto const message {fmt::format("{}: cannot write log records to descriptor {}: {}\n",
+				                                level_label(Level::Error), _fd, std::strerror(errno))};
+				std::fwrite(message.data(), 1, message.size(), get_target());
+				_failing = true;
+			}
+			return;  // drop the rest of the batch
+		}
+
+		// Skip what was written; a short write leaves the rest for the next call.
+		auto left {static_cast<std::size_t>(written)};
+		while (first < count && left >= batch.iov[first].iov_len) {
+			left -= batch.iov[first].iov_len;
+			++first;
+		}
+		if (left > 0) {
+			batch.iov[first].iov_base = static_cast<char*>(batch.iov[first].iov_base) + left;
+			batch.iov[first].iov_len -= left;
+		}
+	}
+
+	_failing = false;
+}
+
+}  // namespace project::log
@@ -0,0 +1,76 @@
+#ifndef LOG_FD_HXX
+#define LOG_FD_HXX
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>  // for std::unique_ptr, std::shared_ptr
+#include <mutex>
+#include <string>
+
+#include <log_sink.hxx>
+
+#include <project_dll-export.h>
+
+namespace project::log {
+
+/// When an FdSink writes the records it has accumulated.
+struct FdSinkOptions
+{
+	/// Write once this many records are pending. Capped by the system limit on one writev().
+	std::size_t batch_records {64};
+
+	/// Write once the pending records hold this many bytes.
+	std::size_t batch_bytes {std::size_t {64} << 10};
+
+	/// Write once the oldest pending record is this old, checked as records arrive. Zero: write every record.
+	std::chrono::nanoseconds max_delay {std::chrono::milliseconds {100}};
+};
+
+/** @brief Sink which writes text to a file descriptor, one writev() per batch of records.
+
+    Each record is formatted into a buffer of its own, kept for reuse, and the
+    buffers of a batch are written with a single call. flush() writes whatever
+    is pending; the asynchronous backend calls it whenever its queue runs dry.
+
+    If a write fails, the batch is dropped and an error is written to the log
+    target, once until a write succeeds again.
+
+    Available on POSIX systems only.
+ */
+class DLL FdSink : public Sink
+{
+public:
+	/// Write to \p fd, and close it with the sink if \p owned.
+	FdSink(int fd, bool owned, FdSinkOptions options = {});
+	~FdSink() override;
+
+	FdSink(FdSink const&) = delete;
+	auto operator=(FdSink const&) -> FdSink& = delete;
+
+	/// Connect to the UNIX stream socket at \p path. Throw std::system_error if that fails.
+	static auto connect(std::string const& path, FdSinkOptions options = {}) -> std::shared_ptr<FdSink>;
+
+	void write(Event const& event) override;
+	void flush() override;
+
+	/// Write the pending records with write(2), without locking.
+	void drain() noexcept override;
+
+private:
+	struct Batch;
+
+	void write_pending();  // call with _mutex held
+
+	std::mutex _mutex;
+	int const _fd;
+	bool const _owned;
+	bool _socket {false};  // use send flags which keep a closed peer from raising SIGPIPE
+	bool _failing {false};  // the last write failed; guarded by _mutex
+	FdSinkOptions _options;
+	std::unique_ptr<Batch> _batch;  // guarded by _mutex
+};
+
+}  // namespace project::log
+
+#endif  // LOG_FD_HXX
@@ -0,0 +1,164 @@
+#include "log_fields.hxx"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>  // for std::memcpy
+
+namespace project::log {
+
+namespace {
+
+std::atomic<Encoding> CurrentEncoding {Encoding::Text};
+
+/*
+	Word-at-a-time scanning: each test flags the bytes of an 8-byte block for
+	which it holds. A flag may be spurious past the first real one, which is
+	harmless here: a flagged block is only rescanned byte by byte.
+ */
+std::uint64_t constexpr Ones {0x0101010101010101u};
+std::uint64_t constexpr Highs {0x8080808080808080u};
+
+auto constexpr has_less(std::uint64_t const block, std::uint8_t const n) -> std::uint64_t
+{
+	return (block - Ones * n) & ~block & Highs;
+}
+
+auto constexpr has_byte(std::uint64_t const block, std::uint8_t const c) -> std::uint64_t
+{
+	return has_less(block ^ (Ones * c), 1);
+}
+
+auto constexpr escaped(unsigned char const c) -> bool
+{
+	return c < 0x20 || c == '"' || c == '\\';
+}
+
+/// True if \p text has a byte which needs a JSON escape, or, with \p logfmt, a space or '='.
+auto needs_work(std::string_view const text, bool const logfmt) -> bool
+{
+	auto const* p {text.data()};
+	auto const* const end {p + text.size()};
+
+	for (; p + sizeof(std::uint64_t) <= end; p += sizeof(std::uint64_t)) {
+		std::uint64_t block;
+		std::memcpy(&block, p, sizeof block);
+
+		auto const flags {has_less(block, logfmt ? 0x21 : 0x20) | has_byte(block, '"') | has_byte(block, '\\')
+		                  | (logfmt ? has_byte(block, '=') : 0)};
+		if (flags != 0) {
+			return true;
+		}
+	}
+	for (; p < end; ++p) {
+		auto const c {static_cast<unsigned char>(*p)};
+		if (escaped(c) || (logfmt && (c == ' ' || c == '='))) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void append_escape(fmt::memory_buffer& out, unsigned char const c)
+{
+	switch (c) {
+	case '"': out.append(std::string_view {"\\\""}); break;
+	case '\\': out.append(std::string_view {"\\\\"}); break;
+	case '\n': out.append(std::string_view {"\\n"}); break;
+	case '\r': out.append(std::string_view {"\\r"}); break;
+	case '\t': out.append(std::string_view {"\\t"}); break;
+	case '\b': out.append(std::string_view {"\\b"}); break;
+	case '\f': out.append(std::string_view {"\\f"}); break;
+	default: fmt::format_to(fmt::appender {out}, "\\u{:04x}", c); break;
+	}
+}
+
+}  // namespace
+
+void set_encoding(Encoding const encoding)
+{
+	CurrentEncoding.store(encoding, std::memory_order_relaxed);
+}
+
+auto get_encoding() -> Encoding
+{
+	return detail::current_encoding();
+}
+
+namespace detail {
+
+void escape_json(fmt::memory_buffer& out, std::string_view const text)
+{
+	auto const* p {text.data()};
+	auto const* const end {p + text.size()};
+	auto const* run {p};  // start of the bytes not yet copied
+
+	auto const scan {[&](char const* const stop) {
+		for (; p < stop; ++p) {
+			if (auto const c {static_cast<unsigned char>(*p)}; escaped(c)) {
+				out.append(run, p);
+				append_escape(out, c);
+				run = p + 1;
+			}
+		}
+	}};
+
+	while (p + sizeof(std::uint64_t) <= end) {
+		std::uint64_t block;
+		std::memcpy(&block, p, sizeof block);
+
+		if ((has_less(block, 0x20) | has_byte(block, '"') | has_byte(block, '\\')) == 0) {
+			p += sizeof block;  // copied later, with the rest of the run
+		}
+		else {
+			scan(p + sizeof block);
+		}
+	}
+	scan(end);
+	out.append(run, end);
+}
+
+void quote_logfmt(fmt::memory_buffer& out, std::string_view const text)
+{
+	if (!text.empty() && !needs_work(text, true)) {
+		out.append(text);
+		return;
+	}
+	out.push_back('"');
+	escape_json(out, text);
+	out.push_back('"');
+}
+
+void append_string(fmt::memory_buffer& out, std::string_view const text, Encoding const encoding)
+{
+	if (encoding == Encoding::Json) {
+		out.push_back('"');
+		escape_json(out, text);
+		out.push_back('"');
+	}
+	else {
+		quote_logfmt(out, text);
+	}
+}
+
+void append_key(fmt::memory_buffer& out, std::string_view const key, Encoding const encoding)
+{
+	if (encoding == Encoding::Json) {
+		out.append(std::string_view {",\""});
+		escape_json(out, key);
+		out.append(std::string_view {"\":"});
+	}
+	else {
+		out.push_back(' ');
+		out.append(key);
+		out.push_back('=');
+	}
+}
+
+auto current_encoding() -> Encoding
+{
+	return CurrentEncoding.load(std::memory_order_relaxed);
+}
+
+}  // namespace detail
+
+}  // namespace project::log
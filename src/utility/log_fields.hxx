@@ -0,0 +1,123 @@
+#ifndef LOG_FIELDS_HXX
+#define LOG_FIELDS_HXX
+
+#include <cmath>  // for std::isfinite
+#include <string_view>
+#include <type_traits>
+
+#include <fmt/format.h>
+
+#include <project_dll-export.h>
+
+namespace project::log {
+
+/** @brief Layout of each line written as text, by the log target and text sinks.
+@code
+Text     the current pattern, fields after the message:
+         Info: request done latency_us=12 path=/x
+Json     one object per line:
+         {"time":"...","level":"Info","thread":7,"message":"request done","latency_us":12,"path":"/x"}
+Logfmt   key=value pairs:
+         time="..." level=info thread=7 msg="request done" latency_us=12 path=/x
+@endcode
+    Call-site fields (file, line, function, category) are added to Json and
+    Logfmt lines when captured by a PROJECT_LOG_* macro.
+ */
+enum class Encoding
+{
+	Text,
+	Json,
+	Logfmt,
+};
+
+/// Set the encoding of lines and fields from now on. Fields are encoded when emitted; lines when written.
+DLL void set_encoding(Encoding encoding);
+DLL auto get_encoding() -> Encoding;
+
+/** @brief Typed key/value field of a structured log message; see kv().
+
+    Refers to its key and value, so it must not outlive the log call.
+ */
+template <typename T>
+struct Field
+{
+	std::string_view key;
+	T const& value;
+};
+
+/** @brief Attach a typed field to a log message, e.g.
+@code
+log::info("request done", kv("latency_us", t), kv("path", p));
+@endcode
+    Fields follow the format arguments. Numbers and booleans are written as
+    such, strings escaped as needed, and other values formatted with fmt.
+ */
+template <typename T>
+auto kv(std::string_view const key, T const& value) -> Field<T>
+{
+	return {key, value};
+}
+
+namespace detail {
+template <typename T>
+struct IsField : std::false_type
+{};
+
+template <typename T>
+struct IsField<Field<T>> : std::true_type
+{};
+
+template <typename T>
+bool constexpr is_field_v {IsField<std::remove_cv_t<std::remove_reference_t<T>>>::value};
+
+/// Append \p text with JSON escapes, without quotes. Clean 8-byte blocks are copied whole.
+DLL void escape_json(fmt::memory_buffer& out, std::string_view text);
+
+/// Append \p text as a logfmt value: as-is if it needs no quotes, else quoted with JSON escapes.
+DLL void quote_logfmt(fmt::memory_buffer& out, std::string_view text);
+
+/// Append \p text as a string value in \p encoding.
+DLL void append_string(fmt::memory_buffer& out, std::string_view text, Encoding encoding);
+
+/// Append the separator and key which precede a field value in \p encoding.
+DLL void append_key(fmt::memory_buffer& out, std::string_view key, Encoding encoding);
+
+DLL auto current_encoding() -> Encoding;
+
+/// Append \p field in \p encoding: `,"key":value` for Json, ` key=value` otherwise.
+template <typename T>
+void append_field(fmt::memory_buffer& out, Field<T> const& field, Encoding const encoding)
+{
+	append_key(out, field.key, encoding);
+
+	auto const& value {field.value};
+
+	if constexpr (std::is_same_v<T, bool>) {
+		out.append(std::string_view {value ? "true" : "false"});
+	}
+	else if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, char>) {
+		if constexpr (std::is_floating_point_v<T>) {
+			if (encoding == Encoding::Json && !std::isfinite(value)) {
+				out.append(std::string_view {"null"});
+				return;
+			}
+		}
+		fmt::format_to(fmt::appender {out}, "{}", value);
+	}
+	else if constexpr (std::is_same_v<T, char>) {
+		append_string(out, std::string_view {&value, 1}, encoding);
+	}
+	else if constexpr (std::is_convertible_v<T const&, std::string_view>) {
+		append_string(out, std::string_view {value}, encoding);
+	}
+	else {
+		fmt::memory_buffer text;  // on the stack unless the value is long
+		fmt::format_to(fmt::appender {text}, "{}", value);
+		append_string(out, {text.data(), text.size()}, encoding);
+	}
+}
+}  // namespace detail
+
+}  // namespace project::log
+
+#endif  // LOG_FIELDS_HXX
@@ -0,0 +1,398 @@
+#include "log_index.hxx"
+
+#include <algorithm>  // for std::max, std::min, std::partition_point
+#include <atomic>
+#include <cstring>  // for std::memchr, std::memcmp, std::memcpy
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define PROJECT_LOG_FIND_AVX2 1
+#endif
+
+#include <fmt/format.h>
+
+#include "log_pattern.hxx"  // for append_time
+
+namespace project::log {
+
+namespace {
+
+char constexpr Magic[] {'P', 'L', 'I', 'X'};
+std::uint16_t constexpr ByteOrder {0x0102};
+std::size_t constexpr HeaderSize {sizeof Magic + 2 * sizeof(std::uint16_t)};
+std::size_t constexpr ChunkSize {std::size_t {1} << 20};  // of the log, per task of a scanning thread
+
+/// "YYYY-MM-DD HH:MM:SS.uuuuuu", as written by detail::append_time().
+std::string_view constexpr TimeShape {"0000-00-00 00:00:00.000000"};
+
+auto scalar_find(char const* const data, std::size_t const size, std::string_view const needle) -> std::size_t
+{
+	auto const* at {data};
+	auto const* const last {data + size - needle.size()};  // last place a match may start
+
+	while (at <= last) {
+		at = static_cast<char const*>(std::memchr(at, needle[0], static_cast<std::size_t>(last - at) + 1));
+		if (!at) {
+			break;
+		}
+		if (std::memcmp(at + 1, needle.data() + 1, needle.size() - 1) == 0) {
+			return static_cast<std::size_t>(at - data);
+		}
+		++at;
+	}
+	return std::string_view::npos;
+}
+
+#ifdef PROJECT_LOG_FIND_AVX2
+/// Compare the first and last bytes of \p needle at 32 places at once, then the rest where both match.
+__attribute__((target("avx2"))) auto avx2_find(char const* const data, std::size_t const size,
+                                                std::string_view const needle) -> std::size_t
+{
+	auto const n {needle.size()};
+	auto const first {_mm256_set1_epi8(needle.front())};
+	auto const last {_mm256_set1_epi8(needle.back())};
+
+	std::size_t i {0};
+	for (; i + n - 1 + 32 <= size; i += 32) {
+		auto const starts {_mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + i))};
+		auto const ends {_mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + i + n - 1))};
+		auto const both {_mm256_and_si256(_mm256_cmpeq_epi8(first, starts), _mm256_cmpeq_epi8(last, ends))};
+
+		for (auto mask {static_cast<std::uint32_t>(_mm256_movemask_epi8(both))}; mask != 0; mask &= mask - 1) {
+			auto const at {i + static_cast<std::size_t>(__builtin_ctz(mask))};
+			if (std::memcmp(data + at + 1, needle.data() + 1, n - 2) == 0) {
+				return at;
+			}
+		}
+	}
+
+	auto const rest {scalar_find(data + i, size - i, needle)};
+	return rest == std::string_view::npos ? rest : i + rest;
+}
+
+bool const HasAvx2 {[] {
+	__builtin_cpu_init();  // may run before the constructor which would call it
+	return __builtin_cpu_supports("avx2") != 0;
+}()};
+#endif
+
+auto is_word(char const c) -> bool
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+/// The first level name in \p line, as a word, or Level::None.
+auto level_of(std::string_view const line) -> Level
+{
+	std::size_t at {0};
+	while (at < line.size()) {
+		if (!is_word(line[at])) {
+			++at;
+			continue;
+		}
+		auto const begin {at};
+		while (at < line.size() && is_word(line[at])) {
+			++at;
+		}
+		if (auto const level {detail::parse_level(line.substr(begin, at - begin))}; level && *level != Level::None) {
+			return *level;
+		}
+	}
+	return Level::None;
+}
+
+/// The first "{time}" field in \p line, or empty.
+auto time_of(std::string_view const line) -> std::string_view
+{
+	for (std::size_t at {0}; at + TimeShape.size() <= line.size(); ++at) {
+		std::size_t i {0};
+		for (; i < TimeShape.size(); ++i) {
+			auto const c {line[at + i]};
+			if (TimeShape[i] == '0' ? (c < '0' || c > '9') : c != TimeShape[i]) {
+				break;
+			}
+		}
+		if (i == TimeShape.size()) {
+			return line.substr(at, TimeShape.size());
+		}
+	}
+	return {};
+}
+
+struct Filter
+{
+	std::string_view text;
+	Level level;
+	std::string since;  // as "{time}" fields; empty: no bound
+	std::string until;
+
+	auto accepts(std::string_view const line) const -> bool
+	{
+		if (level != Level::Trace) {
+			auto const found {level_of(line)};
+			if (found == Level::None || found > level) {
+				return false;
+			}
+		}
+		if (!since.empty() || !until.empty()) {
+			auto const time {time_of(line)};
+			if (!time.empty() && ((!since.empty() && time < since) || (!until.empty() && time > until))) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+struct Range
+{
+	std::size_t begin;
+	std::size_t end;
+};
+
+/// Append the lines in \p range of \p log which \p filter accepts to \p out; return their number.
+auto scan(std::string_view const log, Range const range, Filter const& filter, fmt::memory_buffer& out)
+    -> std::size_t
+{
+	std::size_t lines {0};
+	auto at {range.begin};
+
+	while (at < range.end) {
+		auto begin {at};
+
+		if (!filter.text.empty()) {
+			auto const hit {detail::find(log.substr(at, range.end - at), filter.text)};
+			if (hit == std::string_view::npos) {
+				break;
+			}
+			auto const newline {log.substr(range.begin, at + hit - range.begin).rfind('\n')};
+			begin = std::max(at, newline == std::string_view::npos ? range.begin : range.begin + newline + 1);
+		}
+
+		auto const* const newline {static_cast<char const*>(std::memchr(log.data() + begin, '\n', range.end - begin))};
+		auto const end {newline ? static_cast<std::size_t>(newline - log.data()) : range.end};
+		auto const line {log.substr(begin, end - begin)};
+
+		if (filter.accepts(line)) {
+			out.append(line);
+			out.push_back('\n');
+			++lines;
+		}
+		at = end + 1;
+	}
+	return lines;
+}
+
+/// Split \p ranges into pieces of about ChunkSize, each ending after a newline.
+auto chunks(std::string_view const log, std::vector<Range> const& ranges) -> std::vector<Range>
+{
+	std::vector<Range> result;
+	for (auto const& range : ranges) {
+		auto at {range.begin};
+		while (at < range.end) {
+			auto end {std::min(at + ChunkSize, range.end)};
+			if (end < range.end) {
+				auto const* const newline {
+				    static_cast<char const*>(std::memchr(log.data() + end, '\n', range.end - end))};
+				end = newline ? static_cast<std::size_t>(newline - log.data()) + 1 : range.end;
+			}
+			result.push_back({at, end});
+			at = end;
+		}
+	}
+	return result;
+}
+
+/// The ranges of \p log which may hold a match, by the index.
+auto candidates(std::string_view const log, IndexEntry const* const index, std::size_t count, Query const& query)
+    -> std::vector<Range>
+{
+	while (count > 0 && index[count - 1].end > log.size()) {
+		--count;  // indexes text not yet flushed to the log
+	}
+	if (count == 0) {
+		return {{0, log.size()}};
+	}
+
+	unsigned levels {0};
+	for (auto level {static_cast<unsigned>(Level::Error)}; level <= static_cast<unsigned>(query.level); ++level) {
+		levels |= 1u << level;
+	}
+
+	std::vector<Range> ranges;
+	auto const add = [&](std::uint64_t const begin, std::uint64_t end) {
+		end = std::min<std::uint64_t>(end, log.size());  // guards against a damaged entry
+		if (!ranges.empty() && ranges.back().end == begin && begin <= end) {
+			ranges.back().end = static_cast<std::size_t>(end);
+		}
+		else if (begin < end) {
+			ranges.push_back({static_cast<std::size_t>(begin), static_cast<std::size_t>(end)});
+		}
+	};
+
+	auto const* entry {std::partition_point(index, index + count, [&](auto const& e) { return e.last < query.since; })};
+	for (; entry != index + count; ++entry) {
+		if (entry->first > query.until) {
+			return ranges;  // this block and the rest are later
+		}
+		if ((entry->levels & levels) != 0) {
+			add(entry->begin, entry->end);
+		}
+	}
+
+	add(index[count - 1].end, log.size());  // not indexed yet
+	return ranges;
+}
+
+auto time_text(std::uint64_t const timestamp) -> std::string
+{
+	fmt::memory_buffer text;
+	detail::append_time(text, timestamp);
+	return {text.data(), text.size()};
+}
+
+}  // namespace
+
+IndexWriter::IndexWriter(std::FILE* const out, std::size_t const every)
+    : _out {out}
+    , _every {std::max<std::size_t>(every, 1)}
+{
+	char header[HeaderSize];
+	std::memcpy(header, Magic, sizeof Magic);
+	std::memcpy(header + sizeof Magic, &Version, sizeof Version);
+	std::memcpy(header + sizeof Magic + sizeof Version, &ByteOrder, sizeof ByteOrder);
+	std::fwrite(header, 1, sizeof header, _out);
+}
+
+IndexWriter::~IndexWriter()
+{
+	if (_block.records > 0) {
+		write_entry();
+	}
+	std::fflush(_out);
+}
+
+void IndexWriter::add(Event const& event, std::uint64_t const offset, std::size_t const size)
+{
+	if (_block.records == 0) {
+		_block.begin = offset;
+		_block.first = event.timestamp;
+	}
+	_block.end = offset + size;
+	_block.first = std::min(_block.first, event.timestamp);
+	_last = std::max(_last, event.timestamp);
+	_block.levels |= static_cast<std::uint8_t>(1u << static_cast<unsigned>(event.level));
+
+	if (++_block.records == _every) {
+		write_entry();
+	}
+}
+
+void IndexWriter::flush()
+{
+	std::fflush(_out);
+}
+
+void IndexWriter::write_entry()
+{
+	_block.last = _last;
+	std::fwrite(&_block, sizeof _block, 1, _out);
+	_block = {};
+}
+
+auto index_entries(std::string_view const data, std::size_t& count) -> IndexEntry const*
+{
+	std::uint16_t version;
+	std::uint16_t order;
+
+	if (data.size() < HeaderSize || data.compare(0, sizeof Magic, Magic, sizeof Magic) != 0) {
+		return nullptr;
+	}
+	std::memcpy(&version, data.data() + sizeof Magic, sizeof version);
+	std::memcpy(&order, data.data() + sizeof Magic + sizeof version, sizeof order);
+
+	auto const* const entries {data.data() + HeaderSize};
+	if (version != IndexWriter::Version || order != ByteOrder
+	    || reinterpret_cast<std::uintptr_t>(entries) % alignof(IndexEntry) != 0) {
+		return nullptr;
+	}
+
+	count = (data.size() - HeaderSize) / sizeof(IndexEntry);  // a torn last entry is left out
+	return reinterpret_cast<IndexEntry const*>(entries);
+}
+
+auto search(std::string_view const log, IndexEntry const* const index, std::size_t const count, Query const& query,
+            std::FILE* const out) -> QueryStats
+{
+	Filter const filter {
+	    query.text,
+	    query.level,
+	    query.since > 0 ? time_text(query.since) : std::string {},
+	    query.until != ~std::uint64_t {0} ? time_text(query.until) : std::string {},
+	};
+
+	auto const ranges {candidates(log, index, count, query)};
+	auto const tasks {chunks(log, ranges)};
+
+	QueryStats stats {0, 0};
+	for (auto const& range : ranges) {
+		stats.scanned += range.end - range.begin;
+	}
+
+	std::vector<fmt::memory_buffer> results(tasks.size());
+	std::vector<std::size_t> lines(tasks.size());
+	std::atomic<std::size_t> next {0};
+
+	auto const work = [&] {
+		for (auto task {next++}; task < tasks.size(); task = next++) {
+			lines[task] = scan(log, tasks[task], filter, results[task]);
+		}
+	};
+
+	auto threads {query.threads > 0 ? query.threads : std::max(std::thread::hardware_concurrency(), 1u)};
+	threads = static_cast<unsigned>(std::min<std::size_t>(threads, tasks.size()));
+
+	std::vector<std::thread> workers;
+	for (unsigned i {1}; i < threads; ++i) {
+		workers.emplace_back(work);
+	}
+	work();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	for (std::size_t task {0}; task < tasks.size(); ++task) {
+		std::fwrite(results[task].data(), 1, results[task].size(), out);
+		stats.lines += lines[task];
+	}
+	std::fflush(out);
+	return stats;
+}
+
+namespace detail {
+
+auto find(std::string_view const haystack, std::string_view const needle) -> std::size_t
+{
+	if (needle.empty()) {
+		return 0;
+	}
+	if (needle.size() > haystack.size()) {
+		return std::string_view::npos;
+	}
+	if (needle.size() == 1) {
+		auto const* const at {static_cast<char const*>(std::memchr(haystack.data(), needle[0], haystack.size()))};
+		return at ? static_cast<std::size_t>(at - haystack.data()) : std::string_view::npos;
+	}
+#ifdef PROJECT_LOG_FIND_AVX2
+	if (HasAvx2) {
+		return avx2_find(haystack.data(), haystack.size(), needle);
+	}
+#endif
+	return scalar_find(haystack.data(), haystack.size(), needle);
+}
+
+}  // namespace detail
+
+}  // namespace project::log
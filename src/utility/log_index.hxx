@@ -0,0 +1,115 @@
+#ifndef LOG_INDEX_HXX
+#define LOG_INDEX_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>  // for std::FILE
+#include <string_view>
+
+#include <log.hxx>
+#include <log_sink.hxx>
+
+#include <project_dll-export.h>
+
+namespace project::log {
+
+/** @brief Where a block of consecutive records lies in a text log, and what it holds.
+
+    An index file is a header followed by one entry per block, in the order
+    the blocks were written (integers in host byte order):
+@code
+header: "PLIX" u16:version u16:0x0102
+entry:  IndexEntry
+@endcode
+ */
+struct IndexEntry
+{
+	std::uint64_t begin;  ///< Offset of the first record.
+	std::uint64_t end;  ///< Offset just past the last record.
+	std::uint64_t first;  ///< Earliest timestamp in the block, nanoseconds since the Unix epoch.
+	std::uint64_t last;  ///< Latest timestamp in this or any earlier block, so entries are sorted by it.
+	std::uint32_t records;
+	std::uint8_t levels;  ///< Bit 1 << Level set for each level in the block.
+	std::uint8_t reserved[3];
+};
+
+static_assert(sizeof(IndexEntry) == 40);
+
+/** @brief Writes an index entry for every \p every records of a text log.
+
+    The records after the last entry are not indexed; a search reads them
+    all. The open block is indexed when the writer is destroyed.
+ */
+class DLL IndexWriter
+{
+public:
+	static std::uint16_t constexpr Version {1};
+
+	/// Write the header to \p out, which must be opened in binary mode and outlive the writer.
+	IndexWriter(std::FILE* out, std::size_t every);
+	~IndexWriter();
+
+	IndexWriter(IndexWriter const&) = delete;
+	auto operator=(IndexWriter const&) -> IndexWriter& = delete;
+
+	/// Note that \p event was written as \p size bytes at \p offset, just after the previous record.
+	void add(Event const& event, std::uint64_t offset, std::size_t size);
+
+	void flush();
+
+private:
+	void write_entry();
+
+	std::FILE* _out;
+	std::size_t const _every;
+	IndexEntry _block {};
+	std::uint64_t _last {0};
+};
+
+/** @brief Read the entries of an index file held in memory, as by mmap().
+
+    @return nullptr if \p data is not an index written by IndexWriter;
+            else the entries, with their number in \p count.
+ */
+DLL auto index_entries(std::string_view data, std::size_t& count) -> IndexEntry const*;
+
+/// Which lines search() writes.
+struct Query
+{
+	std::uint64_t since {0};  ///< Earliest timestamp, nanoseconds since the Unix epoch.
+	std::uint64_t until {~std::uint64_t {0}};  ///< Latest timestamp, inclusive.
+	Level level {Level::Trace};  ///< Keep lines at this and more-severe levels.
+	std::string_view text;  ///< Keep lines which contain this. Empty: every line.
+	unsigned threads {1};  ///< Threads scanning the log. Zero: one per hardware thread.
+};
+
+struct QueryStats
+{
+	std::size_t lines;  ///< Lines written.
+	std::uint64_t scanned;  ///< Bytes of the log read, after skipping blocks by the index.
+};
+
+/** @brief Write the lines of \p log which match \p query to \p out, in order.
+
+    The index, of \p count entries, narrows the search to the blocks which
+    may hold a match: it is binary-searched for the first block at or after
+    \p query.since, and blocks holding none of the wanted levels are skipped.
+    Blocks are assumed written in timestamp order, to within a block.
+    Entries past the end of \p log are ignored.
+
+    The remaining ranges are split among the threads, and searched for
+    query.text with SIMD where the CPU has it. A line's level is the first
+    level name in it, as a word; its time the first "{time}" field (see
+    set_pattern()). Lines without a time pass the time filter.
+ */
+DLL auto search(std::string_view log, IndexEntry const* index, std::size_t count, Query const& query,
+                std::FILE* out) -> QueryStats;
+
+namespace detail {
+/// Offset of the first \p needle in \p haystack, or std::string_view::npos.
+DLL auto find(std::string_view haystack, std::string_view needle) -> std::size_t;
+}  // namespace detail
+
+}  // namespace project::log
+
+#endif  // LOG_INDEX_HXX
@@ -0,0 +1,122 @@
+#include "log_limit.hxx"
+
+#include <algorithm>  // for std::max
+
+namespace project::log {
+
+namespace {
+// Most recent first; never shrink.
+std::atomic<Deduplicator*> Deduplicators {nullptr};
+std::atomic<RateLimiter*> RateLimiters {nullptr};
+
+struct ReportOnExit
+{
+	~ReportOnExit()
+	{
+		detail::report_pending();
+	}
+};
+
+/// Push \p entry onto \p list once, with \p site; return false if it was already there.
+template <typename Entry>
+void enlist_once(std::atomic<Entry*>& list, Entry& entry, std::atomic<bool>& enlisted, Site const*& entry_site,
+                 Entry*& next, Site const& site)
+{
+	// Report counts still pending as this thread exits. For the main thread, that is at exit before any static
+	// object is destroyed, which std::atexit() could not promise.
+	thread_local ReportOnExit const report;
+
+	if (enlisted.load(std::memory_order_relaxed) || enlisted.exchange(true, std::memory_order_relaxed)) {
+		return;
+	}
+
+	entry_site = &site;
+	next = list.load(std::memory_order_relaxed);
+	while (!list.compare_exchange_weak(next, &entry, std::memory_order_release, std::memory_order_relaxed)) {
+	}
+}
+}  // namespace
+
+auto RateLimiter::admit(std::uint64_t const now) -> bool
+{
+	if (_interval == 0) {
+		return true;  // unlimited: a thread with an older now must not be held behind another's
+	}
+
+	auto full {_full.load(std::memory_order_relaxed)};
+
+	for (;;) {
+		auto const start {std::max(full, now)};
+
+		if (start - now > _tolerance) {
+			_suppressed.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		if (_full.compare_exchange_weak(full, start + _interval, std::memory_order_relaxed)) {
+			return true;
+		}
+	}
+}
+
+auto Deduplicator::repeated(std::string_view const message, std::uint64_t& ended) -> bool
+{
+	// FNV-1a; zero is reserved for "no message yet".
+	std::uint64_t hash {14695981039346656037u};
+	for (unsigned char const c : message) {
+		hash = (hash ^ c) * 1099511628211u;
+	}
+	hash |= hash == 0;
+
+	if (_last.exchange(hash, std::memory_order_relaxed) == hash) {
+		_repeats.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	ended = _repeats.exchange(0, std::memory_order_relaxed);
+	return false;
+}
+
+void RateLimiter::enlist(Site const& site)
+{
+	enlist_once(RateLimiters, *this, _enlisted, _site, _next, site);
+}
+
+void Deduplicator::enlist(Site const& site)
+{
+	enlist_once(Deduplicators, *this, _enlisted, _site, _next, site);
+}
+
+namespace detail {
+
+void report_suppressed(Site const& site, RateLimiter& limiter)
+{
+	if (auto const suppressed {limiter.take_suppressed()}; suppressed > 0) {
+		print(site, "{} messages suppressed", suppressed);
+	}
+}
+
+auto admit_limited(Site const& site, RateLimiter& limiter) -> bool
+{
+	if (!limiter.admit(now())) {
+		limiter.enlist(site);  // only once it has something to report
+		return false;
+	}
+	report_suppressed(site, limiter);
+	return true;
+}
+
+void report_pending()
+{
+	for (auto* entry {Deduplicators.load(std::memory_order_acquire)}; entry; entry = entry->_next) {
+		if (auto const repeats {entry->take_repeats()}; repeats > 0) {
+			print(*entry->_site, "last message repeated {} times", repeats);
+		}
+	}
+	for (auto* entry {RateLimiters.load(std::memory_order_acquire)}; entry; entry = entry->_next) {
+		report_suppressed(*entry->_site, *entry);
+	}
+}
+
+}  // namespace detail
+
+}  // namespace project::log
@@ -0,0 +1,222 @@
+#ifndef LOG_LIMIT_HXX
+#define LOG_LIMIT_HXX
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+#include <utility>  // for std::forward
+
+#include <fmt/format.h>
+
+#include <log.hxx>
+#include <log_sink.hxx>  // for detail::now
+
+#include <project_dll-export.h>
+
+namespace project::log {
+
+namespace detail {
+DLL void report_pending();
+}  // namespace detail
+
+/** @brief Admit one call in every N from a call site.
+
+    The first call is admitted. Costs one relaxed atomic increment.
+ */
+class Sampler
+{
+public:
+	explicit constexpr Sampler(std::uint64_t const n)
+	    : _n {n > 0 ? n : 1}
+	{}
+
+	auto admit() -> bool
+	{
+		return _calls.fetch_add(1, std::memory_order_relaxed) % _n == 0;
+	}
+
+private:
+	std::uint64_t const _n;
+	std::atomic<std::uint64_t> _calls {0};
+};
+
+/** @brief Token bucket admitting \p rate calls per second on average, in bursts of up to \p burst.
+
+    The bucket is kept as one atomic timestamp (the time at which it would be
+    full again), so admitting a call is a load and a compare-exchange.
+
+    A \p rate of zero or less, or above one per nanosecond, admits every call;
+    a \p burst of zero counts as one.
+
+    Once enlisted, suppressed calls not yet reported are also counted by
+    log::flush() and as a thread which logged through it exits, the main
+    thread at exit (see detail::report_pending()).
+ */
+class DLL RateLimiter
+{
+public:
+	constexpr RateLimiter(double const rate, std::uint32_t const burst)
+	    : _interval {rate > 0 ? static_cast<std::uint64_t>(1e9 / rate) : 0}
+	    , _tolerance {_interval * (burst > 0 ? burst - 1 : 0)}
+	{}
+
+	/// Admit a call made at \p now, in nanoseconds as from detail::now(), or count it as suppressed.
+	auto admit(std::uint64_t now) -> bool;
+
+	/// Number of calls suppressed since the last call to this function.
+	auto take_suppressed() -> std::uint64_t
+	{
+		return _suppressed.exchange(0, std::memory_order_relaxed);
+	}
+
+	/// Like Deduplicator::enlist(), for the calls this suppresses.
+	void enlist(Site const& site);
+
+private:
+	friend void detail::report_pending();
+
+	std::uint64_t const _interval;  // nanoseconds per token
+	std::uint64_t const _tolerance;  // how far ahead of now the bucket may be drawn
+	std::atomic<std::uint64_t> _full {0};  // when the bucket is full again
+	std::atomic<std::uint64_t> _suppressed {0};
+
+	std::atomic<bool> _enlisted {false};
+	Site const* _site {nullptr};
+	RateLimiter* _next {nullptr};  // in the list of enlisted rate limiters
+};
+
+/** @brief Collapse a run of identical messages from a call site into one line and a count.
+
+    Messages are compared by a 64-bit hash of their text. The count of a run
+    is reported as "last message repeated N times" when a different message
+    ends it; or, once enlisted, by log::flush() and as a thread which logged
+    through it exits, the main thread at exit (see detail::report_pending()).
+    The run then keeps counting anew.
+ */
+class DLL Deduplicator
+{
+public:
+	/** @brief Return true, counting \p message, if it repeats the previous message.
+
+	    Otherwise set \p ended to the repeats of the run it ends, and return false.
+	 */
+	auto repeated(std::string_view message, std::uint64_t& ended) -> bool;
+
+	/// Repeats counted and not yet reported, leaving none.
+	auto take_repeats() -> std::uint64_t
+	{
+		return _repeats.exchange(0, std::memory_order_relaxed);
+	}
+
+	/** @brief Have detail::report_pending() report runs from \p site, which must outlive this, from now on.
+
+	    Also have it called as the calling thread exits. Later calls only do the latter, for new threads.
+	 */
+	void enlist(Site const& site);
+
+private:
+	friend void detail::report_pending();
+
+	std::atomic<std::uint64_t> _last {0};
+	std::atomic<std::uint64_t> _repeats {0};
+
+	std::atomic<bool> _enlisted {false};
+	Site const* _site {nullptr};
+	Deduplicator* _next {nullptr};  // in the list of enlisted deduplicators
+};
+
+namespace detail {
+/// Emit a message from \p site if it does not repeat the previous one; see Deduplicator.
+template <typename... Args>
+void print_deduplicated(Site const& site, Deduplicator& deduplicator, Args&&... args)
+{
+	deduplicator.enlist(site);
+
+	fmt::memory_buffer buffer;
+	fmt::format_to(fmt::appender {buffer}, std::forward<Args>(args)...);
+	std::string_view const message {buffer.data(), buffer.size()};
+
+	std::uint64_t ended {0};
+	if (deduplicator.repeated(message, ended)) {
+		return;
+	}
+	if (ended > 0) {
+		print(site, "last message repeated {} times", ended);
+	}
+	print(site, "{}", message);
+}
+
+/// Emit "N messages suppressed" from \p site if \p limiter suppressed any since the last report.
+DLL void report_suppressed(Site const& site, RateLimiter& limiter);
+
+/** @brief Admit a call from \p site, now, through \p limiter; see RateLimiter.
+
+    Report the calls it suppressed before admitting this one, or enlist it to
+    have them reported if it suppresses this one.
+ */
+DLL auto admit_limited(Site const& site, RateLimiter& limiter) -> bool;
+
+/** @brief Emit the counts not yet reported by each enlisted Deduplicator and RateLimiter.
+
+    "last message repeated N times" for runs of repeats, and "N messages
+    suppressed" for calls a rate limiter suppressed.
+ */
+DLL void report_pending();
+}  // namespace detail
+
+}  // namespace project::log
+
+/** @brief Like PROJECT_LOG_AT(), but emit only the 1st, (n+1)th, (2n+1)th... enabled call.
+
+    Calls at disabled levels are not counted.
+ */
+#define PROJECT_LOG_EVERY_N(level, n, ...) \
+	do { \
+		if constexpr (::project::log::compiled(level)) { \
+			if (PROJECT_LOG_UNLIKELY(::project::log::enabled(level))) { \
+				static ::project::log::Sampler project_log_sampler {n}; \
+				if (project_log_sampler.admit()) { \
+					static ::project::log::Site constexpr project_log_site {__FILE__, __LINE__, __func__, level}; \
+					::project::log::print(project_log_site, __VA_ARGS__); \
+				} \
+			} \
+		} \
+	} while (false)
+
+/** @brief Like PROJECT_LOG_AT(), but emit at most \p rate calls per second, in bursts of up to \p burst.
+
+    The next message emitted after some were suppressed is preceded by
+    "N messages suppressed"; a count still pending is reported by log::flush()
+    and at exit. Suppressed calls do not evaluate their arguments.
+    A \p rate of zero or less does not limit; see log::RateLimiter.
+ */
+#define PROJECT_LOG_RATE_LIMITED(level, rate, burst, ...) \
+	do { \
+		if constexpr (::project::log::compiled(level)) { \
+			if (PROJECT_LOG_UNLIKELY(::project::log::enabled(level))) { \
+				static ::project::log::RateLimiter project_log_limiter {rate, burst}; \
+				static ::project::log::Site constexpr project_log_site {__FILE__, __LINE__, __func__, level}; \
+				if (::project::log::detail::admit_limited(project_log_site, project_log_limiter)) { \
+					::project::log::print(project_log_site, __VA_ARGS__); \
+				} \
+			} \
+		} \
+	} while (false)
+
+/** @brief Like PROJECT_LOG_AT(), but collapse runs of identical messages; see log::Deduplicator.
+
+    Every enabled call formats its message, to compare it with the previous one.
+    The count of a run still going is reported by log::flush() and at exit.
+ */
+#define PROJECT_LOG_DEDUPLICATED(level, ...) \
+	do { \
+		if constexpr (::project::log::compiled(level)) { \
+			if (PROJECT_LOG_UNLIKELY(::project::log::enabled(level))) { \
+				static ::project::log::Deduplicator project_log_deduplicator; \
+				static ::project::log::Site constexpr project_log_site {__FILE__, __LINE__, __func__, level}; \
+				::project::log::detail::print_deduplicated(project_log_site, project_log_deduplicator, __VA_ARGS__); \
+			} \
+		} \
+	} while (false)
+
+#endif  // LOG_LIMIT_HXX
@@ -0,0 +1,215 @@
+#include "log_mapped.hxx"
+
+#include <algorithm>  // for std::min
+#include <cerrno>
+#include <cstdio>
+#include <cstring>  // for std::memcpy
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <mpsc_ring.hxx>  // for detail::CacheLine
+
+namespace project::log {
+
+struct MappedFileSink::Segment
+{
+	std::string path;
+	int fd {-1};
+	char* data {nullptr};
+	std::size_t size {0};
+	std::uint64_t opened {0};  // nanoseconds since the Unix epoch, like Event::timestamp
+
+	alignas(project::detail::CacheLine) std::atomic<std::size_t> reserved {0};  // bytes claimed by writers
+	alignas(project::detail::CacheLine) std::atomic<std::size_t> committed {0};  // bytes copied in
+};
+
+MappedFileSink::MappedFileSink(MappedFileOptions options)
+    : _options {std::move(options)}
+{
+	if (_options.segment_size == 0) {
+		throw std::invalid_argument {"MappedFileOptions::segment_size must not be zero"};
+	}
+
+	std::lock_guard const lock {_mutex};
+
+	_owned = open_next();
+	if (!_owned) {
+		throw std::system_error {errno, std::generic_category(), "cannot create log segment for " + _options.path};
+	}
+	_current.store(_owned.get(), std::memory_order_release);
+}
+
+MappedFileSink::~MappedFileSink()
+{
+	std::lock_guard const lock {_mutex};
+
+	if (_owned) {
+		seal(*_owned, std::min(_owned->reserved.load(std::memory_order_relaxed), _owned->size));
+	}
+}
+
+void MappedFileSink::write(Event const& event)
+{
+	std::optional<fmt::memory_buffer> spare;
+	auto& buffer {detail::ThreadBuffer<MappedFileSink>::get(spare)};
+	format_text(buffer, event);
+	append(buffer.data(), buffer.size(), event.timestamp);
+}
+
+void MappedFileSink::flush()
+{
+	std::lock_guard const lock {_mutex};
+
+	if (_owned) {
+		::msync(_owned->data, _owned->size, MS_ASYNC);
+	}
+}
+
+auto MappedFileSink::segments() const -> std::deque<std::string>
+{
+	std::lock_guard const lock {_mutex};
+	return _paths;
+}
+
+void MappedFileSink::append(char const* data, std::size_t size, std::uint64_t const timestamp)
+{
+	size = std::min(size, _options.segment_size);  // a message never spans segments
+
+	for (;;) {
+		auto* const segment {_current.load(std::memory_order_acquire)};
+
+		if (!segment) {
+			std::fwrite(data, 1, size, get_target());
+			return;
+		}
+
+		auto const max_age {static_cast<std::uint64_t>(_options.max_age.count())};
+		bool const expired {max_age > 0 && timestamp > segment->opened && timestamp - segment->opened >= max_age};
+
+		// An expired segment is claimed past its end at once, so exactly one writer crosses it and rotates it.
+		auto const claim {expired ? segment->size + 1 : size};
+		auto const offset {segment->reserved.fetch_add(claim, std::memory_order_relaxed)};
+
+		if (!expired && offset + size <= segment->size) {
+			std::memcpy(segment->data + offset, data, size);
+			segment->committed.fetch_add(size, std::memory_order_release);
+			return;
+		}
+
+		// Claims are never empty, so only the first claim to pass the end starts at or before it.
+		if (offset <= segment->size) {
+			rotate(segment, offset);
+		}
+		else {
+			while (_current.load(std::memory_order_acquire) == segment) {
+				std::this_thread::yield();  // another writer is rotating
+			}
+		}
+	}
+}
+
+void MappedFileSink::rotate(Segment* full, std::size_t const end)
+{
+	std::lock_guard const lock {_mutex};
+
+	if (_current.load(std::memory_order_relaxed) != full) {
+		return;  // already rotated; sealing it again would wait for bytes never written
+	}
+
+	auto next {open_next()};
+
+	if (!next) {
+		auto const message {fmt::format("{}: cannot create log segment for {}: {}\n", level_label(Level::Error),
+		                                _options.path, std::strerror(errno))};
+		std::fwrite(message.data(), 1, message.size(), get_target());
+	}
+
+	_current.store(next.get(), std::memory_order_release);
+	std::swap(_owned, next);  // next now owns the full segment
+
+	seal(*full, end);
+	_sealed.push_back(std::move(next));
+
+	while (_options.keep > 0 && _paths.size() > _options.keep) {
+		::unlink(_paths.front().c_str());
+		_paths.pop_front();
+	}
+}
+
+void MappedFileSink::seal(Segment& segment, std::size_t const end)
+{
+	while (segment.committed.load(std::memory_order_acquire) < end) {
+		std::this_thread::yield();  // writers which reserved space before the end are still copying
+	}
+
+	::msync(segment.data, segment.size, MS_ASYNC);
+	::madvise(segment.data, segment.size, MADV_DONTNEED);
+	::munmap(segment.data, segment.size);
+	segment.data = nullptr;
+
+	// Should this fail, the file keeps its zero padding after the last message.
+	[[maybe_unused]] auto const truncated {::ftruncate(segment.fd, static_cast<off_t>(end))};
+	::close(segment.fd);
+	segment.fd = -1;
+}
+
+auto MappedFileSink::open_next() -> std::unique_ptr<Segment>
+{
+	auto segment {std::make_unique<Segment>()};
+	segment->size = _options.segment_size;
+
+	for (;;) {
+		segment->path = fmt::format("{}.{}.log", _options.path, ++_index);
+		segment->fd = ::open(segment->path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+
+		if (segment->fd >= 0) {
+			break;
+		}
+		if (errno != EEXIST) {
+			return nullptr;  // keep errno for the caller
+		}
+	}
+
+	auto const fail {[&] {
+		auto const error {errno};
+		::close(segment->fd);
+		::unlink(segment->path.c_str());
+		errno = error;
+		return nullptr;
+	}};
+
+	auto const length {static_cast<off_t>(segment->size)};
+
+#if defined(__linux__)
+	// Reserve disk blocks now, so a full disk fails here instead of faulting a writer later.
+	if (auto const error {::posix_fallocate(segment->fd, 0, length)}; error != 0) {
+		if (::ftruncate(segment->fd, length) != 0) {
+			return fail();
+		}
+	}
+#else
+	if (::ftruncate(segment->fd, length) != 0) {
+		return fail();
+	}
+#endif
+
+	void* const data {::mmap(nullptr, segment->size, PROT_READ | PROT_WRITE, MAP_SHARED, segment->fd, 0)};
+	if (data == MAP_FAILED) {
+		return fail();
+	}
+
+	segment->data = static_cast<char*>(data);
+	segment->opened = detail::now();
+	::madvise(segment->data, segment->size, MADV_SEQUENTIAL);
+
+	_paths.push_back(segment->path);
+	return segment;
+}
+
+}  // namespace project::log
@@ -0,0 +1,88 @@
+#ifndef LOG_MAPPED_HXX
+#define LOG_MAPPED_HXX
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>  // for std::unique_ptr
+#include <mutex>
+#include <string>
+
+#include <log_sink.hxx>
+
+#include <project_dll-export.h>
+
+namespace project::log {
+
+struct MappedFileOptions
+{
+	/// Segments are named "<path>.<N>.log", N counting up from the first unused number.
+	std::string path;
+
+	/// Bytes per segment; a segment is full once the next message would not fit.
+	std::size_t segment_size {std::size_t {64} << 20};
+
+	/// Start a new segment once the current one is this old. Zero: rotate by size only.
+	std::chrono::nanoseconds max_age {0};
+
+	/// Delete the oldest segments written by this sink beyond this count. Zero: keep all.
+	std::size_t keep {0};
+};
+
+/** @brief Sink which writes text into memory-mapped, fixed-size file segments.
+
+    Each segment is preallocated and mapped once. A writer reserves its byte
+    range with one atomic add, then copies its message into the mapping, so
+    logging costs no system call until a segment fills or ages out. The writer
+    whose reservation crosses the end of a segment opens the next one, then
+    seals the old one: it waits for other writers to finish copying, flushes
+    and unmaps it, and truncates the file to the bytes written.
+
+    If a segment cannot be created, messages fall back to the log target.
+
+    Available on POSIX systems only.
+ */
+class DLL MappedFileSink : public Sink
+{
+public:
+	/// Create the first segment. Throw std::system_error if it cannot be created.
+	explicit MappedFileSink(MappedFileOptions options);
+	~MappedFileSink() override;
+
+	MappedFileSink(MappedFileSink const&) = delete;
+	auto operator=(MappedFileSink const&) -> MappedFileSink& = delete;
+
+	void write(Event const& event) override;
+
+	/// Schedule written bytes for writeback (msync with MS_ASYNC).
+	void flush() override;
+
+	/// Paths of the segments written by this sink and not deleted, oldest first.
+	auto segments() const -> std::deque<std::string>;
+
+private:
+	struct Segment;
+
+	void append(char const* data, std::size_t size, std::uint64_t timestamp);
+	void rotate(Segment* full, std::size_t end);
+	void seal(Segment& segment, std::size_t end);
+	auto open_next() -> std::unique_ptr<Segment>;
+
+	MappedFileOptions const _options;
+	std::size_t _index {0};  // of the last segment opened; guarded by _mutex
+
+	std::atomic<Segment*> _current {nullptr};
+	std::unique_ptr<Segment> _owned;  // the current segment; guarded by _mutex
+
+	// Writers may still hold a pointer to a sealed segment (never to its mapping), so keep it allocated.
+	std::deque<std::unique_ptr<Segment>> _sealed;
+	std::deque<std::string> _paths;
+
+	mutable std::mutex _mutex;  // held to rotate, flush, or list segments; never to write
+};
+
+}  // namespace project::log
+
+#endif  // LOG_MAPPED_HXX
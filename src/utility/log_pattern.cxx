@@ -0,0 +1,219 @@
+#include "log_pattern.hxx"
+
+#include <algorithm>  // for std::find_if
+#include <atomic>
+#include <ctime>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#include <fmt/chrono.h>  // for fmt::localtime
+
+namespace project::log {
+
+namespace {
+
+std::uint64_t constexpr NanosPerSecond {1'000'000'000};
+
+}  // namespace
+
+namespace detail {
+
+void append_time(fmt::memory_buffer& out, std::uint64_t const timestamp)
+{
+	struct Cache
+	{
+		std::uint64_t second {~std::uint64_t {0}};
+		char text[32];
+		std::size_t size {0};
+	};
+	thread_local Cache cache;
+
+	auto const second {timestamp / NanosPerSecond};
+
+	if (second != cache.second) {
+		std::tm const time {fmt::localtime(static_cast<std::time_t>(second))};
+		cache.size = fmt::format_to_n(cache.text, sizeof cache.text, "{:%Y-%m-%d %H:%M:%S}", time).size;
+		cache.second = second;
+	}
+	out.append(cache.text, cache.text + cache.size);
+
+	char fraction[] {".000000"};
+	auto micros {(timestamp % NanosPerSecond) / 1000};
+	for (auto i {sizeof fraction - 2}; i > 0; --i, micros /= 10) {
+		fraction[i] = static_cast<char>('0' + micros % 10);
+	}
+	out.append(fraction, fraction + sizeof fraction - 1);
+}
+
+}  // namespace detail
+
+namespace {
+
+void append(fmt::memory_buffer& out, char const* text)
+{
+	if (text) {
+		out.append(std::string_view {text});
+	}
+}
+
+}  // namespace
+
+Pattern::Pattern(std::string_view const pattern)
+    : _text {pattern}
+    , _message {0}
+{
+	static std::pair<std::string_view, Field> constexpr fields[] {
+	    {"time", Field::Time},
+	    {"level", Field::Level},
+	    {"thread", Field::Thread},
+	    {"message", Field::Message},
+	    {"file", Field::File},
+	    {"line", Field::Line},
+	    {"function", Field::Function},
+	    {"category", Field::Category},
+	};
+
+	auto const literal {[&](char const c) {
+		if (_tokens.empty() || _tokens.back().field != Field::Literal) {
+			_tokens.push_back({Field::Literal, _literals.size(), 0});
+		}
+		_literals.push_back(c);
+		++_tokens.back().size;
+	}};
+
+	bool has_message {false};
+
+	for (std::size_t i {0}; i < pattern.size(); ++i) {
+		auto const c {pattern[i]};
+
+		if ((c == '{' || c == '}') && i + 1 < pattern.size() && pattern[i + 1] == c) {
+			literal(c);
+			++i;
+		}
+		else if (c == '{') {
+			auto const end {pattern.find('}', i)};
+			if (end == std::string_view::npos) {
+				throw std::invalid_argument {fmt::format("log pattern has an unclosed brace: {}", pattern)};
+			}
+
+			auto const name {pattern.substr(i + 1, end - i - 1)};
+			auto const* found {std::find_if(std::begin(fields), std::end(fields),
+			                                [&](auto const& field) { return field.first == name; })};
+			if (found == std::end(fields)) {
+				throw std::invalid_argument {fmt::format("log pattern has an unknown field: {{{}}}", name)};
+			}
+			if (found->second == Field::Message) {
+				if (has_message) {
+					throw std::invalid_argument {"log pattern has more than one {message}"};
+				}
+				has_message = true;
+				_message = _tokens.size();
+			}
+
+			_tokens.push_back({found->second, 0, 0});
+			i = end;
+		}
+		else if (c == '}') {
+			throw std::invalid_argument {fmt::format("log pattern has an unmatched closing brace: {}", pattern)};
+		}
+		else {
+			literal(c);
+		}
+	}
+
+	if (!has_message) {
+		throw std::invalid_argument {"log pattern has no {message}"};
+	}
+}
+
+void Pattern::format_prefix(fmt::memory_buffer& out, Event const& event) const
+{
+	format(out, event, 0, _message);
+}
+
+void Pattern::format_suffix(fmt::memory_buffer& out, Event const& event) const
+{
+	format(out, event, _message + 1, _tokens.size());
+}
+
+void Pattern::format(fmt::memory_buffer& out, Event const& event, std::size_t const begin, std::size_t const end) const
+{
+	auto const* site {event.site};
+
+	for (auto i {begin}; i < end; ++i) {
+		auto const& token {_tokens[i]};
+
+		switch (token.field) {
+		case Field::Literal:
+			out.append(_literals.data() + token.begin, _literals.data() + token.begin + token.size);
+			break;
+		case Field::Time: detail::append_time(out, event.timestamp); break;
+		case Field::Level: out.append(level_label(event.level)); break;
+		case Field::Thread: fmt::format_to(fmt::appender {out}, "{}", event.thread); break;
+		case Field::Message: format_message(out, event); break;
+		case Field::File: append(out, site ? site->file : nullptr); break;
+		case Field::Line:
+			if (site) {
+				fmt::format_to(fmt::appender {out}, "{}", site->line);
+			}
+			break;
+		case Field::Function: append(out, site ? site->function : nullptr); break;
+		case Field::Category: append(out, site ? site->category : nullptr); break;
+		}
+	}
+}
+
+namespace {
+
+struct Patterns
+{
+	std::mutex mutex;
+	std::vector<std::unique_ptr<Pattern const>> all;  // every pattern ever set; lines may still use any of them
+};
+
+auto patterns() -> Patterns&
+{
+	static Patterns instance;
+	return instance;
+}
+
+std::atomic<Pattern const*> CurrentPattern {nullptr};  // nullptr: the default pattern
+
+auto default_pattern() -> Pattern const&
+{
+	static Pattern const instance {"{level}: {message}"};
+	return instance;
+}
+
+}  // namespace
+
+void set_pattern(std::string_view const pattern)
+{
+	auto compiled {std::make_unique<Pattern const>(pattern)};  // throws before anything changes
+
+	auto& [mutex, all] {patterns()};
+	std::lock_guard const lock {mutex};
+
+	CurrentPattern.store(compiled.get(), std::memory_order_release);
+	all.push_back(std::move(compiled));
+}
+
+auto get_pattern() -> std::string
+{
+	return std::string {detail::current_pattern().text()};
+}
+
+namespace detail {
+
+auto current_pattern() -> Pattern const&
+{
+	auto const* pattern {CurrentPattern.load(std::memory_order_acquire)};
+	return pattern ? *pattern : default_pattern();
+}
+
+}  // namespace detail
+
+}  // namespace project::log
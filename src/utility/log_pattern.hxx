@@ -0,0 +1,97 @@
+#ifndef LOG_PATTERN_HXX
+#define LOG_PATTERN_HXX
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <log_sink.hxx>
+
+#include <project_dll-export.h>
+
+namespace project::log {
+
+/** @brief Text layout of a log line, compiled once from a pattern string.
+
+    Fields are written in braces; everything else is copied as-is, with "{{"
+    and "}}" standing for literal braces. The line ends after the pattern.
+@code
+{time}      2024-01-31 23:59:59.123456 (local time)
+{level}     Info
+{thread}    OS thread id of the emitting thread
+{message}   the formatted message
+{file} {line} {function} {category}
+            call site, if captured by a PROJECT_LOG_* macro; else empty
+@endcode
+    The default pattern is "{level}: {message}".
+ */
+class DLL Pattern
+{
+public:
+	/// Throw std::invalid_argument if \p pattern has an unknown field, unbalanced braces, or no {message}.
+	explicit Pattern(std::string_view pattern);
+
+	auto text() const -> std::string_view
+	{
+		return _text;
+	}
+
+	/// Append the fields before {message}.
+	void format_prefix(fmt::memory_buffer& out, Event const& event) const;
+
+	/// Append the fields after {message}, without a newline.
+	void format_suffix(fmt::memory_buffer& out, Event const& event) const;
+
+private:
+	enum class Field : std::uint8_t
+	{
+		Literal,
+		Time,
+		Level,
+		Thread,
+		Message,
+		File,
+		Line,
+		Function,
+		Category,
+	};
+
+	struct Token
+	{
+		Field field;
+		std::size_t begin;  // Literal: range of _literals
+		std::size_t size;
+	};
+
+	void format(fmt::memory_buffer& out, Event const& event, std::size_t begin, std::size_t end) const;
+
+	std::string _text;
+	std::string _literals;
+	std::vector<Token> _tokens;
+	std::size_t _message;  // index of the {message} token
+};
+
+/** @brief Compile \p pattern and use it for every line formatted from now on.
+
+    Throw std::invalid_argument, keeping the current pattern, if \p pattern is invalid.
+ */
+DLL void set_pattern(std::string_view pattern);
+DLL auto get_pattern() -> std::string;
+
+namespace detail {
+/** @brief Append "YYYY-MM-DD HH:MM:SS.uuuuuu" in local time.
+
+    The part up to the seconds is formatted once per second, per thread.
+ */
+void append_time(fmt::memory_buffer& out, std::uint64_t timestamp);
+
+/// The current pattern. Replaced patterns stay alive until exit, like replaced sinks.
+auto current_pattern() -> Pattern const&;
+}  // namespace detail
+
+}  // namespace project::log
+
+#endif  // LOG_PATTERN_HXX
@@ -0,0 +1,268 @@
+#include "log_reload.hxx"
+
+#include <algorithm>  // for std::max
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>  // for std::pair
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>  // for sigaction
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include <fmt/format.h>
+
+#include "log_category.hxx"
+#include "log_fields.hxx"
+
+namespace project::log {
+
+namespace {
+
+char constexpr Reload {'r'};
+char constexpr Stop {'s'};
+
+std::atomic<int> WakeFd {-1};  // write end of the watcher's pipe, for the SIGHUP handler
+
+void on_sighup(int)
+{
+	auto const fd {WakeFd.load(std::memory_order_relaxed)};
+	if (fd >= 0) {
+		auto const error {errno};
+		// If the pipe is full, a reload is pending anyway.
+		[[maybe_unused]] auto const written {::write(fd, &Reload, 1)};
+		errno = error;
+	}
+}
+
+/// Read the level spec in the file at \p path, as one comma-separated line.
+auto read_spec(std::string const& path) -> std::string
+{
+	std::FILE* in {std::fopen(path.c_str(), "r")};
+	if (!in) {
+		throw std::system_error {errno, std::generic_category(), "cannot read log levels from " + path};
+	}
+
+	std::string spec;
+	bool comment {false};
+	for (int c {std::fgetc(in)}; c != EOF; c = std::fgetc(in)) {
+		if (c == '\n') {
+			comment = false;
+			spec += ',';
+		}
+		else if (c == '#') {
+			comment = true;
+		}
+		else if (!comment && c != '\r') {
+			spec += static_cast<char>(c);
+		}
+	}
+
+	bool const failed {std::ferror(in) != 0};
+	std::fclose(in);
+	if (failed) {
+		throw std::system_error {EIO, std::generic_category(), "cannot read log levels from " + path};
+	}
+	return spec;
+}
+
+/// Reload from \p path on the watcher thread, reporting the outcome.
+void reload_logged(std::string const& path)
+{
+	static Site constexpr site {__FILE__, __LINE__, "reload", Level::Info, "log"};
+
+	try {
+		auto const& config {configure(read_spec(path))};
+		if (enabled(Level::Info)) {
+			print(site, "reloaded log levels", kv("path", path), kv("spec", config.spec));
+		}
+	} catch (std::exception const& e) {
+		auto const message {fmt::format("{}: cannot reload log levels: {}\n", level_label(Level::Error), e.what())};
+		std::fwrite(message.data(), 1, message.size(), get_target());
+		std::fflush(get_target());
+	}
+}
+
+/// Modification time and size of the file at \p path, to notice changes without inotify.
+auto stamp(std::string const& path) -> std::pair<std::int64_t, std::int64_t>
+{
+	struct ::stat status {};
+	if (::stat(path.c_str(), &status) != 0) {
+		return {-1, -1};
+	}
+	return {static_cast<std::int64_t>(status.st_mtime), static_cast<std::int64_t>(status.st_size)};
+}
+
+struct Watcher
+{
+	~Watcher()
+	{
+		stop();
+	}
+
+	void stop()
+	{
+		if (!thread.joinable()) {
+			return;
+		}
+
+		if (sighup) {
+			WakeFd.store(-1, std::memory_order_relaxed);
+			::sigaction(SIGHUP, &previous, nullptr);
+			sighup = false;
+		}
+
+		[[maybe_unused]] auto const written {::write(wake[1], &Stop, 1)};
+		thread.join();
+
+		for (auto const fd : {wake[0], wake[1], notify}) {
+			if (fd >= 0) {
+				::close(fd);
+			}
+		}
+		wake[0] = wake[1] = notify = -1;
+	}
+
+	void run()
+	{
+		auto last {stamp(options.path)};
+		std::string const name {options.path.substr(options.path.find_last_of('/') + 1)};
+
+		for (;;) {
+			::pollfd fds[2] {{wake[0], POLLIN, 0}, {notify, POLLIN, 0}};
+			bool const polling {options.watch && notify < 0};
+			int const ready {::poll(fds, notify >= 0 ? 2 : 1, polling ? 1000 : -1)};
+
+			if (ready < 0 && errno != EINTR) {
+				return;
+			}
+
+			bool changed {false};
+
+			if (fds[0].revents & POLLIN) {
+				char commands[64];
+				auto const count {::read(wake[0], commands, sizeof commands)};
+				for (::ssize_t i {0}; i < count; ++i) {
+					if (commands[i] == Stop) {
+						return;
+					}
+					changed = true;
+				}
+			}
+
+#ifdef __linux__
+			if (notify >= 0 && (fds[1].revents & POLLIN)) {
+				alignas(::inotify_event) char events[4096];
+				auto const size {::read(notify, events, sizeof events)};
+				for (::ssize_t at {0}; at < size;) {
+					auto const* const event {reinterpret_cast<::inotify_event const*>(events + at)};
+					if (event->len > 0 && name == event->name) {
+						changed = true;
+					}
+					at += static_cast<::ssize_t>(sizeof(::inotify_event) + event->len);
+				}
+			}
+#endif
+
+			if (polling) {
+				auto const now {stamp(options.path)};
+				changed = changed || now != last;
+				last = now;
+			}
+
+			if (changed) {
+				reload_logged(options.path);
+			}
+		}
+	}
+
+	std::thread thread;
+	ReloadOptions options;
+	int wake[2] {-1, -1};  // pipe: the SIGHUP handler and stop() write commands to it
+	int notify {-1};  // inotify descriptor watching the file's directory, if any
+	bool sighup {false};
+	struct sigaction previous {};
+};
+
+auto watcher() -> Watcher&
+{
+	static Watcher instance;
+	return instance;
+}
+
+std::mutex Control;  // held by start_reload() and stop_reload()
+
+}  // namespace
+
+void reload(std::string const& path)
+{
+	configure(read_spec(path));
+}
+
+void start_reload(ReloadOptions options)
+{
+	std::lock_guard const lock {Control};
+
+	reload(options.path);  // also constructs the category registry before the watcher, so it is destroyed after
+
+	auto& instance {watcher()};
+	instance.stop();
+	instance.options = std::move(options);
+
+	if (::pipe(instance.wake) != 0) {
+		throw std::system_error {errno, std::generic_category(), "cannot watch log levels"};
+	}
+	for (auto const fd : instance.wake) {
+		::fcntl(fd, F_SETFD, FD_CLOEXEC);
+		::fcntl(fd, F_SETFL, O_NONBLOCK);
+	}
+
+#ifdef __linux__
+	if (instance.options.watch) {
+		// Watch the directory, so a file replaced by rename, as editors save, is still seen.
+		auto const& path {instance.options.path};
+		auto const slash {path.find_last_of('/')};
+		auto const directory {slash == std::string::npos ? std::string {"."}
+		                                                  : path.substr(0, std::max<std::size_t>(slash, 1))};
+
+		instance.notify = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+		if (instance.notify >= 0
+		    && ::inotify_add_watch(instance.notify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+			::close(instance.notify);
+			instance.notify = -1;  // fall back to checking the modification time
+		}
+	}
+#endif
+
+	if (instance.options.sighup) {
+		WakeFd.store(instance.wake[1], std::memory_order_relaxed);
+
+		struct sigaction action {};
+		action.sa_handler = on_sighup;
+		action.sa_flags = SA_RESTART;
+		::sigemptyset(&action.sa_mask);
+		::sigaction(SIGHUP, &action, &instance.previous);
+		instance.sighup = true;
+	}
+
+	instance.thread = std::thread {[&instance] { instance.run(); }};
+}
+
+void stop_reload()
+{
+	std::lock_guard const lock {Control};
+	watcher().stop();
+}
+
+}  // namespace project::log
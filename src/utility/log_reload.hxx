@@ -0,0 +1,49 @@
+#ifndef LOG_RELOAD_HXX
+#define LOG_RELOAD_HXX
+
+#include <string>
+
+#include <project_dll-export.h>
+
+namespace project::log {
+
+/// What makes a running process re-read its log levels; see start_reload().
+struct ReloadOptions
+{
+	/** Level spec file: entries as for parse_levels(), separated by commas or
+	    newlines, with '#' starting a comment which runs to the end of the line.
+	 */
+	std::string path;
+
+	/// Reload when the file is written or replaced: seen by inotify on Linux, else by polling its modification time.
+	bool watch {true};
+
+	/// Reload on SIGHUP.
+	bool sighup {true};
+};
+
+/** @brief Apply the level spec in a file, and again whenever it changes or SIGHUP arrives.
+
+    The file is applied now with configure(): throw std::system_error if it
+    cannot be read, or std::invalid_argument if it is invalid. Later reloads
+    run on a background thread; one which fails is reported on the log target,
+    keeping the current levels. A reload which succeeds is logged at Info, in
+    category "log".
+
+    Logging threads never wait for a reload: they read levels with relaxed
+    loads, and current_config() with an acquire load.
+
+    Calling it again replaces the previous file and triggers. Available on
+    POSIX systems only.
+ */
+DLL void start_reload(ReloadOptions options);
+
+/// Stop reloading, and restore the SIGHUP handler replaced by start_reload().
+DLL void stop_reload();
+
+/// Apply the level spec in the file at \p path with configure(). Throw as start_reload().
+DLL void reload(std::string const& path);
+
+}  // namespace project::log
+
+#endif  // LOG_RELOAD_HXX
@@ -0,0 +1,299 @@
+#include "log_shm.hxx"
+
+#include <algorithm>  // for std::max, std::min
+#include <atomic>
+#include <cerrno>
+#include <cstring>  // for std::memcpy
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <mpsc_ring.hxx>  // for detail::CacheLine
+
+namespace project::log {
+
+namespace detail {
+
+struct ShmHeader
+{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t slot_size;
+	std::uint64_t slot_count;  // a power of two
+
+	alignas(project::detail::CacheLine) std::atomic<std::uint64_t> head;  // positions claimed by writers
+	alignas(project::detail::CacheLine) std::atomic<std::uint32_t> closed;  // set when the sink is destroyed
+};
+
+/// Followed by the text of the line, up to the end of the slot.
+struct ShmSlot
+{
+	std::atomic<std::uint64_t> sequence;  // 2p+1 while position p is written, 2p+2 once complete
+	std::atomic<std::uint32_t> size;
+};
+
+}  // namespace detail
+
+namespace {
+
+using detail::ShmHeader;
+using detail::ShmSlot;
+
+// Both processes map the same atomics; only lock-free ones work across processes.
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+char constexpr Magic[8] {'P', 'L', 'O', 'G', 'S', 'H', 'M', '\0'};
+std::uint32_t constexpr Version {1};
+
+std::size_t constexpr HeaderSize {(sizeof(ShmHeader) + project::detail::CacheLine - 1)
+                                  & ~(project::detail::CacheLine - 1)};
+
+std::uint64_t constexpr StallTimeout {1'000'000'000};  // nanoseconds before a slot left half-written is skipped
+int constexpr ClaimSpins {1024};  // yields before a writer gives up on a slot still being written
+
+auto slot_at(void* data, ShmHeader const& header, std::uint64_t const position) -> ShmSlot&
+{
+	auto* const slots {static_cast<char*>(data) + HeaderSize};
+	return *reinterpret_cast<ShmSlot*>(slots + (position & (header.slot_count - 1)) * header.slot_size);
+}
+
+auto text_of(ShmSlot const& slot) -> char const*
+{
+	return reinterpret_cast<char const*>(&slot) + sizeof(ShmSlot);
+}
+
+[[noreturn]] void fail(std::string const& what)
+{
+	throw std::system_error {errno, std::generic_category(), what};
+}
+
+}  // namespace
+
+SharedMemorySink::SharedMemorySink(SharedMemoryOptions options)
+    : _name {std::move(options.name)}
+    , _data {nullptr}
+    , _size {0}
+    , _header {nullptr}
+{
+	auto const line {project::detail::CacheLine};
+	auto const slot_size {std::max((options.slot_size + line - 1) & ~(line - 1), line)};
+
+	std::size_t slot_count {2};
+	while (slot_count < options.slot_count) {
+		slot_count <<= 1;
+	}
+
+	_size = HeaderSize + slot_count * slot_size;
+
+	::shm_unlink(_name.c_str());  // start afresh; a reader of the old object keeps its mapping
+
+	int const fd {::shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600)};
+	if (fd < 0) {
+		fail("cannot create shared memory " + _name);
+	}
+
+	if (::ftruncate(fd, static_cast<off_t>(_size)) != 0) {
+		auto const error {errno};
+		::close(fd);
+		::shm_unlink(_name.c_str());
+		errno = error;
+		fail("cannot size shared memory " + _name);
+	}
+
+	_data = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	auto const error {errno};
+	::close(fd);
+
+	if (_data == MAP_FAILED) {
+		::shm_unlink(_name.c_str());
+		errno = error;
+		fail("cannot map shared memory " + _name);
+	}
+
+	// The object is zero-filled: every slot starts with sequence 0, i.e. never written.
+	_header = new (_data) ShmHeader {};
+	_header->version = Version;
+	_header->slot_size = static_cast<std::uint32_t>(slot_size);
+	_header->slot_count = slot_count;
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(_header->magic, Magic, sizeof Magic);  // last: a reader checks it first
+}
+
+SharedMemorySink::~SharedMemorySink()
+{
+	_header->closed.store(1, std::memory_order_release);
+	::munmap(_data, _size);
+	::shm_unlink(_name.c_str());
+}
+
+void SharedMemorySink::write(Event const& event)
+{
+	std::optional<fmt::memory_buffer> spare;
+	auto& buffer {detail::ThreadBuffer<SharedMemorySink>::get(spare)};
+	format_text(buffer, event);
+
+	auto const position {_header->head.fetch_add(1, std::memory_order_relaxed)};
+	auto& slot {slot_at(_data, *_header, position)};
+	auto* const text {reinterpret_cast<char*>(&slot) + sizeof(ShmSlot)};
+
+	// Once the ring wraps, the writer a lap behind may still be copying into this slot: take it only once its
+	// sequence is even. One a lap ahead may have taken it already, in which case this line is overwritten anyway.
+	auto const claimed {2 * position + 1};
+	auto sequence {slot.sequence.load(std::memory_order_relaxed)};
+	for (int spins {0};;) {
+		if (sequence >= claimed) {
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		if (sequence % 2 == 0) {
+			// Acquire: the previous writer's text is in place before this one overwrites it.
+			if (slot.sequence.compare_exchange_weak(sequence, claimed, std::memory_order_acquire,
+			                                        std::memory_order_relaxed)) {
+				break;
+			}
+			continue;
+		}
+		if (++spins > ClaimSpins) {
+			_dropped.fetch_add(1, std::memory_order_relaxed);  // readers count the position lost
+			return;
+		}
+		std::this_thread::yield();
+		sequence = slot.sequence.load(std::memory_order_relaxed);
+	}
+	std::atomic_thread_fence(std::memory_order_release);  // readers see the odd sequence before any new text
+
+	auto const capacity {_header->slot_size - sizeof(ShmSlot)};
+	auto const size {std::min(buffer.size(), capacity)};
+	std::memcpy(text, buffer.data(), size);
+	if (size < buffer.size()) {
+		text[size - 1] = '\n';  // truncated
+	}
+
+	slot.size.store(static_cast<std::uint32_t>(size), std::memory_order_relaxed);
+	slot.sequence.store(2 * position + 2, std::memory_order_release);
+}
+
+SharedMemoryReader::SharedMemoryReader(std::string const& name)
+    : _data {nullptr}
+    , _size {0}
+    , _header {nullptr}
+    , _position {0}
+{
+	int const fd {::shm_open(name.c_str(), O_RDONLY, 0)};
+	if (fd < 0) {
+		fail("cannot open shared memory " + name);
+	}
+
+	struct stat status {};
+	if (::fstat(fd, &status) != 0) {
+		auto const error {errno};
+		::close(fd);
+		errno = error;
+		fail("cannot open shared memory " + name);
+	}
+	_size = static_cast<std::size_t>(status.st_size);
+
+	_data = _size >= HeaderSize ? ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	auto const error {errno};
+	::close(fd);
+
+	if (_data == MAP_FAILED) {
+		errno = _size >= HeaderSize ? error : EINVAL;
+		fail("cannot map shared memory " + name);
+	}
+
+	_header = static_cast<ShmHeader const*>(_data);
+
+	auto const& header {*_header};
+	bool const valid {std::memcmp(header.magic, Magic, sizeof Magic) == 0 && header.version == Version
+	                  && header.slot_size > sizeof(ShmSlot) && header.slot_count > 0
+	                  && (header.slot_count & (header.slot_count - 1)) == 0
+	                  && _size >= HeaderSize + header.slot_count * header.slot_size};
+	if (!valid) {
+		::munmap(_data, _size);
+		throw std::runtime_error {name + " is not a log ring"};
+	}
+
+	auto const head {header.head.load(std::memory_order_acquire)};
+	_position = head > header.slot_count ? head - header.slot_count : 0;
+}
+
+SharedMemoryReader::~SharedMemoryReader()
+{
+	::munmap(_data, _size);
+}
+
+auto SharedMemoryReader::slot(std::uint64_t const position) const -> detail::ShmSlot const&
+{
+	return slot_at(_data, *_header, position);
+}
+
+auto SharedMemoryReader::next(fmt::memory_buffer& out) -> Status
+{
+	auto const& header {*_header};
+	auto const capacity {header.slot_size - sizeof(ShmSlot)};
+
+	for (;;) {
+		bool const closed {header.closed.load(std::memory_order_acquire) != 0};
+		auto const head {header.head.load(std::memory_order_acquire)};
+
+		if (_position == head) {
+			return closed ? Status::Closed : Status::Empty;
+		}
+
+		if (head - _position > header.slot_count) {  // a lap behind: those lines are overwritten
+			_lost += head - header.slot_count - _position;
+			_position = head - header.slot_count;
+			_stalled = 0;
+		}
+
+		auto const& current {slot(_position)};
+		auto const expected {2 * _position + 2};
+		auto const sequence {current.sequence.load(std::memory_order_acquire)};
+
+		if (sequence < expected) {  // claimed but not complete yet
+			auto const now {detail::now()};
+			if (_stalled == 0) {
+				_stalled = now;
+			}
+			if (!closed && now - _stalled < StallTimeout) {
+				return Status::Empty;
+			}
+			++_lost;  // the writer died, or stopped, mid-line
+			++_position;
+			_stalled = 0;
+			continue;
+		}
+		_stalled = 0;
+
+		if (sequence > expected) {  // overwritten by a writer a lap ahead
+			++_lost;
+			++_position;
+			continue;
+		}
+
+		auto const mark {out.size()};
+		auto const size {std::min<std::size_t>(current.size.load(std::memory_order_relaxed), capacity)};
+		out.append(text_of(current), text_of(current) + size);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (current.sequence.load(std::memory_order_relaxed) != expected) {  // overwritten while copying
+			out.resize(mark);
+			++_lost;
+			++_position;
+			continue;
+		}
+
+		++_position;
+		return Status::Line;
+	}
+}
+
+}  // namespace project::log
@@ -0,0 +1,126 @@
+#ifndef LOG_SHM_HXX
+#define LOG_SHM_HXX
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <fmt/format.h>
+
+#include <log_sink.hxx>
+
+#include <project_dll-export.h>
+
+namespace project::log {
+
+struct SharedMemoryOptions
+{
+	/// POSIX shared-memory object name, e.g. "/my-service-log".
+	std::string name {"/project-log"};
+
+	/// Bytes per slot, header included; longer lines are truncated to fit.
+	std::size_t slot_size {256};
+
+	/// Slots in the ring, rounded up to a power of two.
+	std::size_t slot_count {std::size_t {1} << 16};
+};
+
+namespace detail {
+struct ShmHeader;
+struct ShmSlot;
+}  // namespace detail
+
+/** @brief Sink which writes text lines into a ring in POSIX shared memory, for another process to read.
+
+    The process doing the logging makes no system call per message. Each
+    writer claims a position with one atomic add, then takes that slot from
+    the writer a lap behind once it has finished, and owns it until it has
+    copied its line in. The slot's sequence number is odd while it is written
+    and even once complete, so a reader can tell a complete line from one
+    being written, or from one overwritten after it fell a lap behind.
+    Writers never wait for readers: a slow reader loses lines, and learns how
+    many (see SharedMemoryReader). A writer which finds its slot still being
+    written after a few yields drops its line instead (see dropped()).
+
+    The object is created afresh, replacing any other of the same name, and
+    unlinked when the sink is destroyed; a reader which has it open keeps
+    reading until it has caught up.
+
+    Available on POSIX systems only.
+ */
+class DLL SharedMemorySink : public Sink
+{
+public:
+	/// Create the shared-memory object. Throw std::system_error if that fails.
+	explicit SharedMemorySink(SharedMemoryOptions options = {});
+	~SharedMemorySink() override;
+
+	SharedMemorySink(SharedMemorySink const&) = delete;
+	auto operator=(SharedMemorySink const&) -> SharedMemorySink& = delete;
+
+	void write(Event const& event) override;
+
+	/// Lines dropped because a writer a lap behind still held their slot.
+	auto dropped() const -> std::uint64_t
+	{
+		return _dropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::string _name;
+	void* _data;
+	std::size_t _size;
+	detail::ShmHeader* _header;
+	std::atomic<std::uint64_t> _dropped {0};
+};
+
+/** @brief Reads the lines written by a SharedMemorySink in another process.
+
+    Reading never writes to the shared memory, so a reader cannot disturb the
+    writers or other readers.
+ */
+class DLL SharedMemoryReader
+{
+public:
+	enum class Status
+	{
+		Line,  ///< A line was appended.
+		Empty,  ///< Nothing to read yet.
+		Closed,  ///< The writer is gone and every line has been read.
+	};
+
+	/** @brief Open the ring named \p name, starting at its oldest line.
+
+	    Throw std::system_error if it cannot be opened, or std::runtime_error if
+	    it is not a log ring.
+	 */
+	explicit SharedMemoryReader(std::string const& name);
+	~SharedMemoryReader();
+
+	SharedMemoryReader(SharedMemoryReader const&) = delete;
+	auto operator=(SharedMemoryReader const&) -> SharedMemoryReader& = delete;
+
+	/// Append the next line, newline included, to \p out.
+	auto next(fmt::memory_buffer& out) -> Status;
+
+	/// Lines overwritten before they could be read, or abandoned by a writer, so far.
+	auto lost() const -> std::uint64_t
+	{
+		return _lost;
+	}
+
+private:
+	auto slot(std::uint64_t position) const -> detail::ShmSlot const&;
+
+	void* _data;
+	std::size_t _size;
+	detail::ShmHeader const* _header;
+	std::uint64_t _position;
+	std::uint64_t _lost {0};
+	std::uint64_t _stalled {0};  // when a writer was first seen still writing the current slot
+};
+
+}  // namespace project::log
+
+#endif  // LOG_SHM_HXX
@@ -0,0 +1,460 @@
+#include "log_sink.hxx"
+
+#include <algorithm>  // for std::find_if, std::max
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "log_async.hxx"
+#include "log_category.hxx"
+#include "log_index.hxx"
+#include "log_pattern.hxx"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>  // for GetCurrentThreadId
+#else
+#include <unistd.h>  // for write
+#if defined(__linux__)
+#include <sys/syscall.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#endif
+#endif
+
+namespace project::log {
+
+namespace {
+
+struct Entry
+{
+	SinkId id;
+	std::shared_ptr<Sink> sink;
+	Level level;
+};
+
+struct Sinks
+{
+	std::mutex mutex;
+	SinkId next {0};
+	std::vector<Entry> entries;  // in the order added
+	std::vector<std::shared_ptr<Sink>> retired;
+	std::vector<std::unique_ptr<detail::Routes const>> routes;  // every table ever published
+};
+
+auto sinks() -> Sinks&
+{
+	static Sinks instance;
+	return instance;
+}
+
+std::atomic<detail::Routes const*> CurrentRoutes {nullptr};
+
+/// Publish a routing table built from the sinks added, then update what depends on it. Call with the lock held.
+void publish(Sinks& instance)
+{
+	std::unique_ptr<detail::Routes> routes;
+	auto widest {Level::Trace};  // the log target takes every level
+
+	if (!instance.entries.empty()) {
+		routes = std::make_unique<detail::Routes>();
+		widest = Level::None;
+
+		for (auto const& [id, sink, level] : instance.entries) {
+			auto const bit {std::uint32_t {1} << routes->count};
+			for (auto i {static_cast<int>(Level::Error)}; i <= static_cast<int>(level); ++i) {
+				routes->masks[static_cast<std::size_t>(i)] |= bit;
+			}
+			routes->sinks[routes->count++] = sink.get();
+			widest = std::max(widest, level);
+		}
+	}
+
+	CurrentRoutes.store(routes.get(), std::memory_order_release);
+	if (routes) {
+		instance.routes.push_back(std::move(routes));
+	}
+
+	detail::set_routed_level(widest);
+	detail::update_deferral();
+}
+
+/// Flush the sink of \p entry and keep it alive. Call with the lock held.
+void retire(Sinks& instance, Entry& entry)
+{
+	entry.sink->flush();
+	instance.retired.push_back(std::move(entry.sink));
+}
+
+}  // namespace
+
+auto add_sink(std::shared_ptr<Sink> sink, Level const level) -> SinkId
+{
+	if (!sink) {
+		throw std::invalid_argument {"cannot add a null log sink"};
+	}
+
+	auto& instance {sinks()};
+	std::lock_guard const lock {instance.mutex};
+
+	if (instance.entries.size() == MaxSinks) {
+		throw std::length_error {"too many log sinks"};
+	}
+
+	auto const id {instance.next++};
+	instance.entries.push_back({id, std::move(sink), level});
+	publish(instance);
+	return id;
+}
+
+void remove_sink(SinkId const id)
+{
+	auto& instance {sinks()};
+	std::lock_guard const lock {instance.mutex};
+
+	auto& entries {instance.entries};
+	auto const found {std::find_if(entries.begin(), entries.end(), [&](Entry const& entry) { return entry.id == id; })};
+
+	if (found == entries.end()) {
+		return;
+	}
+
+	auto entry {std::move(*found)};
+	entries.erase(found);
+	publish(instance);  // stop routing to the sink before flushing it
+	retire(instance, entry);
+}
+
+void set_sink_level(SinkId const id, Level const level)
+{
+	auto& instance {sinks()};
+	std::lock_guard const lock {instance.mutex};
+
+	for (auto& entry : instance.entries) {
+		if (entry.id == id) {
+			entry.level = level;
+			publish(instance);
+			return;
+		}
+	}
+}
+
+void set_sink(std::shared_ptr<Sink> sink)
+{
+	auto& instance {sinks()};
+	std::lock_guard const lock {instance.mutex};
+
+	auto entries {std::move(instance.entries)};
+	instance.entries.clear();
+
+	if (sink) {
+		instance.entries.push_back({instance.next++, std::move(sink), Level::Trace});
+	}
+	publish(instance);
+
+	for (auto& entry : entries) {
+		retire(instance, entry);
+	}
+}
+
+auto get_sink() -> std::shared_ptr<Sink>
+{
+	auto& instance {sinks()};
+	std::lock_guard const lock {instance.mutex};
+	return instance.entries.empty() ? nullptr : instance.entries.front().sink;
+}
+
+FileSink::FileSink(std::FILE* out)
+    : _out {out}
+{}
+
+FileSink::FileSink(std::FILE* out, std::FILE* index, std::size_t const every)
+    : _out {out}
+    , _index {std::make_unique<IndexWriter>(index, every)}
+{
+	auto const position {std::ftell(out)};
+	_offset = position > 0 ? static_cast<std::uint64_t>(position) : 0;
+}
+
+FileSink::~FileSink() = default;
+
+void FileSink::write(Event const& event)
+{
+	std::optional<fmt::memory_buffer> spare;
+	auto& buffer {detail::ThreadBuffer<FileSink>::get(spare)};
+	format_text(buffer, event);
+
+	if (!_index) {
+		detail::write_file(_out, buffer.data(), buffer.size());  // one call, so lines from threads never interleave
+		return;
+	}
+
+	std::lock_guard const lock {_mutex};
+	detail::write_file(_out, buffer.data(), buffer.size());
+	_index->add(event, _offset, buffer.size());
+	_offset += buffer.size();
+}
+
+void FileSink::flush()
+{
+	std::fflush(_out);
+
+	if (_index) {
+		std::lock_guard const lock {_mutex};
+		_index->flush();
+	}
+}
+
+void format_message(fmt::memory_buffer& out, Event const& event)
+{
+	auto const* packed {event.packed};
+
+	if (!packed) {
+		out.append(event.message);
+		return;
+	}
+
+	auto const mark {out.size()};
+	try {
+		packed->schema->format(out, packed->format, packed->data.data());
+	} catch (fmt::format_error const& e) {
+		// Deferred formats are only checked when formatted; report rather than lose the message.
+		out.resize(mark);
+		fmt::format_to(std::back_inserter(out), "[format error: {}] {}", e.what(), packed->format);
+	}
+}
+
+namespace {
+
+/// The message of \p event, formatted into a per-thread buffer, or \p spare, if its arguments were captured.
+auto message_of(Event const& event, std::optional<fmt::memory_buffer>& spare) -> std::string_view
+{
+	if (!event.packed) {
+		return event.message;
+	}
+	auto& buffer {detail::ThreadBuffer<struct MessageOf>::get(spare)};
+	format_message(buffer, event);
+	return {buffer.data(), buffer.size()};
+}
+
+void format_json(fmt::memory_buffer& out, Event const& event)
+{
+	auto const string {[&](std::string_view const key, std::string_view const value) {
+		out.append(key);
+		out.push_back('"');
+		detail::escape_json(out, value);
+		out.push_back('"');
+	}};
+
+	out.append(std::string_view {"{\"time\":\""});
+	detail::append_time(out, event.timestamp);
+	out.append(std::string_view {"\",\"level\":\""});
+	out.append(level_label(event.level));
+	fmt::format_to(fmt::appender {out}, "\",\"thread\":{}", event.thread);
+	std::optional<fmt::memory_buffer> spare;
+	string(",\"message\":", message_of(event, spare));
+
+	if (auto const* site {event.site}) {
+		string(",\"file\":", site->file);
+		fmt::format_to(fmt::appender {out}, ",\"line\":{}", site->line);
+		string(",\"function\":", site->function);
+		if (site->category) {
+			string(",\"category\":", site->category);
+		}
+	}
+
+	out.append(event.fields);
+	out.push_back('}');
+}
+
+void format_logfmt(fmt::memory_buffer& out, Event const& event)
+{
+	static std::string_view constexpr levels[] {"none", "error", "warning", "info", "debug", "trace"};
+
+	out.append(std::string_view {"time=\""});
+	detail::append_time(out, event.timestamp);
+	out.append(std::string_view {"\" level="});
+	out.append(levels[static_cast<std::size_t>(event.level)]);
+	fmt::format_to(fmt::appender {out}, " thread={} msg=", event.thread);
+	std::optional<fmt::memory_buffer> spare;
+	detail::quote_logfmt(out, message_of(event, spare));
+
+	if (auto const* site {event.site}) {
+		out.append(std::string_view {" file="});
+		detail::quote_logfmt(out, site->file);
+		fmt::format_to(fmt::appender {out}, " line={} function=", site->line);
+		detail::quote_logfmt(out, site->function);
+		if (site->category) {
+			out.append(std::string_view {" category="});
+			detail::quote_logfmt(out, site->category);
+		}
+	}
+
+	out.append(event.fields);
+}
+
+}  // namespace
+
+void format_text(fmt::memory_buffer& out, Event const& event)
+{
+	switch (detail::current_encoding()) {
+	case Encoding::Text: {
+		auto const& pattern {detail::current_pattern()};
+		pattern.format_prefix(out, event);
+		format_message(out, event);
+		out.append(event.fields);
+		pattern.format_suffix(out, event);
+		break;
+	}
+	case Encoding::Json: format_json(out, event); break;
+	case Encoding::Logfmt: format_logfmt(out, event); break;
+	}
+	out.push_back('\n');
+}
+
+namespace detail {
+
+std::atomic<bool> DeferFormatting {false};
+
+void Routes::write(Event const& event) const
+{
+	auto mask {masks[static_cast<std::size_t>(event.level)]};
+
+	for (std::size_t i {0}; mask != 0; ++i, mask >>= 1) {
+		if (mask & 1) {
+			sinks[i]->write(event);
+		}
+	}
+}
+
+void Routes::flush() const
+{
+	for (std::size_t i {0}; i < count; ++i) {
+		sinks[i]->flush();
+	}
+}
+
+void deliver(Event const& event)
+{
+	if (auto const* const routes {current_routes()}) {
+		routes->write(event);
+		return;
+	}
+
+	fmt::memory_buffer buffer;
+	format_text(buffer, event);
+	write_target(buffer.data(), buffer.size());
+}
+
+void flush_output()
+{
+	if (auto const* const routes {current_routes()}) {
+		routes->flush();
+	}
+	else {
+		std::fflush(get_target());
+	}
+}
+
+std::atomic<bool> DirectTarget {false};
+
+void write_target(char const* data, std::size_t size)
+{
+	write_file(get_target(), data, size);
+}
+
+auto write_file(std::FILE* out, char const* data, std::size_t size) -> bool
+{
+#ifndef _WIN32
+	if (DirectTarget.load(std::memory_order_relaxed)) {
+		return write_direct(out, data, size);
+	}
+#endif
+
+	return std::fwrite(data, 1, size, out) == size;
+}
+
+auto write_direct(std::FILE* out, char const* data, std::size_t size) noexcept -> bool
+{
+#ifndef _WIN32
+	auto const fd {::fileno(out)};
+	while (size > 0) {
+		auto const written {::write(fd, data, size)};
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data += written;
+		size -= static_cast<std::size_t>(written);
+	}
+	return true;
+#else
+	return std::fwrite(data, 1, size, out) == size && std::fflush(out) == 0;
+#endif
+}
+
+auto current_routes() -> Routes const*
+{
+	return CurrentRoutes.load(std::memory_order_acquire);
+}
+
+void update_deferral()
+{
+	bool sinks_defer {false};
+
+	if (auto const* const routes {current_routes()}) {
+		for (std::size_t i {0}; i < routes->count; ++i) {
+			sinks_defer = sinks_defer || routes->sinks[i]->deferred();
+		}
+	}
+
+	DeferFormatting.store(async_defers() || sinks_defer, std::memory_order_relaxed);
+}
+
+auto now() -> std::uint64_t
+{
+	using namespace std::chrono;
+
+	struct Calibration
+	{
+		steady_clock::time_point steady {steady_clock::now()};
+		system_clock::time_point wall {system_clock::now()};
+	};
+	static Calibration const base;
+
+	auto const elapsed {steady_clock::now() - base.steady};
+	return duration_cast<nanoseconds>(base.wall.time_since_epoch() + elapsed).count();
+}
+
+auto thread_id() -> std::uint32_t
+{
+	thread_local std::uint32_t const id {[] {
+#if defined(_WIN32)
+		return static_cast<std::uint32_t>(::GetCurrentThreadId());
+#elif defined(__linux__)
+		return static_cast<std::uint32_t>(::syscall(SYS_gettid));
+#elif defined(__APPLE__)
+		std::uint64_t id;
+		::pthread_threadid_np(nullptr, &id);
+		return static_cast<std::uint32_t>(id);
+#else
+		static std::atomic<std::uint32_t> next {1};
+		return next.fetch_add(1, std::memory_order_relaxed);
+#endif
+	}()};
+	return id;
+}
+
+}  // namespace detail
+
+}  // namespace project::log
@@ -0,0 +1,235 @@
+#ifndef LOG_SINK_HXX
+#define LOG_SINK_HXX
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>  // for std::FILE
+#include <memory>  // for std::shared_ptr, std::unique_ptr
+#include <mutex>
+#include <optional>
+#include <string_view>
+
+#include <fmt/format.h>
+
+#include <log.hxx>
+
+#include <project_dll-export.h>
+
+namespace project::log {
+
+/// One log message, as handed to a Sink.
+struct Event
+{
+	Level level;
+	Site const* site;  ///< Call site, if emitted by a PROJECT_LOG_* macro.
+	std::uint64_t timestamp;  ///< Nanoseconds since the Unix epoch, taken by the emitting thread.
+	std::uint32_t thread;  ///< OS id of the emitting thread.
+	std::string_view message;  ///< Formatted message, unless \p packed is set.
+	std::string_view fields;  ///< Key/value fields, encoded when emitted; see kv().
+	detail::Packed const* packed;  ///< Captured format string & arguments, not yet formatted.
+};
+
+/** @brief Destination for log events, replacing text output to the log target.
+
+    write() may be called by several threads at once: by the emitting threads,
+    or by the backend thread while it runs (see start_backend()).
+ */
+class Sink
+{
+public:
+	virtual ~Sink() = default;
+
+	virtual void write(Event const& event) = 0;
+
+	virtual void flush()
+	{}
+
+	/// Prefer events with captured arguments; formatting is left to the sink (or a later reader).
+	virtual auto deferred() const -> bool
+	{
+		return false;
+	}
+
+	/** @brief Write out buffered records from a fatal-signal handler; see install_crash_handlers().
+
+	    Another thread may be inside write() or flush(), or have crashed there:
+	    use async-signal-safe calls only, and take no locks.
+	 */
+	virtual void drain() noexcept
+	{}
+};
+
+/// Identifies a sink added with add_sink().
+using SinkId = std::uint32_t;
+
+/** @brief Send events at \p level and more-severe levels to \p sink, alongside any other sinks.
+
+    While any sink is added, text is no longer written to the log target; add
+    a FileSink to keep it. Levels no sink accepts are disabled as if by
+    set_level(), so such a message costs a single compare.
+
+    Throw std::invalid_argument if \p sink is nullptr, or std::length_error if
+    MaxSinks sinks are already added.
+ */
+DLL auto add_sink(std::shared_ptr<Sink> sink, Level level = Level::Trace) -> SinkId;
+
+/** @brief Stop sending events to the sink added as \p id. Unknown ids are ignored.
+
+    The sink is flushed, then kept alive until exit, because other threads may
+    still be writing to it.
+ */
+DLL void remove_sink(SinkId id);
+
+/// Send events at \p level and more-severe levels to the sink added as \p id. Unknown ids are ignored.
+DLL void set_sink_level(SinkId id, Level level);
+
+/** @brief Remove every sink, then add \p sink for all levels.
+
+    Pass nullptr to restore text output to the log target.
+ */
+DLL void set_sink(std::shared_ptr<Sink> sink);
+
+/// The first sink added, or nullptr.
+DLL auto get_sink() -> std::shared_ptr<Sink>;
+
+std::size_t constexpr MaxSinks {32};
+
+class IndexWriter;
+
+/// Sink which writes text, laid out by the current pattern, to a C stream.
+class DLL FileSink : public Sink
+{
+public:
+	/// Write to \p out, which must outlive the sink.
+	explicit FileSink(std::FILE* out);
+
+	/** @brief Write to \p out, and a sparse index of it to \p index, an entry per \p every records.
+
+	    Both streams must outlive the sink; \p index must be opened in binary
+	    mode. Offsets count from the position of \p out when the sink is made.
+	    Records are then written under a lock, to keep their offsets. See
+	    IndexWriter and search().
+	 */
+	FileSink(std::FILE* out, std::FILE* index, std::size_t every = 1024);
+	~FileSink() override;
+
+	FileSink(FileSink const&) = delete;
+	auto operator=(FileSink const&) -> FileSink& = delete;
+
+	void write(Event const& event) override;
+	void flush() override;
+
+private:
+	std::FILE* _out;
+	std::unique_ptr<IndexWriter> _index;
+	std::mutex _mutex;  // held to write, if indexed
+	std::uint64_t _offset {0};  // of the next record, if indexed; guarded by _mutex
+};
+
+/// Append the message of \p event, formatting captured arguments if needed.
+DLL void format_message(fmt::memory_buffer& out, Event const& event);
+
+/// Append \p event as one line in the current encoding, plus a newline; see set_encoding() and set_pattern().
+DLL void format_text(fmt::memory_buffer& out, Event const& event);
+
+namespace detail {
+/** @brief Sinks in use, with a bitmask per level of those which accept it.
+
+    Rebuilt whenever a sink is added, removed, or given a new level, then
+    published whole; a published table is never changed or freed.
+ */
+struct Routes
+{
+	std::array<Sink*, MaxSinks> sinks {};
+	std::size_t count {0};
+	std::array<std::uint32_t, 6> masks {};  // indexed by Level; bit i selects sinks[i]
+
+	/// Hand \p event to every sink which accepts its level.
+	void write(Event const& event) const;
+	void flush() const;
+};
+
+/// Hand \p event to the sinks which accept it, or write its text to the log target, on the calling thread.
+void deliver(Event const& event);
+
+/// Flush every sink, or the log target.
+void flush_output();
+
+/// Write text to the log target: through stdio, or straight to its descriptor while crash handlers are installed.
+DLL void write_target(char const* data, std::size_t size);
+
+/// Write to \p out as write_target() does to the log target; for sinks writing to a C stream. False on error.
+DLL auto write_file(std::FILE* out, char const* data, std::size_t size) -> bool;
+
+/// Write to the descriptor of \p out with write(2) only, bypassing its stdio buffer; for Sink::drain(). False on error.
+DLL auto write_direct(std::FILE* out, char const* data, std::size_t size) noexcept -> bool;
+
+/** @brief True while text bypasses stdio buffering, so none is lost if the process dies; see install_crash_handlers().
+
+    Covers the log target, FileSink and BinarySink, and the blocks CompressedSink writes.
+ */
+DLL extern std::atomic<bool> DirectTarget;
+
+/// The current routing table; nullptr while text goes to the log target.
+auto current_routes() -> Routes const*;
+
+/// Recompute DeferFormatting after the sink or the backend changes.
+void update_deferral();
+
+/** @brief Wall-clock time for Event::timestamp, read from the monotonic clock.
+
+    The monotonic clock is calibrated against the wall clock on first use, so
+    timestamps never go backwards, nor follow later changes to the system time.
+ */
+DLL auto now() -> std::uint64_t;
+
+/// OS id of the calling thread, cached per thread.
+DLL auto thread_id() -> std::uint32_t;
+
+/** @brief A buffer each thread reuses at one place, told apart by \p Tag.
+
+    Thread-local objects are destroyed as their thread exits, last built
+    first, and the main thread's before static objects; destructors which
+    run after, such as those of later thread-local or static objects, may
+    still log. From then on, get() hands out \p spare instead.
+ */
+template <typename Tag>
+class ThreadBuffer
+{
+public:
+	/// The calling thread's buffer, or \p spare once it is destroyed; empty either way.
+	static auto get(std::optional<fmt::memory_buffer>& spare) -> fmt::memory_buffer&
+	{
+		thread_local bool destroyed {false};  // trivially destructible, so still readable then
+		if (destroyed) {
+			return spare.emplace();
+		}
+
+		thread_local ThreadBuffer instance {destroyed};
+		instance._buffer.clear();
+		return instance._buffer;
+	}
+
+	ThreadBuffer(ThreadBuffer const&) = delete;
+	auto operator=(ThreadBuffer const&) -> ThreadBuffer& = delete;
+
+private:
+	explicit ThreadBuffer(bool& destroyed)
+	    : _destroyed {destroyed}
+	{}
+
+	~ThreadBuffer()
+	{
+		_destroyed = true;
+	}
+
+	bool& _destroyed;
+	fmt::memory_buffer _buffer;
+};
+}  // namespace detail
+
+}  // namespace project::log
+
+#endif  // LOG_SINK_HXX
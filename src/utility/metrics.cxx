@@ -0,0 +1,358 @@
+#include "metrics.hxx"
+
+#include <algorithm>  // for std::clamp, std::find_if, std::min
+#include <cmath>  // for std::ceil
+#include <condition_variable>
+#include <iterator>  // for std::size
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <fmt/format.h>
+
+#include "log_fields.hxx"
+
+namespace project::metrics {
+
+namespace {
+
+using detail::HistogramCells;
+using detail::Shard;
+
+struct Registry
+{
+	std::mutex mutex;
+	std::vector<std::unique_ptr<Counter>> counters;  // by index
+	std::vector<std::unique_ptr<Histogram>> histograms;  // by index
+	std::vector<std::unique_ptr<Shard>> shards;  // every shard made; threads own some, the rest are free
+	std::vector<Shard*> free;  // zeroed when freed
+	std::vector<std::unique_ptr<HistogramCells>> cells;  // allocated for any shard
+	Shard exited;  // counts of the threads which have exited
+};
+
+auto registry() -> Registry&
+{
+	static Registry instance;
+	return instance;
+}
+
+/// Allocate histogram cells for \p shard. Call with the lock held.
+auto allocate_locked(Registry& instance, Shard& shard, std::size_t const index) -> HistogramCells&
+{
+	auto& cells {*instance.cells.emplace_back(std::make_unique<HistogramCells>())};
+	shard.histograms[index].store(&cells, std::memory_order_release);
+	return cells;
+}
+
+/// Move \p from into \p to, leaving \p from as new. Call with the lock held, with no thread writing either.
+void fold(Registry& instance, Shard& from, Shard& to)
+{
+	for (std::size_t i {0}; i < MaxCounters; ++i) {
+		detail::bump(to.counters[i], from.counters[i].exchange(0, std::memory_order_relaxed));
+	}
+
+	for (std::size_t i {0}; i < MaxHistograms; ++i) {
+		auto* const source {from.histograms[i].load(std::memory_order_relaxed)};
+		if (!source || source->count.load(std::memory_order_relaxed) == 0) {
+			continue;
+		}
+
+		auto* target {to.histograms[i].load(std::memory_order_relaxed)};
+		if (!target) {
+			target = &allocate_locked(instance, to, i);
+		}
+
+		detail::bump(target->count, source->count.exchange(0, std::memory_order_relaxed));
+		detail::bump(target->sum, source->sum.exchange(0, std::memory_order_relaxed));
+		target->min.store(std::min(target->min.load(std::memory_order_relaxed),
+		                           source->min.exchange(~std::uint64_t {0}, std::memory_order_relaxed)),
+		                  std::memory_order_relaxed);
+		target->max.store(std::max(target->max.load(std::memory_order_relaxed),
+		                           source->max.exchange(0, std::memory_order_relaxed)),
+		                  std::memory_order_relaxed);
+		for (std::size_t b {0}; b < detail::BucketCount; ++b) {
+			detail::bump(target->buckets[b], source->buckets[b].exchange(0, std::memory_order_relaxed));
+		}
+	}
+}
+
+/// Hands a shard to each thread which updates a metric, and takes it back when the thread exits.
+struct Owner
+{
+	Owner()
+	{
+		auto& instance {registry()};
+		std::lock_guard const lock {instance.mutex};
+
+		if (instance.free.empty()) {
+			shard = instance.shards.emplace_back(std::make_unique<Shard>()).get();
+		}
+		else {
+			shard = instance.free.back();
+			instance.free.pop_back();
+		}
+	}
+
+	~Owner()
+	{
+		auto& instance {registry()};
+		std::lock_guard const lock {instance.mutex};
+
+		fold(instance, *shard, instance.exited);
+		instance.free.push_back(shard);
+	}
+
+	Owner(Owner const&) = delete;
+	auto operator=(Owner const&) -> Owner& = delete;
+
+	Shard* shard;
+};
+
+/// Add the cells of one shard to \p value.
+void add(HistogramValue& value, HistogramCells const& cells)
+{
+	auto const count {cells.count.load(std::memory_order_relaxed)};
+	if (count == 0) {
+		return;
+	}
+
+	value.count += count;
+	value.sum += cells.sum.load(std::memory_order_relaxed);
+	value.min = std::min(value.min, cells.min.load(std::memory_order_relaxed));
+	value.max = std::max(value.max, cells.max.load(std::memory_order_relaxed));
+	for (std::size_t b {0}; b < detail::BucketCount; ++b) {
+		value.buckets[b] += cells.buckets[b].load(std::memory_order_relaxed);
+	}
+}
+
+struct Reporter
+{
+	~Reporter()
+	{
+		stop();
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard const lock {mutex};
+			stopping = true;
+		}
+		wake.notify_all();
+
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+
+	std::mutex control;  // held by start_reporting() and stop_reporting()
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping {false};  // guarded by mutex
+	std::thread thread;
+};
+
+auto reporter() -> Reporter&
+{
+	static Reporter instance;
+	return instance;
+}
+
+}  // namespace
+
+Counter::Counter(std::size_t const index, std::string_view const name)
+    : _index {index}
+    , _name {name}
+{}
+
+Histogram::Histogram(std::size_t const index, std::string_view const name)
+    : _index {index}
+    , _name {name}
+{}
+
+auto counter(std::string_view const name) -> Counter&
+{
+	auto& instance {registry()};
+	std::lock_guard const lock {instance.mutex};
+
+	auto& counters {instance.counters};
+	auto const found {std::find_if(counters.begin(), counters.end(), [&](auto const& c) { return c->name() == name; })};
+	if (found != counters.end()) {
+		return **found;
+	}
+
+	if (counters.size() == MaxCounters) {
+		throw std::length_error {"too many counters"};
+	}
+	return *counters.emplace_back(new Counter {counters.size(), name});
+}
+
+auto histogram(std::string_view const name) -> Histogram&
+{
+	auto& instance {registry()};
+	std::lock_guard const lock {instance.mutex};
+
+	auto& histograms {instance.histograms};
+	auto const found {
+	    std::find_if(histograms.begin(), histograms.end(), [&](auto const& h) { return h->name() == name; })};
+	if (found != histograms.end()) {
+		return **found;
+	}
+
+	if (histograms.size() == MaxHistograms) {
+		throw std::length_error {"too many histograms"};
+	}
+	return *histograms.emplace_back(new Histogram {histograms.size(), name});
+}
+
+namespace detail {
+
+auto shard() -> Shard&
+{
+	thread_local Owner const owner;
+	return *owner.shard;
+}
+
+auto allocate(Shard& shard, std::size_t const index) -> HistogramCells&
+{
+	auto& instance {registry()};
+	std::lock_guard const lock {instance.mutex};
+	return allocate_locked(instance, shard, index);
+}
+
+}  // namespace detail
+
+auto HistogramValue::percentile(double const q) const -> std::uint64_t
+{
+	if (count == 0) {
+		return 0;
+	}
+
+	auto const rank {std::clamp<std::uint64_t>(static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(count))),
+	                                           1, count)};
+	std::uint64_t seen {0};
+
+	for (std::size_t b {0}; b < buckets.size(); ++b) {
+		seen += buckets[b];
+		if (seen >= rank) {
+			auto const low {detail::bucket_floor(b)};
+			auto const high {b + 1 < detail::BucketCount ? detail::bucket_floor(b + 1) - 1
+			                                             : std::numeric_limits<std::uint64_t>::max()};
+			return std::clamp(low + (high - low) / 2, min, max);  // the middle of the bucket
+		}
+	}
+	return max;
+}
+
+auto snapshot() -> Snapshot
+{
+	auto& instance {registry()};
+	std::lock_guard const lock {instance.mutex};
+
+	Snapshot result;
+
+	for (std::size_t i {0}; i < instance.counters.size(); ++i) {
+		auto value {instance.exited.counters[i].load(std::memory_order_relaxed)};
+		for (auto const& shard : instance.shards) {
+			value += shard->counters[i].load(std::memory_order_relaxed);
+		}
+		result.counters.push_back({instance.counters[i]->name(), value});
+	}
+
+	for (std::size_t i {0}; i < instance.histograms.size(); ++i) {
+		HistogramValue value {instance.histograms[i]->name(), 0, 0, ~std::uint64_t {0}, 0,
+		                      std::vector<std::uint64_t>(detail::BucketCount)};
+
+		if (auto const* cells {instance.exited.histograms[i].load(std::memory_order_relaxed)}) {
+			add(value, *cells);
+		}
+		for (auto const& shard : instance.shards) {
+			if (auto const* cells {shard->histograms[i].load(std::memory_order_acquire)}) {
+				add(value, *cells);
+			}
+		}
+
+		if (value.count > 0) {
+			result.histograms.push_back(std::move(value));
+		}
+	}
+
+	return result;
+}
+
+void report(log::Level const level)
+{
+	using log::kv;
+	using log::Level;
+
+	// The async backend may format a message after this returns, so its call site must outlive it.
+	static log::Site constexpr Sites[] {
+	    {__FILE__, __LINE__, "report", Level::None, "metrics"},
+	    {__FILE__, __LINE__, "report", Level::Error, "metrics"},
+	    {__FILE__, __LINE__, "report", Level::Warning, "metrics"},
+	    {__FILE__, __LINE__, "report", Level::Info, "metrics"},
+	    {__FILE__, __LINE__, "report", Level::Debug, "metrics"},
+	    {__FILE__, __LINE__, "report", Level::Trace, "metrics"},
+	};
+
+	auto const index {static_cast<std::size_t>(level)};
+	if (level == Level::None || index >= std::size(Sites) || !log::enabled(level)) {
+		return;
+	}
+	auto const& site {Sites[index]};
+
+	auto const data {snapshot()};
+
+	for (auto const& [name, value] : data.counters) {
+		log::print(site, "counter", kv("name", name), kv("value", value));
+	}
+	for (auto const& h : data.histograms) {
+		log::print(site, "histogram", kv("name", h.name), kv("count", h.count), kv("min", h.min),
+		           kv("p50", h.percentile(0.5)), kv("p90", h.percentile(0.9)), kv("p99", h.percentile(0.99)),
+		           kv("max", h.max));
+	}
+}
+
+void dump(std::FILE* const out)
+{
+	auto const data {snapshot()};
+
+	for (auto const& [name, value] : data.counters) {
+		fmt::print(out, "counter {} {}\n", name, value);
+	}
+	for (auto const& h : data.histograms) {
+		fmt::print(out, "histogram {} count={} min={} p50={} p90={} p99={} max={}\n", h.name, h.count, h.min,
+		           h.percentile(0.5), h.percentile(0.9), h.percentile(0.99), h.max);
+	}
+}
+
+void start_reporting(std::chrono::milliseconds const interval, log::Level const level)
+{
+	registry();  // constructed first, so destroyed after the reporter has stopped
+
+	auto& instance {reporter()};
+	std::lock_guard const control {instance.control};
+
+	instance.stop();
+	instance.stopping = false;  // the thread is gone, so the lock is not needed
+
+	instance.thread = std::thread {[&instance, interval, level] {
+		std::unique_lock lock {instance.mutex};
+		while (!instance.wake.wait_for(lock, interval, [&] { return instance.stopping; })) {
+			lock.unlock();
+			report(level);
+			lock.lock();
+		}
+	}};
+}
+
+void stop_reporting()
+{
+	auto& instance {reporter()};
+	std::lock_guard const control {instance.control};
+	instance.stop();
+}
+
+}  // namespace project::metrics
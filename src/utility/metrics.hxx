@@ -0,0 +1,311 @@
+#ifndef METRICS_HXX
+#define METRICS_HXX
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <log.hxx>
+#include <trace.hxx>
+
+#include <project_dll-export.h>
+
+/** @file
+    Counters, latency histograms and scoped timers for hot paths.
+
+    Updates go to a shard owned by the updating thread, so they never contend:
+    each is a relaxed load and store to memory no other thread writes.
+    snapshot() adds the shards up. report() emits a snapshot through the log
+    sinks, dump() writes one to a file, and start_reporting() reports
+    periodically from a thread of its own.
+
+    The PROJECT_METRICS_* macros, and the updates they make, compile to nothing
+    unless ENABLE_METRICS is set (see the PROJECT_METRICS CMake option).
+ */
+
+#ifndef ENABLE_METRICS
+#define ENABLE_METRICS 0
+#endif
+
+namespace project::metrics {
+
+/// True if metrics are compiled in.
+bool constexpr Enabled {ENABLE_METRICS};
+
+std::size_t constexpr MaxCounters {256};
+std::size_t constexpr MaxHistograms {64};
+
+class Counter;
+class Histogram;
+
+/// Find or create the counter named \p name. Throw std::length_error if there are MaxCounters already.
+DLL auto counter(std::string_view name) -> Counter&;
+
+/// Find or create the histogram named \p name. Throw std::length_error if there are MaxHistograms already.
+DLL auto histogram(std::string_view name) -> Histogram&;
+
+namespace detail {
+
+/** @brief Histogram buckets: one per value below 16, then 16 per power of two.
+
+    Like an HDR histogram with one significant hex digit: a value is placed
+    within 1/16 of itself, over the whole 64-bit range.
+ */
+unsigned constexpr SubBits {4};
+std::size_t constexpr SubCount {std::size_t {1} << SubBits};
+std::size_t constexpr BucketCount {(64 - SubBits + 1) * SubCount};
+
+auto constexpr bucket_of(std::uint64_t const value) -> std::size_t
+{
+	if (value < SubCount) {
+		return static_cast<std::size_t>(value);
+	}
+#if defined(__GNUC__) || defined(__clang__)
+	unsigned const exponent {63u - static_cast<unsigned>(__builtin_clzll(value))};
+#else
+	unsigned exponent {SubBits};
+	while ((value >> exponent) > 1) {
+		++exponent;
+	}
+#endif
+	return (exponent - SubBits + 1) * SubCount + ((value >> (exponent - SubBits)) & (SubCount - 1));
+}
+
+/// Least value in bucket \p index.
+auto constexpr bucket_floor(std::size_t const index) -> std::uint64_t
+{
+	if (index < SubCount) {
+		return index;
+	}
+	auto const exponent {index / SubCount + SubBits - 1};
+	return (SubCount + index % SubCount) << (exponent - SubBits);
+}
+
+struct HistogramCells
+{
+	std::atomic<std::uint64_t> count {0};
+	std::atomic<std::uint64_t> sum {0};
+	std::atomic<std::uint64_t> min {~std::uint64_t {0}};
+	std::atomic<std::uint64_t> max {0};
+	std::array<std::atomic<std::uint64_t>, BucketCount> buckets {};
+};
+
+/// Written only by the thread it belongs to; read by snapshot().
+struct Shard
+{
+	std::array<std::atomic<std::uint64_t>, MaxCounters> counters {};
+	std::array<std::atomic<HistogramCells*>, MaxHistograms> histograms {};
+};
+
+/// This thread's shard. When the thread exits, its counts are kept and the shard reused.
+DLL auto shard() -> Shard&;
+
+/// Allocate the cells of histogram \p index in \p shard, this thread's.
+DLL auto allocate(Shard& shard, std::size_t index) -> HistogramCells&;
+
+/// Add to a cell only this thread writes: no read-modify-write instruction needed.
+inline void bump(std::atomic<std::uint64_t>& cell, std::uint64_t const amount)
+{
+	cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+inline void record(HistogramCells& cells, std::uint64_t const value)
+{
+	bump(cells.buckets[bucket_of(value)], 1);
+	bump(cells.count, 1);
+	bump(cells.sum, value);
+	if (value < cells.min.load(std::memory_order_relaxed)) {
+		cells.min.store(value, std::memory_order_relaxed);
+	}
+	if (value > cells.max.load(std::memory_order_relaxed)) {
+		cells.max.store(value, std::memory_order_relaxed);
+	}
+}
+
+}  // namespace detail
+
+/** @brief Monotonic count of events.
+
+    Counters live until exit; references to them never dangle.
+ */
+class DLL Counter
+{
+public:
+	Counter(Counter const&) = delete;
+	auto operator=(Counter const&) -> Counter& = delete;
+
+	auto name() const -> std::string_view
+	{
+		return _name;
+	}
+
+	void add(std::uint64_t const amount = 1)
+	{
+#if ENABLE_METRICS
+		detail::bump(detail::shard().counters[_index], amount);
+#else
+		(void) amount;
+#endif
+	}
+
+private:
+	friend auto counter(std::string_view name) -> Counter&;
+
+	Counter(std::size_t index, std::string_view name);
+
+	std::size_t _index;
+	std::string _name;
+};
+
+/** @brief Distribution of values, typically latencies in nanoseconds, in log-scaled buckets.
+
+    Histograms live until exit; references to them never dangle.
+ */
+class DLL Histogram
+{
+public:
+	Histogram(Histogram const&) = delete;
+	auto operator=(Histogram const&) -> Histogram& = delete;
+
+	auto name() const -> std::string_view
+	{
+		return _name;
+	}
+
+	void record(std::uint64_t const value)
+	{
+#if ENABLE_METRICS
+		auto& shard {detail::shard()};
+		auto* cells {shard.histograms[_index].load(std::memory_order_relaxed)};
+		if (!cells) {
+			cells = &detail::allocate(shard, _index);
+		}
+		detail::record(*cells, value);
+#else
+		(void) value;
+#endif
+	}
+
+private:
+	friend auto histogram(std::string_view name) -> Histogram&;
+
+	Histogram(std::size_t index, std::string_view name);
+
+	std::size_t _index;
+	std::string _name;
+};
+
+/// Record the nanoseconds from construction to destruction in a histogram, and in the trace while tracing.
+class Span
+{
+public:
+	explicit Span(Histogram& histogram)
+	    : _histogram {histogram}
+	    , _start {Enabled ? trace::detail::ticks() : 0}
+	{}
+
+	~Span()
+	{
+		if constexpr (Enabled) {
+			auto const end {trace::detail::ticks()};
+			_histogram.record(end - _start);
+			if (trace::active()) {
+				trace::detail::record(_histogram.name(), _start, end);
+			}
+		}
+	}
+
+	Span(Span const&) = delete;
+	auto operator=(Span const&) -> Span& = delete;
+
+private:
+	Histogram& _histogram;
+	std::uint64_t const _start;
+};
+
+struct CounterValue
+{
+	std::string_view name;
+	std::uint64_t value;
+};
+
+struct HistogramValue
+{
+	std::string_view name;
+	std::uint64_t count;
+	std::uint64_t sum;
+	std::uint64_t min;  ///< Zero if count is zero.
+	std::uint64_t max;
+	std::vector<std::uint64_t> buckets;  ///< Counts by detail::bucket_of(value).
+
+	/// Value below which fraction \p q of the values fall, within 1/16; zero if count is zero.
+	DLL auto percentile(double q) const -> std::uint64_t;
+};
+
+/// Totals of every metric, over every thread, since the start.
+struct Snapshot
+{
+	std::vector<CounterValue> counters;  ///< In the order created.
+	std::vector<HistogramValue> histograms;  ///< In the order created; only those with values.
+};
+
+/// Add up the shards of every thread, live or exited.
+DLL auto snapshot() -> Snapshot;
+
+/** @brief Emit a snapshot through the log, one message per metric, at \p level.
+
+    Messages carry their values as fields (see log::kv()) and the category
+    "metrics", so the encoding and routing of the log apply.
+ */
+DLL void report(log::Level level = log::Level::Info);
+
+/// Write a snapshot to \p out as text, one line per metric.
+DLL void dump(std::FILE* out);
+
+/// Call report() every \p interval from a background thread, until stop_reporting(). Restart it if running.
+DLL void start_reporting(std::chrono::milliseconds interval, log::Level level = log::Level::Info);
+
+/// Stop reporting periodically; wait for a report in progress to finish.
+DLL void stop_reporting();
+
+}  // namespace project::metrics
+
+#define PROJECT_METRICS_CONCAT_(a, b) a##b
+#define PROJECT_METRICS_CONCAT(a, b)  PROJECT_METRICS_CONCAT_(a, b)
+
+/// Add \p amount to the counter named \p name. The counter is looked up once per call site.
+#define PROJECT_METRICS_COUNT(name, amount) \
+	do { \
+		if constexpr (::project::metrics::Enabled) { \
+			static ::project::metrics::Counter& project_metrics_counter {::project::metrics::counter(name)}; \
+			project_metrics_counter.add(amount); \
+		} \
+	} while (false)
+
+/// Record \p value in the histogram named \p name. The histogram is looked up once per call site.
+#define PROJECT_METRICS_RECORD(name, value) \
+	do { \
+		if constexpr (::project::metrics::Enabled) { \
+			static ::project::metrics::Histogram& project_metrics_histogram {::project::metrics::histogram(name)}; \
+			project_metrics_histogram.record(value); \
+		} \
+	} while (false)
+
+#if ENABLE_METRICS
+/// Time the rest of the enclosing scope into the histogram named \p name.
+#define PROJECT_METRICS_SPAN(name) \
+	static ::project::metrics::Histogram& PROJECT_METRICS_CONCAT(project_metrics_histogram_, __LINE__) { \
+	    ::project::metrics::histogram(name)}; \
+	::project::metrics::Span const PROJECT_METRICS_CONCAT(project_metrics_span_, __LINE__) { \
+	    PROJECT_METRICS_CONCAT(project_metrics_histogram_, __LINE__)}
+#else
+#define PROJECT_METRICS_SPAN(name) static_assert(true)
+#endif
+
+#endif  // METRICS_HXX
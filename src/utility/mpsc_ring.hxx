@@ -0,0 +1,157 @@
+#ifndef MPSC_RING_HXX
+#define MPSC_RING_HXX
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>  // for std::unique_ptr
+#include <utility>  // for std::forward, std::move
+
+namespace project::detail {
+
+/// Size used to keep independently-written atomics on separate cache lines.
+std::size_t constexpr CacheLine {64};
+
+/** @brief Bounded lock-free multi-producer, single-consumer queue.
+
+    Each slot carries a sequence number which tells producers and the consumer
+    whose turn it is to touch the slot (D. Vyukov's bounded queue). Producers
+    claim a position with a CAS on the head index; the consumer owns the tail
+    index exclusively, so popping needs no read-modify-write at all.
+
+    Capacity is rounded up to a power of two.
+ */
+template <typename T>
+class MpscRing
+{
+public:
+	explicit MpscRing(std::size_t capacity)
+	    : _mask {round_up(capacity) - 1}
+	    , _slots {std::make_unique<Slot[]>(_mask + 1)}
+	    , _head {0}
+	    , _tail {0}
+	{
+		for (std::size_t i {0}; i <= _mask; ++i) {
+			_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	/// Move \p value into the ring. Return false without side-effects if the ring is full.
+	template <typename U>
+	auto try_push(U&& value) -> bool
+	{
+		return try_push_with([&](T& slot) { slot = std::forward<U>(value); });
+	}
+
+	/** @brief Call \p fill with the next free slot, in place. Return false without calling it if the ring is full.
+
+	    The slot still holds a value moved from or consumed earlier, so \p fill
+	    can reuse its storage (e.g. std::string::assign() keeps the capacity).
+	 */
+	template <typename F>
+	auto try_push_with(F&& fill) -> bool
+	{
+		auto position {_head.load(std::memory_order_relaxed)};
+		Slot* slot;
+
+		for (;;) {
+			slot = &_slots[position & _mask];
+			auto const sequence {slot->sequence.load(std::memory_order_acquire)};
+			auto const difference {static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position)};
+
+			if (difference == 0) {
+				if (_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (difference < 0) {
+				return false;  // consumer has not released this slot yet
+			}
+			else {
+				position = _head.load(std::memory_order_relaxed);
+			}
+		}
+
+		fill(slot->value);
+		slot->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Move the oldest value into \p out. Only one thread may pop.
+	auto try_pop(T& out) -> bool
+	{
+		return try_pop_with([&](T& value) { out = std::move(value); });
+	}
+
+	/// Call \p consume with the oldest value, in place, then release its slot. Only one thread may pop.
+	template <typename F>
+	auto try_pop_with(F&& consume) -> bool
+	{
+		Slot& slot {_slots[_tail & _mask]};
+		auto const sequence {slot.sequence.load(std::memory_order_acquire)};
+
+		if (static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(_tail + 1) < 0) {
+			return false;  // empty, or a producer is still writing this slot
+		}
+
+		consume(slot.value);
+		slot.sequence.store(_tail + _mask + 1, std::memory_order_release);
+		++_tail;
+		return true;
+	}
+
+	/** @brief Call \p visit with each value pushed and not yet popped, oldest first, leaving them queued.
+
+	    Races with the consumer, and may see a value being popped: only for
+	    when the consumer cannot make progress, e.g. in a fatal-signal handler.
+	 */
+	template <typename F>
+	void peek_pending(F&& visit) const
+	{
+		auto const head {_head.load(std::memory_order_acquire)};
+
+		for (auto position {_tail}; position != head; ++position) {
+			Slot const& slot {_slots[position & _mask]};
+			if (slot.sequence.load(std::memory_order_acquire) == position + 1) {
+				visit(slot.value);
+			}
+		}
+	}
+
+	/// Number of positions ever claimed by producers.
+	auto claimed() const -> std::size_t
+	{
+		return _head.load(std::memory_order_acquire);
+	}
+
+	auto capacity() const -> std::size_t
+	{
+		return _mask + 1;
+	}
+
+private:
+	struct alignas(CacheLine) Slot
+	{
+		std::atomic<std::size_t> sequence;
+		T value;
+	};
+
+	static auto constexpr round_up(std::size_t value) -> std::size_t
+	{
+		std::size_t result {2};
+		while (result < value) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+	std::size_t const _mask;
+	std::unique_ptr<Slot[]> _slots;
+
+	alignas(CacheLine) std::atomic<std::size_t> _head;  // written by producers
+	alignas(CacheLine) std::size_t _tail;  // written by the consumer only
+};
+
+}  // namespace project::detail
+
+#endif  // MPSC_RING_HXX
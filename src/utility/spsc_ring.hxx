@@ -0,0 +1,119 @@
+#ifndef SPSC_RING_HXX
+#define SPSC_RING_HXX
+
+#include <atomic>
+#include <cstddef>
+#include <memory>  // for std::unique_ptr
+#include <utility>  // for std::forward, std::move
+
+#include <mpsc_ring.hxx>  // for detail::CacheLine
+
+namespace project {
+
+/** @brief Bounded lock-free single-producer, single-consumer queue.
+
+    The producer owns the head index and the consumer the tail. Each keeps a
+    copy of the other's index and re-reads it only when the ring looks full
+    or empty, so a push or pop mostly touches its own cache line and the slot.
+
+    Capacity is rounded up to a power of two.
+ */
+template <typename T>
+class SpscRing
+{
+public:
+	explicit SpscRing(std::size_t capacity)
+	    : _mask {round_up(capacity) - 1}
+	    , _slots {std::make_unique<T[]>(_mask + 1)}
+	    , _head {0}
+	    , _tail {0}
+	{}
+
+	/// Move \p value into the ring. Return false without side-effects if the ring is full. Only one thread may push.
+	template <typename U>
+	auto try_push(U&& value) -> bool
+	{
+		return try_push_with([&](T& slot) { slot = std::forward<U>(value); });
+	}
+
+	/** @brief Call \p fill with the next free slot, in place. Return false without calling it if the ring is full.
+
+	    The slot still holds a value moved from or consumed earlier, so \p fill
+	    can reuse its storage, e.g. by swapping with it. Only one thread may push.
+	 */
+	template <typename F>
+	auto try_push_with(F&& fill) -> bool
+	{
+		auto const head {_head.load(std::memory_order_relaxed)};
+
+		if (head - _tail_seen > _mask) {
+			_tail_seen = _tail.load(std::memory_order_acquire);
+			if (head - _tail_seen > _mask) {
+				return false;
+			}
+		}
+
+		fill(_slots[head & _mask]);
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Move the oldest value into \p out. Only one thread may pop.
+	auto try_pop(T& out) -> bool
+	{
+		return try_pop_with([&](T& value) { out = std::move(value); });
+	}
+
+	/// Call \p consume with the oldest value, in place, then release its slot. Only one thread may pop.
+	template <typename F>
+	auto try_pop_with(F&& consume) -> bool
+	{
+		auto const tail {_tail.load(std::memory_order_relaxed)};
+
+		if (tail == _head_seen) {
+			_head_seen = _head.load(std::memory_order_acquire);
+			if (tail == _head_seen) {
+				return false;
+			}
+		}
+
+		consume(_slots[tail & _mask]);
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Values pushed and not yet popped. Exact from the producer or the consumer; otherwise a recent value.
+	auto size() const -> std::size_t
+	{
+		auto const tail {_tail.load(std::memory_order_acquire)};  // first, so the difference is never negative
+		return _head.load(std::memory_order_acquire) - tail;
+	}
+
+	auto capacity() const -> std::size_t
+	{
+		return _mask + 1;
+	}
+
+private:
+	static auto constexpr round_up(std::size_t value) -> std::size_t
+	{
+		std::size_t result {2};
+		while (result < value) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+	std::size_t const _mask;
+	std::unique_ptr<T[]> _slots;
+
+	alignas(detail::CacheLine) std::atomic<std::size_t> _head;  // written by the producer
+	std::size_t _tail_seen {0};  // the producer's last read of _tail
+
+	alignas(detail::CacheLine) std::atomic<std::size_t> _tail;  // written by the consumer
+	std::size_t _head_seen {0};  // the consumer's last read of _head
+};
+
+}  // namespace project
+
+#endif  // SPSC_RING_HXX
@@ -0,0 +1,279 @@
+#include "trace.hxx"
+
+#include <algorithm>  // for std::max
+#include <cerrno>
+#include <cstdlib>  // for std::atexit
+#include <iterator>  // for std::back_inserter
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>  // for _getpid
+#else
+#include <unistd.h>  // for getpid
+#endif
+
+#include <fmt/format.h>
+
+#include "log_fields.hxx"  // for escape_json
+#include "log_sink.hxx"  // for thread_id
+
+namespace project::trace {
+
+namespace detail {
+std::atomic<bool> Active {false};
+}  // namespace detail
+
+namespace {
+
+struct Event
+{
+	std::string_view name;
+	std::uint64_t begin;
+	std::uint64_t end;
+};
+
+/** @brief Scopes recorded by one thread.
+
+    Only the owning thread writes. It resets the buffer when it first records
+    in a new generation (see start()); within a generation it only appends,
+    publishing each event with a release store of the count, so write() can
+    read what lies below the count without a lock on the writer's side.
+ */
+struct Buffer
+{
+	std::atomic<std::uint64_t> generation {0};
+	std::atomic<Event*> events {nullptr};
+	std::atomic<std::size_t> count {0};
+	std::atomic<std::uint64_t> dropped {0};
+	std::unique_ptr<Event[]> storage;  // owner only
+	std::size_t capacity {0};  // owner only
+	std::uint32_t thread {0};  // guarded by the registry lock
+	bool owned {false};  // guarded by the registry lock
+};
+
+// Generation and Capacity are stored under the registry lock and read by recording threads.
+std::atomic<std::uint64_t> Generation {0};
+std::atomic<std::size_t> Capacity {0};
+
+struct Registry
+{
+	std::mutex mutex;
+	std::vector<std::unique_ptr<Buffer>> buffers;
+	std::uint64_t origin {0};  // ticks at start()
+	std::string output;  // for write_at_exit()
+};
+
+auto registry() -> Registry&
+{
+	static Registry instance;
+	return instance;
+}
+
+/// Hands a buffer to each thread which records a scope; the buffer outlives the thread until the next start().
+struct Owner
+{
+	Owner()
+	{
+		auto& instance {registry()};
+		std::lock_guard const lock {instance.mutex};
+
+		auto const generation {Generation.load(std::memory_order_relaxed)};
+		for (auto const& candidate : instance.buffers) {
+			if (!candidate->owned && candidate->generation.load(std::memory_order_relaxed) != generation) {
+				buffer = candidate.get();  // its thread exited before this trace started
+				break;
+			}
+		}
+		if (!buffer) {
+			buffer = instance.buffers.emplace_back(std::make_unique<Buffer>()).get();
+		}
+
+		buffer->owned = true;
+		buffer->thread = log::detail::thread_id();
+	}
+
+	~Owner()
+	{
+		std::lock_guard const lock {registry().mutex};
+		buffer->owned = false;
+	}
+
+	Owner(Owner const&) = delete;
+	auto operator=(Owner const&) -> Owner& = delete;
+
+	Buffer* buffer {nullptr};
+};
+
+auto process_id() -> unsigned long
+{
+#ifdef _WIN32
+	return static_cast<unsigned long>(::_getpid());
+#else
+	return static_cast<unsigned long>(::getpid());
+#endif
+}
+
+/// Append \p nanoseconds as microseconds, the unit of trace-event timestamps, keeping every digit.
+void append_micros(fmt::memory_buffer& out, std::uint64_t const nanoseconds)
+{
+	fmt::format_to(std::back_inserter(out), "{}.{:03}", nanoseconds / 1000, nanoseconds % 1000);
+}
+
+void write_at_exit_handler()
+{
+	auto& instance {registry()};
+	stop();
+
+	try {
+		write(instance.output);
+	} catch (std::system_error const& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+	}
+}
+
+}  // namespace
+
+namespace detail {
+
+void record(std::string_view const name, std::uint64_t const begin, std::uint64_t const end)
+{
+	thread_local Owner const owner;
+	auto& buffer {*owner.buffer};
+
+	auto const generation {Generation.load(std::memory_order_acquire)};
+	if (buffer.generation.load(std::memory_order_relaxed) != generation) {
+		// write() skips this buffer until the new generation is published, so it can be reset freely.
+		auto const capacity {Capacity.load(std::memory_order_relaxed)};
+		if (buffer.capacity != capacity) {
+			buffer.storage = std::make_unique<Event[]>(capacity);
+			buffer.capacity = capacity;
+		}
+		buffer.events.store(buffer.storage.get(), std::memory_order_relaxed);
+		buffer.count.store(0, std::memory_order_relaxed);
+		buffer.dropped.store(0, std::memory_order_relaxed);
+		buffer.generation.store(generation, std::memory_order_release);
+	}
+
+	auto const count {buffer.count.load(std::memory_order_relaxed)};
+	if (count == buffer.capacity) {
+		buffer.dropped.store(buffer.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return;
+	}
+
+	buffer.storage[count] = {name, begin, end};
+	buffer.count.store(count + 1, std::memory_order_release);
+}
+
+}  // namespace detail
+
+void start(std::size_t const capacity)
+{
+	auto& instance {registry()};
+	std::lock_guard const lock {instance.mutex};
+
+	instance.origin = detail::ticks();
+	Capacity.store(capacity, std::memory_order_relaxed);
+	Generation.store(Generation.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	detail::Active.store(true, std::memory_order_relaxed);
+}
+
+void stop()
+{
+	detail::Active.store(false, std::memory_order_relaxed);
+}
+
+void write(std::FILE* const out)
+{
+	auto& instance {registry()};
+	std::lock_guard const lock {instance.mutex};  // keeps the generation, so no buffer is reset while read
+
+	auto const generation {Generation.load(std::memory_order_relaxed)};
+	auto const pid {process_id()};
+
+	fmt::memory_buffer text;
+	auto const append = [&](auto const&... args) { (text.append(std::string_view {args}), ...); };
+	auto const since = [&](std::uint64_t const ticks) { return ticks > instance.origin ? ticks - instance.origin : 0; };
+
+	append(R"({"displayTimeUnit":"ns","traceEvents":[)", "\n");
+	fmt::format_to(std::back_inserter(text),
+	               R"({{"name":"process_name","ph":"M","pid":{},"tid":0,"args":{{"name":"project"}}}})", pid);
+
+	for (auto const& buffer : instance.buffers) {
+		if (generation == 0 || buffer->generation.load(std::memory_order_acquire) != generation) {
+			continue;  // nothing recorded since start()
+		}
+
+		auto const count {buffer->count.load(std::memory_order_acquire)};
+		auto const* const events {buffer->events.load(std::memory_order_relaxed)};
+
+		for (std::size_t i {0}; i < count; ++i) {
+			auto const& event {events[i]};
+			auto const begin {since(event.begin)};
+			auto const end {std::max(since(event.end), begin)};
+
+			append(",\n", R"({"name":")");
+			log::detail::escape_json(text, event.name);
+			append(R"(","ph":"X","ts":)");
+			append_micros(text, begin);
+			append(R"(,"dur":)");
+			append_micros(text, end - begin);
+			fmt::format_to(std::back_inserter(text), R"(,"pid":{},"tid":{}}})", pid, buffer->thread);
+
+			if (text.size() >= 64 * 1024) {
+				std::fwrite(text.data(), 1, text.size(), out);
+				text.clear();
+			}
+		}
+	}
+
+	append("\n]}\n");
+	std::fwrite(text.data(), 1, text.size(), out);
+	std::fflush(out);
+}
+
+void write(std::string const& path)
+{
+	std::FILE* out {std::fopen(path.c_str(), "wb")};
+	if (!out) {
+		throw std::system_error {errno, std::generic_category(), "cannot write trace to " + path};
+	}
+
+	write(out);
+
+	bool const failed {std::ferror(out) != 0};
+	if (std::fclose(out) != 0 || failed) {
+		throw std::system_error {EIO, std::generic_category(), "cannot write trace to " + path};
+	}
+}
+
+void write_at_exit(std::string path)
+{
+	auto& instance {registry()};
+	std::lock_guard const lock {instance.mutex};
+
+	if (instance.output.empty()) {
+		std::atexit(write_at_exit_handler);  // after registry(), so it runs before the registry is destroyed
+	}
+	instance.output = std::move(path);
+}
+
+auto dropped() -> std::uint64_t
+{
+	auto& instance {registry()};
+	std::lock_guard const lock {instance.mutex};
+
+	auto const generation {Generation.load(std::memory_order_relaxed)};
+	std::uint64_t total {0};
+
+	for (auto const& buffer : instance.buffers) {
+		if (buffer->generation.load(std::memory_order_acquire) == generation) {
+			total += buffer->dropped.load(std::memory_order_relaxed);
+		}
+	}
+	return total;
+}
+
+}  // namespace project::trace
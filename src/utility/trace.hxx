@@ -0,0 +1,113 @@
+#ifndef TRACE_HXX
+#define TRACE_HXX
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include <project_dll-export.h>
+
+/** @file
+    Timeline of scopes across threads, written as Chrome trace-event JSON.
+
+    While tracing, each Scope records its name, start and end in a buffer
+    owned by its thread; appending takes no lock and no read-modify-write.
+    write() turns the buffers into a file which Perfetto (ui.perfetto.dev) or
+    chrome://tracing opens directly, one track per thread. A metrics::Span
+    records its scope too, under its histogram's name.
+
+    When not tracing, a Scope costs one relaxed load.
+ */
+
+#ifndef ENABLE_METRICS
+#define ENABLE_METRICS 0
+#endif
+
+namespace project::trace {
+
+namespace detail {
+DLL extern std::atomic<bool> Active;
+
+/// Record a scope of this thread, in detail::ticks().
+DLL void record(std::string_view name, std::uint64_t begin, std::uint64_t end);
+
+/// Nanoseconds on the steady clock.
+inline auto ticks() -> std::uint64_t
+{
+	auto const since {std::chrono::steady_clock::now().time_since_epoch()};
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(since).count());
+}
+}  // namespace detail
+
+/** @brief Start tracing, discarding scopes recorded before.
+
+    Each thread keeps up to \p capacity scopes; later ones are dropped and
+    counted (see dropped()).
+ */
+DLL void start(std::size_t capacity = std::size_t {1} << 16);
+
+/// Stop recording scopes. What was recorded is kept for write().
+DLL void stop();
+
+inline auto active() -> bool
+{
+	return detail::Active.load(std::memory_order_relaxed);
+}
+
+/// Write the scopes recorded since start() as Chrome trace-event JSON. May be called while tracing.
+DLL void write(std::FILE* out);
+
+/// Write the trace to the file at \p path, replacing it. Throw std::system_error if it cannot be written.
+DLL void write(std::string const& path);
+
+/// Stop tracing and write the trace to \p path when the program exits normally; errors go to stderr.
+DLL void write_at_exit(std::string path);
+
+/// Scopes dropped since start() because a thread's buffer was full.
+DLL auto dropped() -> std::uint64_t;
+
+/** @brief Record the lifetime of this object while tracing.
+
+    \p name must outlive the trace, e.g. a string literal.
+ */
+class Scope
+{
+public:
+	explicit Scope(std::string_view const name)
+	    : _name {name}
+	    , _begin {active() ? detail::ticks() : 0}
+	{}
+
+	~Scope()
+	{
+		if (_begin != 0) {
+			detail::record(_name, _begin, detail::ticks());
+		}
+	}
+
+	Scope(Scope const&) = delete;
+	auto operator=(Scope const&) -> Scope& = delete;
+
+private:
+	std::string_view const _name;
+	std::uint64_t const _begin;  // zero if not tracing when constructed
+};
+
+}  // namespace project::trace
+
+#define PROJECT_TRACE_CONCAT_(a, b) a##b
+#define PROJECT_TRACE_CONCAT(a, b)  PROJECT_TRACE_CONCAT_(a, b)
+
+#if ENABLE_METRICS
+/// Trace the rest of the enclosing scope as \p name, a string literal. Compiled in with the metrics.
+#define PROJECT_TRACE_SCOPE(name) \
+	::project::trace::Scope const PROJECT_TRACE_CONCAT(project_trace_scope_, __LINE__) {name}
+#else
+#define PROJECT_TRACE_SCOPE(name) static_assert(true)
+#endif
+
+#endif  // TRACE_HXX
@@ -0,0 +1,339 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <allocations.hxx>
+
+#define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL  // measure every level regardless of the configured floor
+#include <log.hxx>
+#include <log_async.hxx>
+#include <log_category.hxx>
+#include <log_compress.hxx>
+#include <log_index.hxx>
+#include <log_limit.hxx>
+#include <log_sink.hxx>
+#undef ENABLE_LOGGING
+
+using namespace project;
+
+namespace {
+
+auto null_file() -> std::FILE*
+{
+#ifdef _WIN32
+	static std::FILE* const file {std::fopen("NUL", "w")};
+#else
+	static std::FILE* const file {std::fopen("/dev/null", "w")};
+#endif
+	return file;
+}
+
+class Discard : public log::Sink
+{
+public:
+	void write(log::Event const&) override
+	{}
+};
+
+/// Report heap allocations per iteration, counted from \p before.
+void count_allocations(benchmark::State& state, std::size_t const before)
+{
+	auto const allocations {static_cast<double>(test::allocations() - before)};
+	state.counters["allocs/call"] = benchmark::Counter {allocations, benchmark::Counter::kAvgIterations};
+}
+
+void to_null_file(benchmark::State const&)
+{
+	log::set_sink(nullptr);
+	log::set_target(null_file());
+	log::set_level(log::Level::Info);
+}
+
+void to_discard_sink(benchmark::State const&)
+{
+	log::set_sink(std::make_shared<Discard>());
+	log::set_level(log::Level::Info);
+}
+
+void to_error_sink(benchmark::State const&)
+{
+	log::add_sink(std::make_shared<Discard>(), log::Level::Error);
+	log::set_level(log::Level::Info);
+}
+
+void to_backend(benchmark::State const& state)
+{
+	to_null_file(state);
+	log::start_backend();
+}
+
+void stop(benchmark::State const&)
+{
+	log::stop_backend();
+	log::set_sink(nullptr);
+	log::set_target(stderr);
+	log::set_level(log::Level::None);
+}
+
+/*
+	Enabled vs disabled levels
+ */
+
+void print_disabled(benchmark::State& state)
+{
+	auto const before {test::allocations()};
+	for (auto _ : state) {
+		log::debug("value {} {}", 42, "text");
+	}
+	count_allocations(state, before);
+}
+BENCHMARK(print_disabled)->Setup(to_null_file)->Teardown(stop);
+
+void macro_disabled(benchmark::State& state)
+{
+	auto const before {test::allocations()};
+	for (auto _ : state) {
+		PROJECT_LOG_DEBUG("value {} {}", 42, "text");
+	}
+	count_allocations(state, before);
+}
+BENCHMARK(macro_disabled)->Setup(to_null_file)->Teardown(stop);
+
+void print_enabled(benchmark::State& state)
+{
+	auto const before {test::allocations()};
+	for (auto _ : state) {
+		log::info("value {} {}", 42, "text");
+	}
+	count_allocations(state, before);
+}
+BENCHMARK(print_enabled)->Setup(to_null_file)->Teardown(stop);
+BENCHMARK(print_enabled)->Name("print_enabled/sink")->Setup(to_discard_sink)->Teardown(stop);
+BENCHMARK(print_enabled)->Name("print_enabled/unrouted")->Setup(to_error_sink)->Teardown(stop);
+
+void macro_enabled(benchmark::State& state)
+{
+	auto const before {test::allocations()};
+	for (auto _ : state) {
+		PROJECT_LOG_INFO("value {} {}", 42, "text");
+	}
+	count_allocations(state, before);
+}
+BENCHMARK(macro_enabled)->Setup(to_null_file)->Teardown(stop);
+
+/*
+	Limited call sites, mostly suppressed
+ */
+
+void every_n(benchmark::State& state)
+{
+	for (auto _ : state) {
+		PROJECT_LOG_EVERY_N(log::Level::Info, 1'000'000, "value {} {}", 42, "text");
+	}
+}
+BENCHMARK(every_n)->Setup(to_null_file)->Teardown(stop);
+
+void rate_limited(benchmark::State& state)
+{
+	for (auto _ : state) {
+		PROJECT_LOG_RATE_LIMITED(log::Level::Info, 1, 1, "value {} {}", 42, "text");
+	}
+}
+BENCHMARK(rate_limited)->Setup(to_null_file)->Teardown(stop);
+
+void deduplicated(benchmark::State& state)
+{
+	for (auto _ : state) {
+		PROJECT_LOG_DEDUPLICATED(log::Level::Info, "value {} {}", 42, "text");
+	}
+}
+BENCHMARK(deduplicated)->Setup(to_null_file)->Teardown(stop);
+
+/*
+	Throughput from 1 to N threads
+ */
+
+int const MaxThreads {static_cast<int>(std::max(2u, std::thread::hardware_concurrency()))};
+
+void print_threads(benchmark::State& state)
+{
+	for (auto _ : state) {
+		log::info("thread {} value {}", state.thread_index(), 42);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(print_threads)->ThreadRange(1, MaxThreads)->UseRealTime()->Setup(to_null_file)->Teardown(stop);
+BENCHMARK(print_threads)
+    ->Name("print_threads/async")
+    ->ThreadRange(1, MaxThreads)
+    ->UseRealTime()
+    ->Setup(to_backend)
+    ->Teardown(stop);
+
+/*
+	Call latency percentiles
+
+	Each call is timed separately, so the figures include the cost of reading
+	the clock twice; compare them between releases rather than with the mean.
+ */
+
+void record_latency(benchmark::State& state, void (*call)())
+{
+	using Clock = std::chrono::steady_clock;
+
+	std::size_t constexpr MaxSamples {1 << 20};
+	std::vector<std::int64_t> samples;
+	samples.reserve(MaxSamples);
+
+	for (auto _ : state) {
+		auto const start {Clock::now()};
+		call();
+		auto const stop {Clock::now()};
+		if (samples.size() < MaxSamples) {
+			samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+		}
+	}
+
+	if (samples.empty()) {
+		return;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	auto const percentile {[&](double const p) {
+		return static_cast<double>(samples[static_cast<std::size_t>(p * static_cast<double>(samples.size() - 1))]);
+	}};
+	state.counters["p50_ns"] = percentile(0.5);
+	state.counters["p99_ns"] = percentile(0.99);
+	state.counters["p99.9_ns"] = percentile(0.999);
+}
+
+void latency_sync(benchmark::State& state)
+{
+	record_latency(state, [] { log::info("value {} {}", 42, "text"); });
+}
+BENCHMARK(latency_sync)->Setup(to_null_file)->Teardown(stop);
+
+void latency_async(benchmark::State& state)
+{
+	record_latency(state, [] { log::info("value {} {}", 42, "text"); });
+}
+BENCHMARK(latency_async)->Setup(to_backend)->Teardown(stop);
+
+/*
+	Compression, of a block of typical log text
+ */
+
+auto log_block() -> std::string
+{
+	std::string text;
+	for (int i {0}; text.size() < (std::size_t {64} << 10); ++i) {
+		text += fmt::format("2024-05-01 12:{:02}:{:02}.{:06} [{}] Info: request {} served in {} us\n", i / 60 % 60,
+		                    i % 60, i * 7919 % 1000000, 4100 + i % 4, i, i * 37 % 5000);
+	}
+	return text;
+}
+
+void compress(benchmark::State& state)
+{
+	auto const text {log_block()};
+	fmt::memory_buffer out;
+	for (auto _ : state) {
+		out.clear();
+		log::detail::compress(text.data(), text.size(), out);
+		benchmark::DoNotOptimize(out.data());
+	}
+	state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * text.size()));
+	state.counters["ratio"] = static_cast<double>(text.size()) / static_cast<double>(out.size());
+}
+BENCHMARK(compress);
+
+void decompress(benchmark::State& state)
+{
+	auto const text {log_block()};
+	fmt::memory_buffer data;
+	log::detail::compress(text.data(), text.size(), data);
+
+	std::string out(text.size(), '\0');
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(log::detail::decompress(data.data(), data.size(), out.data(), out.size()));
+	}
+	state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * text.size()));
+}
+BENCHMARK(decompress);
+
+/*
+	Search, for text absent from a block of typical log text
+ */
+
+void find(benchmark::State& state)
+{
+	auto const text {log_block()};
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(log::detail::find(text, "served in 9999 us"));
+	}
+	state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * text.size()));
+}
+BENCHMARK(find);
+
+void find_string_view(benchmark::State& state)  // for comparison
+{
+	auto const text {log_block()};
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(std::string_view {text}.find("served in 9999 us"));
+	}
+	state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * text.size()));
+}
+BENCHMARK(find_string_view);
+
+/*
+	Helpers
+ */
+
+void level_from(benchmark::State& state, std::string_view const text)
+{
+	auto const before {test::allocations()};
+	for (auto _ : state) {
+		auto input {text};
+		benchmark::DoNotOptimize(input);  // level_from() is constexpr: keep it from folding
+		auto level {log::level_from(input)};
+		benchmark::DoNotOptimize(level);
+	}
+	count_allocations(state, before);
+}
+BENCHMARK_CAPTURE(level_from, valid, "warning");
+BENCHMARK_CAPTURE(level_from, mixed_case, "WarNing");
+BENCHMARK_CAPTURE(level_from, invalid, "unknown");
+
+void parse_levels(benchmark::State& state)
+{
+	auto const before {test::allocations()};
+	for (auto _ : state) {
+		auto levels {log::parse_levels("info,net=trace,db=warn")};
+		benchmark::DoNotOptimize(levels);
+	}
+	count_allocations(state, before);
+}
+BENCHMARK(parse_levels);
+
+void print_enabled_levels(benchmark::State& state)
+{
+	auto const before {test::allocations()};
+	for (auto _ : state) {
+		log::print_enabled_levels();
+	}
+	count_allocations(state, before);
+}
+BENCHMARK(print_enabled_levels)->Setup(to_null_file)->Teardown(stop);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,45 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#define ENABLE_METRICS 1
+#include <metrics.hxx>
+#undef ENABLE_METRICS
+
+using namespace project;
+
+static void counter_add(benchmark::State& state)
+{
+	auto& counter {metrics::counter("benchmark.counter")};
+	for (auto _ : state) {
+		counter.add();
+	}
+}
+BENCHMARK(counter_add)->ThreadRange(1, 8)->UseRealTime();
+
+static void histogram_record(benchmark::State& state)
+{
+	auto& histogram {metrics::histogram("benchmark.histogram")};
+	std::uint64_t value {0};
+	for (auto _ : state) {
+		histogram.record(value += 37);
+	}
+}
+BENCHMARK(histogram_record)->ThreadRange(1, 8)->UseRealTime();
+
+static void span(benchmark::State& state)
+{
+	for (auto _ : state) {
+		PROJECT_METRICS_SPAN("benchmark.span");
+	}
+}
+BENCHMARK(span);
+
+static void snapshot(benchmark::State& state)
+{
+	metrics::histogram("benchmark.snapshot").record(1);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(metrics::snapshot());
+	}
+}
+BENCHMARK(snapshot);
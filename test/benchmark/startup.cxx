@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+/*
+	Process startup: exec to exit of app-console
+
+	What a script pays for each run, including loading the shared library.
+	Options given once are parsed in place; a repeated one makes Cli fall
+	back to cxxopts.
+ */
+
+namespace {
+void startup(benchmark::State& state, std::vector<char const*> arguments)
+{
+	arguments.insert(arguments.begin(), APP_CONSOLE);
+	arguments.push_back(nullptr);
+
+	::posix_spawn_file_actions_t actions;
+	::posix_spawn_file_actions_init(&actions);
+	::posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+	::posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+
+	for (auto _ : state) {
+		::pid_t child {0};
+		auto* const argv {const_cast<char* const*>(arguments.data())};
+		int status {0};
+
+		if (::posix_spawn(&child, APP_CONSOLE, &actions, nullptr, argv, environ) != 0
+		    || ::waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			state.SkipWithError("app-console did not run to completion");
+			break;
+		}
+	}
+
+	::posix_spawn_file_actions_destroy(&actions);
+}
+}  // namespace
+
+BENCHMARK_CAPTURE(startup, no_options, std::vector<char const*> {})->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK_CAPTURE(startup, version, std::vector<char const*> {"--version"})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(startup, version_cxxopts, std::vector<char const*> {"--version", "--version"})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
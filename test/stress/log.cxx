@@ -0,0 +1,280 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL  // stress every level regardless of the configured floor
+#include <log.hxx>
+#include <log_async.hxx>
+#include <log_category.hxx>
+#include <log_fields.hxx>
+#include <log_limit.hxx>
+#include <log_sink.hxx>
+#undef ENABLE_LOGGING
+
+using namespace project;
+
+/*
+	Many threads log through every entry point while another changes the
+	levels and the log target. Every line written must be one whole record,
+	every Error record must be written exactly once, and no other record more
+	than once.
+ */
+
+namespace {
+int constexpr Threads {8};
+int constexpr Records {2000};  // per thread
+
+log::Level constexpr Levels[] {log::Level::Error, log::Level::Warning, log::Level::Info, log::Level::Debug,
+                               log::Level::Trace};
+
+/// How records reach the output.
+enum class Path
+{
+	Direct,  ///< Written to the log target by the emitting thread.
+	Backend,  ///< Queued for the asynchronous backend.
+	Deferred,  ///< Queued with the arguments, formatted by the backend.
+	Sink,  ///< Written to a FileSink.
+};
+
+/// Text padding each record, of a length and letter which depend on the record.
+auto payload(int const thread, int const record) -> std::string
+{
+	return std::string(static_cast<std::size_t>(8 + (thread * 7 + record) % 56), static_cast<char>('a' + thread));
+}
+
+/// Emit record \p record of \p thread at Error, through an entry point chosen by \p record; then at Debug and Trace.
+void emit(int const thread, int const record)
+{
+	static log::Site constexpr site {__FILE__, __LINE__, "emit", log::Level::Error};
+	static auto const& category {log::category("stress")};
+	auto const text {payload(thread, record)};
+
+	switch (record % 7) {
+	case 0: log::error("stress {} {} {}", thread, record, text); break;
+	case 1: PROJECT_LOG_ERROR("stress {} {} {}", thread, record, text); break;
+	case 2: log::print(log::Level::Error, "stress {} {} {}", thread, record, text); break;
+	case 3: log::print(site, "stress {} {} {}", thread, record, text, log::kv("thread", thread)); break;
+	case 4: PROJECT_LOG_CATEGORY_ERROR("stress", "stress {} {} {}", thread, record, text); break;
+	case 5: log::print(category, log::Level::Error, "stress {} {} {}", thread, record, text); break;
+	case 6: PROJECT_LOG_EVERY_N(log::Level::Error, 1, "stress {} {} {}", thread, record, text); break;
+	}
+
+	log::debug("stress {} {} {}", thread, record, text);
+	PROJECT_LOG_TRACE("stress {} {} {}", thread, record, text);
+}
+
+/// The line emit() writes for record \p record of thread \p thread at \p level.
+auto expected(log::Level const level, int const thread, int const record) -> std::string
+{
+	auto line {fmt::format("{}: stress {} {} {}", log::level_label(level), thread, record, payload(thread, record))};
+	if (level == log::Level::Error && record % 7 == 3) {
+		line += fmt::format(" thread={}", thread);
+	}
+	return line;
+}
+
+auto read(std::FILE* file) -> std::string
+{
+	std::string result;
+	std::fflush(file);
+	std::rewind(file);
+	char buffer[4096];
+	while (auto const size {std::fread(buffer, 1, sizeof buffer, file)}) {
+		result.append(buffer, size);
+	}
+	return result;
+}
+}  // namespace
+
+class LogStress : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		for (auto& file : _files) {
+			file = std::tmpfile();
+			ASSERT_NE(nullptr, file);
+		}
+		log::set_target(_files[0]);
+		log::set_level(log::Level::Trace);
+	}
+
+	void TearDown() override
+	{
+		log::stop_backend();
+		log::set_target(stderr);
+		log::category("stress").reset_level();
+		log::set_level(log::Level::None);
+		for (auto* const file : _files) {
+			std::fclose(file);
+		}
+	}
+
+	/// Log from Threads threads along \p path while the levels, and the target unless \p path is Sink, change.
+	void hammer(Path const path)
+	{
+		log::SinkId sink {0};
+		if (path == Path::Backend || path == Path::Deferred) {
+			log::AsyncOptions options;
+			options.capacity = 1024;  // small, so producers wait on a full queue
+			options.defer_formatting = path == Path::Deferred;
+			log::start_backend(options);
+		}
+		else if (path == Path::Sink) {
+			sink = log::add_sink(std::make_shared<log::FileSink>(_files[0]));
+		}
+
+		std::atomic<int> running {Threads};
+		std::vector<std::thread> writers;
+		for (int thread {0}; thread < Threads; ++thread) {
+			writers.emplace_back([&running, thread] {
+				for (int record {0}; record < Records; ++record) {
+					emit(thread, record);
+				}
+				running.fetch_sub(1);
+			});
+		}
+
+		// Error stays enabled throughout, so every Error record must be written.
+		for (std::size_t change {0}; running.load() > 0; ++change) {
+			auto const level {Levels[change % std::size(Levels)]};
+			switch (change % 4) {
+			case 0: log::set_level(level); break;
+			case 1: log::category("stress").set_level(level); break;
+			case 2: log::category("stress").reset_level(); break;
+			case 3: log::configure(change % 8 == 3 ? "trace,stress=error" : "error"); break;
+			}
+			if (path != Path::Sink) {
+				log::set_target(_files[change % 2]);
+			}
+			std::this_thread::yield();
+		}
+
+		for (auto& writer : writers) {
+			writer.join();
+		}
+
+		log::stop_backend();
+		if (path == Path::Sink) {
+			log::remove_sink(sink);  // flushes it
+		}
+		check(read(_files[0]) + read(_files[1]));
+	}
+
+	/// Check every line of \p text is a whole record, and every record is written as often as it must be.
+	static void check(std::string_view text)
+	{
+		std::vector<std::uint8_t> seen(static_cast<std::size_t>(Threads * Records * 3));
+		std::size_t lines {0};
+
+		for (std::size_t begin {0}, end {0}; begin < text.size(); begin = end + 1) {
+			end = text.find('\n', begin);
+			ASSERT_NE(std::string_view::npos, end) << "unterminated line at " << begin;
+			auto const line {text.substr(begin, end - begin)};
+			++lines;
+
+			int thread {-1};
+			int record {-1};
+			char label[16] {};
+			std::string const copy {line};
+			std::sscanf(copy.c_str(), "%15[A-Za-z]: stress %d %d", label, &thread, &record);
+
+			auto const level {log::detail::parse_level(label)};
+			ASSERT_TRUE(level && thread >= 0 && thread < Threads && record >= 0 && record < Records)
+			    << "torn line: " << line;
+			ASSERT_EQ(expected(*level, thread, record), line);
+
+			std::size_t const which {*level == log::Level::Error ? 0u : *level == log::Level::Debug ? 1u : 2u};
+			auto& count {seen[(static_cast<std::size_t>(thread * Records + record)) * 3 + which]};
+			ASSERT_EQ(0, count) << "written twice: " << line;
+			count = 1;
+		}
+
+		for (int thread {0}; thread < Threads; ++thread) {
+			for (int record {0}; record < Records; ++record) {
+				ASSERT_EQ(1, seen[static_cast<std::size_t>(thread * Records + record) * 3])
+				    << "lost: " << expected(log::Level::Error, thread, record);
+			}
+		}
+		EXPECT_GE(lines, std::size_t {Threads * Records});
+	}
+
+	std::FILE* _files[2] {};
+};
+
+TEST_F(LogStress, direct)
+{
+	hammer(Path::Direct);
+}
+
+TEST_F(LogStress, backend)
+{
+	hammer(Path::Backend);
+}
+
+TEST_F(LogStress, deferred)
+{
+	hammer(Path::Deferred);
+}
+
+TEST_F(LogStress, sink)
+{
+	hammer(Path::Sink);
+}
+
+/*
+	Throughput as threads are added
+
+	The threads share a fixed number of records, so on an unloaded machine the
+	rate should hold or rise; a rate falling far below one thread's means
+	contention collapse. Rates are printed, and recorded in the XML report, for
+	a person or a tracking job to compare: wall-clock rates on a shared machine
+	are too noisy to fail the test on.
+ */
+TEST_F(LogStress, throughput_by_threads)
+{
+	int constexpr Total {64'000};
+	log::set_level(log::Level::Info);
+
+	auto const rate {[](int const threads) {
+		std::atomic<bool> go {false};
+		std::vector<std::thread> writers;
+		for (int thread {0}; thread < threads; ++thread) {
+			writers.emplace_back([&go, thread, threads] {
+				while (!go.load()) {
+					std::this_thread::yield();
+				}
+				for (int record {0}; record < Total / threads; ++record) {
+					log::info("throughput {} {}", thread, record);
+				}
+			});
+		}
+
+		auto const started {std::chrono::steady_clock::now()};
+		go = true;
+		for (auto& writer : writers) {
+			writer.join();
+		}
+		std::chrono::duration<double> const elapsed {std::chrono::steady_clock::now() - started};
+		return Total / elapsed.count();
+	}};
+
+	auto const single {rate(1)};
+	std::printf("%2d threads: %10.0f records/s\n", 1, single);
+	RecordProperty("threads_1", static_cast<int>(single));
+
+	for (int threads {2}; threads <= 32; threads *= 2) {
+		auto const records {rate(threads)};
+		std::printf("%2d threads: %10.0f records/s (%.2fx)\n", threads, records, records / single);
+		RecordProperty("threads_" + std::to_string(threads), static_cast<int>(records));
+	}
+}
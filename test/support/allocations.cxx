@@ -0,0 +1,37 @@
+#include "allocations.hxx"
+
+#include <atomic>
+#include <cstdlib>  // for std::malloc, std::free
+#include <new>
+
+namespace {
+std::atomic<std::size_t> Allocations {0};
+}  // namespace
+
+auto operator new(std::size_t size) -> void*
+{
+	Allocations.fetch_add(1, std::memory_order_relaxed);
+	if (auto* pointer {std::malloc(size ? size : 1)}) {
+		return pointer;
+	}
+	throw std::bad_alloc {};
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+namespace project::test {
+
+auto allocations() -> std::size_t
+{
+	return Allocations.load(std::memory_order_relaxed);
+}
+
+}  // namespace project::test
@@ -0,0 +1,19 @@
+#ifndef TEST_ALLOCATIONS_HXX
+#define TEST_ALLOCATIONS_HXX
+
+#include <cstddef>
+
+namespace project::test {
+
+/** @brief Number of heap allocations made so far in the process, by any thread.
+
+    Counted by the replacement operator new which linking test-support adds
+    to the executable. It counts inside the project library too, where the
+    platform lets it replace the library's: ELF and Mach-O do, a Windows DLL
+    keeps its own.
+ */
+auto allocations() -> std::size_t;
+
+}  // namespace project::test
+
+#endif  // TEST_ALLOCATIONS_HXX
@@ -0,0 +1,26 @@
+#include "collect.hxx"
+
+namespace project::test {
+
+Collect::Collect(Format const format, bool const deferred)
+    : _format {format}
+    , _deferred {deferred}
+{}
+
+void Collect::write(log::Event const& event)
+{
+	fmt::memory_buffer buffer;
+	if (_format == Format::Text) {
+		log::format_text(buffer, event);
+	}
+	else {
+		log::format_message(buffer, event);
+	}
+
+	std::lock_guard const lock {_mutex};
+	lines.emplace_back(buffer.data(), buffer.size());
+	packed.push_back(event.packed != nullptr);
+	sites.push_back(event.site);
+}
+
+}  // namespace project::test
@@ -0,0 +1,47 @@
+#ifndef TEST_COLLECT_HXX
+#define TEST_COLLECT_HXX
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <log_sink.hxx>
+
+namespace project::test {
+
+/** @brief Sink which keeps what it is given, for a test to compare afterwards.
+
+    Writes from several threads are serialized; read the members once they
+    have stopped.
+ */
+class Collect : public log::Sink
+{
+public:
+	enum class Format
+	{
+		Text,  ///< Whole lines, as log::format_text() writes them.
+		Message,  ///< The message alone, as log::format_message() writes it.
+	};
+
+	explicit Collect(Format format = Format::Text, bool deferred = false);
+
+	void write(log::Event const& event) override;
+
+	auto deferred() const -> bool override
+	{
+		return _deferred;
+	}
+
+	std::vector<std::string> lines;
+	std::vector<bool> packed;  ///< Whether each event carried captured arguments.
+	std::vector<log::Site const*> sites;
+
+private:
+	Format _format;
+	bool _deferred;
+	std::mutex _mutex;
+};
+
+}  // namespace project::test
+
+#endif  // TEST_COLLECT_HXX
@@ -1,6 +1,13 @@
 #include <gtest/gtest.h>
 
+#ifdef PROJECT_LOG_MIN_LEVEL
+int constexpr configured_min_level {PROJECT_LOG_MIN_LEVEL};  // print_enabled_levels() clamps to this
+#else
+int constexpr configured_min_level {5};
+#endif
+
 #define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL  // test every level regardless of the configured floor
 #include <log.hxx>
 #undef ENABLE_LOGGING
 
@@ -217,6 +224,25 @@ TEST_F(Log, level_from_empty)
 	EXPECT_EQ(log::Level::None, log::level_from(""));
 }
 
+TEST_F(Log, level_from_constexpr)
+{
+	static_assert(log::level_from("Warning") == log::Level::Warning);
+	static_assert(log::level_from("tRaCe") == log::Level::Trace);
+	static_assert(log::level_from("traces") == log::Level::None);
+
+	// Same size and last character as a level, so the same slot: the comparison must reject them.
+	EXPECT_EQ(log::Level::None, log::level_from("trade"));
+	EXPECT_EQ(log::Level::None, log::level_from("stratus"));
+	EXPECT_EQ(log::Level::None, log::level_from("INF0"));
+	EXPECT_EQ(log::Level::None, log::level_from("info\n"));
+
+	EXPECT_FALSE(log::detail::parse_level("unknown").has_value());
+	EXPECT_EQ(log::Level::None, log::detail::parse_level("None"));
+	for (auto const& [name, level] : log::detail::LevelNames) {
+		EXPECT_EQ(level, log::detail::parse_level(name)) << name;
+	}
+}
+
 TEST_F(Log, level_label)
 {
 	EXPECT_EQ("Error", log::level_label(log::Level::Error));
@@ -280,6 +306,9 @@ TEST_F(Log, print_enabled_levels_info)
 
 TEST_F(Log, print_enabled_levels_debug)
 {
+	if (configured_min_level < static_cast<int>(log::Level::Debug)) {
+		GTEST_SKIP() << "Debug is below the configured PROJECT_LOG_MIN_LEVEL";
+	}
 	log::set_level(log::Level::Debug);
 	::testing::internal::CaptureStderr();
 	log::print_enabled_levels();
@@ -289,6 +318,9 @@ TEST_F(Log, print_enabled_levels_debug)
 
 TEST_F(Log, print_enabled_levels_trace)
 {
+	if (configured_min_level < static_cast<int>(log::Level::Trace)) {
+		GTEST_SKIP() << "Trace is below the configured PROJECT_LOG_MIN_LEVEL";
+	}
 	log::set_level(log::Level::Trace);
 	::testing::internal::CaptureStderr();
 	log::print_enabled_levels();
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include <allocations.hxx>
+
+#define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL  // test every level regardless of the configured floor
+#include <log_async.hxx>
+#include <log_binary.hxx>
+#include <log_sink.hxx>
+#undef ENABLE_LOGGING
+
+using namespace project;
+
+namespace {
+
+/// Number of heap allocations made while running \p function, by any thread.
+template <typename Function>
+auto allocations_during(Function&& function) -> std::size_t
+{
+	auto const before {test::allocations()};
+	function();
+	return test::allocations() - before;
+}
+
+struct Nested  // logs while being formatted
+{};
+
+}  // namespace
+
+template <>
+struct fmt::formatter<Nested> : fmt::formatter<int>
+{
+	auto format(Nested const&, fmt::format_context& context) const
+	{
+		log::debug("nested {}", 1);
+		return fmt::formatter<int>::format(0, context);
+	}
+};
+
+class LogAllocations : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		_file = std::tmpfile();
+		ASSERT_NE(nullptr, _file);
+		log::set_target(_file);
+		log::set_level(log::Level::Trace);
+	}
+
+	void TearDown() override
+	{
+		log::stop_backend();
+		log::set_sink(nullptr);
+		log::set_target(stderr);
+		log::set_level(log::Level::None);
+		std::fclose(_file);
+	}
+
+	/// Log a mix of messages; each is formatted, or captured, on the calling thread.
+	static void log_messages(int count)
+	{
+		static std::string const long_text(1000, 'x');  // outgrows every inline buffer
+
+		for (int i {0}; i < count; ++i) {
+			log::info("{} {} {}", "message", i, 0.5);
+			log::warning("{}", long_text);
+			PROJECT_LOG_DEBUG("{:>20}", i);
+		}
+	}
+
+	std::FILE* _file {nullptr};
+};
+
+TEST_F(LogAllocations, target)
+{
+	log_messages(10);  // warm up: grow buffers
+	ASSERT_EQ(0u, allocations_during([] { log_messages(1000); }));
+}
+
+TEST_F(LogAllocations, sink)
+{
+	log::set_sink(std::make_shared<log::BinarySink>(_file));
+	log_messages(10);
+	ASSERT_EQ(0u, allocations_during([] { log_messages(1000); }));
+}
+
+TEST_F(LogAllocations, backend)
+{
+	log::start_backend({16, log::Overflow::Block, false});
+	log_messages(100);  // every slot has held a long message
+	log::flush();
+	ASSERT_EQ(0u, allocations_during([] {
+		log_messages(1000);
+		log::flush();
+	}));
+}
+
+TEST_F(LogAllocations, backend_deferred)
+{
+	log::start_backend({16, log::Overflow::Block, true});
+	log_messages(100);
+	log::flush();
+	ASSERT_EQ(0u, allocations_during([] {
+		log_messages(1000);
+		log::flush();
+	}));
+}
+
+TEST_F(LogAllocations, fields)
+{
+	auto const log_fields {[] {
+		for (int i {0}; i < 1000; ++i) {
+			log::info("request done", log::kv("latency_us", i), log::kv("path", "/a b"), log::kv("ratio", 0.5));
+		}
+	}};
+
+	for (auto const encoding : {log::Encoding::Text, log::Encoding::Json, log::Encoding::Logfmt}) {
+		log::set_encoding(encoding);
+		log_fields();  // warm up: grow buffers
+		ASSERT_EQ(0u, allocations_during(log_fields));
+	}
+	log::set_encoding(log::Encoding::Text);
+}
+
+TEST_F(LogAllocations, nested)
+{
+	log::info("{}", Nested {});
+	ASSERT_EQ(0u, allocations_during([] { log::info("{}", Nested {}); }));
+
+	std::rewind(_file);
+	std::string contents;
+	char buffer[256];
+	while (auto const size {std::fread(buffer, 1, sizeof buffer, _file)}) {
+		contents.append(buffer, size);
+	}
+	ASSERT_EQ("Debug: nested 1\nInfo: 0\nDebug: nested 1\nInfo: 0\n", contents);
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <log_args.hxx>
+
+using namespace project::log::detail;
+
+namespace {
+template <std::size_t N, typename... Args>
+auto round_trip(char const (&format)[N], Args const&... args) -> std::string
+{
+	Packed packed;
+	EXPECT_TRUE(pack(packed, format, args...));
+
+	fmt::memory_buffer out;
+	packed.schema->format(out, packed.format, packed.data.data());
+	return fmt::to_string(out);
+}
+}  // namespace
+
+TEST(LogArgs, deferrable)
+{
+	static_assert(deferrable<char const (&)[3], int, double, char const*, std::string, std::string_view>);
+	static_assert(deferrable<char const (&)[3], bool, char, float, unsigned short, void*>);
+	static_assert(!deferrable<std::string, int>);  // format must be a literal
+	static_assert(!deferrable<char const (&)[3], std::vector<int>>);
+	static_assert(!deferrable<char const (&)[3], wchar_t>);
+	static_assert(!deferrable<char (&)[3], int>);  // a buffer being written is no literal
+	static_assert(deferrable<char const (&)[3], char (&)[8]>);  // arguments are copied
+}
+
+TEST(LogArgs, schema)
+{
+	Packed packed;
+	ASSERT_TRUE(pack(packed, "{} {} {}", 1, 2u, "three"));
+
+	ASSERT_EQ(3, packed.schema->count);
+	EXPECT_EQ(ArgType::Int, packed.schema->types[0]);
+	EXPECT_EQ(ArgType::UInt, packed.schema->types[1]);
+	EXPECT_EQ(ArgType::String, packed.schema->types[2]);
+	EXPECT_EQ(sizeof(std::int64_t) + sizeof(std::uint64_t) + sizeof(std::uint32_t) + 5, packed.size);
+}
+
+TEST(LogArgs, same_types_share_schema)
+{
+	Packed first;
+	Packed second;
+	ASSERT_TRUE(pack(first, "{}", 1));
+	ASSERT_TRUE(pack(second, "{:x}", short {2}));
+	EXPECT_EQ(first.schema, second.schema);
+}
+
+TEST(LogArgs, round_trip)
+{
+	EXPECT_EQ("message", round_trip("message"));
+	EXPECT_EQ("1 -2 3", round_trip("{} {} {}", 1, std::int64_t {-2}, 3ull));
+	EXPECT_EQ("true x 0.5 2.25", round_trip("{} {} {} {}", true, 'x', 0.5f, 2.25));
+	EXPECT_EQ("ff", round_trip("{:x}", 255));
+	EXPECT_EQ("[a b]", round_trip("[{} {}]", "a", std::string {"b"}));
+}
+
+TEST(LogArgs, copies_strings)
+{
+	std::string text {"before"};
+
+	Packed packed;
+	ASSERT_TRUE(pack(packed, "{}", text));
+	text = "after";
+
+	fmt::memory_buffer out;
+	packed.schema->format(out, packed.format, packed.data.data());
+	EXPECT_EQ("before", fmt::to_string(out));
+}
+
+TEST(LogArgs, capacity)
+{
+	Packed packed;
+	EXPECT_FALSE(pack(packed, "{}", std::string(ArgCapacity, 'x')));
+	EXPECT_TRUE(pack(packed, "{}", std::string(ArgCapacity - sizeof(std::uint32_t), 'x')));
+}
+
+TEST(LogArgs, null_string)
+{
+	Packed packed;
+	EXPECT_FALSE(pack(packed, "{}", static_cast<char const*>(nullptr)));
+}
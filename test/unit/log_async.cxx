@@ -0,0 +1,238 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL  // test every level regardless of the configured floor
+#include <log_async.hxx>
+#undef ENABLE_LOGGING
+
+using namespace project;
+
+class LogAsync : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		_file = std::tmpfile();
+		ASSERT_NE(nullptr, _file);
+		log::set_target(_file);
+		log::set_level(log::Level::Trace);
+	}
+
+	void TearDown() override
+	{
+		log::stop_backend();
+		log::set_target(stderr);
+		log::set_level(log::Level::None);
+		std::fclose(_file);
+	}
+
+	auto contents() -> std::string
+	{
+		std::string result;
+		std::rewind(_file);
+		char buffer[4096];
+		while (auto const size {std::fread(buffer, 1, sizeof buffer, _file)}) {
+			result.append(buffer, size);
+		}
+		return result;
+	}
+
+	static auto count(std::string const& haystack, std::string const& needle) -> std::size_t
+	{
+		std::size_t result {0};
+		for (auto at {haystack.find(needle)}; at != std::string::npos; at = haystack.find(needle, at + 1)) {
+			++result;
+		}
+		return result;
+	}
+
+	std::FILE* _file {nullptr};
+};
+
+TEST_F(LogAsync, start_stop)
+{
+	ASSERT_FALSE(log::backend_running());
+	log::start_backend();
+	ASSERT_TRUE(log::backend_running());
+	log::stop_backend();
+	ASSERT_FALSE(log::backend_running());
+}
+
+TEST_F(LogAsync, flush)
+{
+	log::start_backend();
+	log::info("{} {}", "message", 1);
+	log::flush();
+	ASSERT_EQ("Info: message 1\n", contents());
+}
+
+TEST_F(LogAsync, stop_drains)
+{
+	log::start_backend();
+	for (int i {0}; i < 1000; ++i) {
+		log::debug("{}", i);
+	}
+	log::stop_backend();
+
+	auto const result {contents()};
+	EXPECT_EQ(1000, count(result, "Debug: "));
+	EXPECT_NE(std::string::npos, result.find("Debug: 999\n"));
+}
+
+TEST_F(LogAsync, level_filter)
+{
+	log::set_level(log::Level::Warning);
+	log::start_backend();
+	log::info("hidden");
+	log::warning("shown");
+	log::flush();
+	ASSERT_EQ("Warning: shown\n", contents());
+}
+
+TEST_F(LogAsync, block_loses_nothing)
+{
+	int constexpr threads {4};
+	int constexpr per_thread {5000};
+
+	log::start_backend({16, log::Overflow::Block});
+
+	std::vector<std::thread> producers;
+	for (int t {0}; t < threads; ++t) {
+		producers.emplace_back([] {
+			for (int i {0}; i < per_thread; ++i) {
+				log::info("{}", i);
+			}
+		});
+	}
+	for (auto& producer : producers) {
+		producer.join();
+	}
+	log::flush();
+
+	EXPECT_EQ(threads * per_thread, count(contents(), "Info: "));
+}
+
+TEST_F(LogAsync, drop_newest)
+{
+	int constexpr total {20000};
+	auto const dropped_before {log::dropped_count()};
+
+	log::start_backend({2, log::Overflow::DropNewest});
+	for (int i {0}; i < total; ++i) {
+		log::info("{}", i);
+	}
+	log::stop_backend();
+
+	auto const dropped {log::dropped_count() - dropped_before};
+	auto const result {contents()};
+	EXPECT_EQ(total, count(result, "Info: ") + dropped);
+	EXPECT_EQ(std::string::npos, result.find("Dropped"));
+}
+
+TEST_F(LogAsync, drop_and_count)
+{
+	int constexpr total {20000};
+	auto const dropped_before {log::dropped_count()};
+
+	log::start_backend({2, log::Overflow::DropAndCount});
+	for (int i {0}; i < total; ++i) {
+		log::info("{}", i);
+	}
+	log::stop_backend();
+
+	auto const dropped {log::dropped_count() - dropped_before};
+	auto const result {contents()};
+	EXPECT_EQ(total, count(result, "Info: ") + dropped);
+	EXPECT_EQ(dropped > 0, result.find("Warning: Dropped ") != std::string::npos);
+}
+
+TEST_F(LogAsync, deferred)
+{
+	log::AsyncOptions options;
+	options.defer_formatting = true;
+	log::start_backend(options);
+
+	std::string text {"before"};
+	log::info("{} {} {}", 1, 2.5, text);
+	text = "after";
+	log::flush();
+
+	ASSERT_EQ("Info: 1 2.5 before\n", contents());
+}
+
+TEST_F(LogAsync, deferred_falls_back)
+{
+	log::AsyncOptions options;
+	options.defer_formatting = true;
+	log::start_backend(options);
+
+	std::string const long_text(log::detail::ArgCapacity * 2, 'x');
+	std::string const format {"{}"};
+	log::info("{}", long_text);  // too large to capture
+	log::info(format, 1);  // format is not a literal
+	log::flush();
+
+	ASSERT_EQ("Info: " + long_text + "\nInfo: 1\n", contents());
+}
+
+TEST_F(LogAsync, deferred_arrays)
+{
+	log::AsyncOptions options;
+	options.defer_formatting = true;
+	log::start_backend(options);
+
+	static char const padded[16] {"{} {}"};  // larger than its text
+	char buffer[16] {"before"};
+	log::info(padded, 1, buffer);  // arrays among the arguments are copied
+	std::snprintf(buffer, sizeof buffer, "after");
+	log::flush();
+
+	ASSERT_EQ("Info: 1 before\n", contents());
+}
+
+TEST_F(LogAsync, synchronous_after_stop)
+{
+	log::start_backend();
+	log::stop_backend();
+	log::error("direct");
+	std::fflush(_file);
+	ASSERT_EQ("Error: direct\n", contents());
+}
+
+TEST_F(LogAsync, restart_loses_nothing)
+{
+	int constexpr threads {4};
+	int constexpr per_thread {5000};
+	std::atomic<int> running {threads};
+
+	log::start_backend({16, log::Overflow::Block});
+
+	std::vector<std::thread> producers;
+	for (int t {0}; t < threads; ++t) {
+		producers.emplace_back([&running] {
+			for (int i {0}; i < per_thread; ++i) {
+				log::info("{}", i);
+			}
+			running.fetch_sub(1);
+		});
+	}
+
+	// Messages sent around a stop go to the backend before it drains, or straight to the target after.
+	while (running.load() > 0) {
+		log::stop_backend();
+		log::start_backend({16, log::Overflow::Block});
+	}
+	for (auto& producer : producers) {
+		producer.join();
+	}
+	log::stop_backend();
+	std::fflush(_file);
+
+	EXPECT_EQ(threads * per_thread, count(contents(), "Info: "));
+}
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL  // test every level regardless of the configured floor
+#include <log_async.hxx>
+#include <log_binary.hxx>
+#include <log_sink.hxx>
+#undef ENABLE_LOGGING
+
+using namespace project;
+
+namespace {
+struct Opaque  // has a formatter, but cannot be captured
+{
+	int value;
+};
+}  // namespace
+
+template <>
+struct fmt::formatter<Opaque> : fmt::formatter<int>
+{
+	auto format(Opaque const& opaque, fmt::format_context& context) const
+	{
+		return fmt::formatter<int>::format(opaque.value, context);
+	}
+};
+
+class LogBinary : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		_binary = std::tmpfile();
+		_text = std::tmpfile();
+		ASSERT_NE(nullptr, _binary);
+		ASSERT_NE(nullptr, _text);
+		log::set_sink(std::make_shared<log::BinarySink>(_binary));
+		log::set_level(log::Level::Trace);
+	}
+
+	void TearDown() override
+	{
+		log::stop_backend();
+		log::set_sink(nullptr);
+		log::set_level(log::Level::None);
+		std::fclose(_binary);
+		std::fclose(_text);
+	}
+
+	static auto read(std::FILE* file) -> std::string
+	{
+		std::string result;
+		std::rewind(file);
+		char buffer[4096];
+		while (auto const size {std::fread(buffer, 1, sizeof buffer, file)}) {
+			result.append(buffer, size);
+		}
+		return result;
+	}
+
+	auto decode() -> std::string
+	{
+		log::flush();
+		std::rewind(_binary);
+		EXPECT_TRUE(log::decode_binary(_binary, _text));
+		return read(_text);
+	}
+
+	std::FILE* _binary {nullptr};
+	std::FILE* _text {nullptr};
+};
+
+TEST_F(LogBinary, round_trip)
+{
+	std::string const name {"disk"};
+
+	log::info("{} {} {} {:.1f} {}", name, -1, 2u, 0.5, true);
+	log::error("{}{}", 'x', "yz");
+	PROJECT_LOG_WARNING("no arguments");
+	log::debug("{}", Opaque {7});  // stored pre-formatted
+
+	ASSERT_EQ("Info: disk -1 2 0.5 true\nError: xyz\nWarning: no arguments\nDebug: 7\n", decode());
+}
+
+TEST_F(LogBinary, definitions_written_once)
+{
+	for (int i {0}; i < 100; ++i) {
+		PROJECT_LOG_INFO("iteration {} of a fairly long format string", i);
+	}
+	auto const decoded {decode()};
+	auto const binary {read(_binary)};
+
+	ASSERT_EQ(100, std::count(decoded.begin(), decoded.end(), '\n'));
+	ASSERT_EQ(std::string::npos, binary.find("fairly long", binary.find("fairly long") + 1));  // defined once
+	ASSERT_LT(binary.size(), decoded.size());
+	ASSERT_EQ(0u, decoded.find("Info: iteration 0 of a fairly long format string\n"));
+}
+
+TEST_F(LogBinary, async)
+{
+	log::start_backend({64, log::Overflow::Block, true});
+	for (int i {0}; i < 1000; ++i) {
+		log::trace("{}", i);
+	}
+	log::stop_backend();
+
+	auto const text {decode()};
+	ASSERT_EQ(0u, text.find("Trace: 0\n"));
+	ASSERT_NE(std::string::npos, text.find("Trace: 999\n"));
+}
+
+TEST_F(LogBinary, truncated)
+{
+	log::info("first");
+	log::info("second {}", 2);
+	log::flush();
+
+	auto binary {read(_binary)};
+	binary.pop_back();
+
+	std::FILE* damaged {std::tmpfile()};
+	ASSERT_NE(nullptr, damaged);
+	std::fwrite(binary.data(), 1, binary.size(), damaged);
+	std::rewind(damaged);
+
+	ASSERT_FALSE(log::decode_binary(damaged, _text));
+	ASSERT_EQ("Info: first\n", read(_text));
+	std::fclose(damaged);
+}
+
+TEST_F(LogBinary, damaged_size)
+{
+	log::info("first");
+	log::info("{}", Opaque {1});  // a message record: its u32 size is followed by the one byte of text
+	log::flush();
+
+	auto binary {read(_binary)};
+	std::fill_n(binary.end() - 5, 4, '\xff');  // claims 4 GiB of text
+
+	std::FILE* damaged {std::tmpfile()};
+	ASSERT_NE(nullptr, damaged);
+	std::fwrite(binary.data(), 1, binary.size(), damaged);
+	std::rewind(damaged);
+
+	ASSERT_FALSE(log::decode_binary(damaged, _text));  // reports truncation rather than allocating it all
+	ASSERT_EQ("Info: first\n", read(_text));
+	std::fclose(damaged);
+}
+
+TEST_F(LogBinary, not_a_log)
+{
+	std::FILE* text {std::tmpfile()};
+	ASSERT_NE(nullptr, text);
+	std::fputs("Info: message\n", text);
+	std::rewind(text);
+
+	ASSERT_FALSE(log::decode_binary(text, _text));
+	ASSERT_EQ("", read(_text));
+	std::fclose(text);
+}
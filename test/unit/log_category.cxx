@@ -0,0 +1,218 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL  // test every level regardless of the configured floor
+#include <log_category.hxx>
+#undef ENABLE_LOGGING
+
+using namespace project;
+
+class LogCategory : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		log::set_target(stderr);
+		log::set_level(log::Level::Info);
+	}
+
+	void TearDown() override
+	{
+		log::set_level(log::Level::None);
+	}
+};
+
+TEST_F(LogCategory, same_name_same_category)
+{
+	auto& first {log::category("same")};
+	auto& second {log::category(std::string {"same"})};
+	EXPECT_EQ(&first, &second);
+	EXPECT_EQ("same", first.name());
+}
+
+TEST_F(LogCategory, level_cache_line)
+{
+	auto const& category {log::category("aligned")};
+	EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(&category) % project::detail::CacheLine);
+}
+
+TEST_F(LogCategory, follows_global)
+{
+	auto& category {log::category("follows")};
+	EXPECT_EQ(log::Level::Info, category.level());
+
+	log::set_level(log::Level::Debug);
+	EXPECT_EQ(log::Level::Debug, category.level());
+}
+
+TEST_F(LogCategory, override)
+{
+	auto& category {log::category("override")};
+	category.set_level(log::Level::Trace);
+
+	log::set_level(log::Level::Error);
+	EXPECT_EQ(log::Level::Trace, category.level());
+	EXPECT_TRUE(category.enabled(log::Level::Trace));
+	EXPECT_FALSE(log::enabled(log::Level::Trace));
+
+	category.reset_level();
+	EXPECT_EQ(log::Level::Error, category.level());
+}
+
+TEST_F(LogCategory, print)
+{
+	auto& category {log::category("print")};
+	category.set_level(log::Level::Debug);
+
+	::testing::internal::CaptureStderr();
+	log::print(category, log::Level::Debug, "{}", "shown");
+	log::print(category, log::Level::Trace, "{}", "hidden");
+	std::string const result {::testing::internal::GetCapturedStderr()};
+	EXPECT_EQ("Debug: shown\n", result);
+
+	category.reset_level();
+}
+
+TEST_F(LogCategory, macros)
+{
+	int evaluated {0};
+	log::category("net").set_level(log::Level::Trace);
+
+	::testing::internal::CaptureStderr();
+	PROJECT_LOG_CATEGORY_TRACE("net", "{}", ++evaluated);
+	PROJECT_LOG_CATEGORY_TRACE("db", "{}", ++evaluated);  // follows the global level, Info
+	PROJECT_LOG_CATEGORY_INFO("db", "{}", ++evaluated);
+	std::string const result {::testing::internal::GetCapturedStderr()};
+
+	EXPECT_EQ("Trace: 1\nInfo: 2\n", result);
+	EXPECT_EQ(2, evaluated);
+
+	log::category("net").reset_level();
+}
+
+TEST_F(LogCategory, parse_levels)
+{
+	auto const spec {log::parse_levels(" debug , net=trace,db = WARN,,")};
+	ASSERT_EQ(log::Level::Debug, spec.global);
+	ASSERT_EQ(2u, spec.categories.size());
+	EXPECT_EQ("net", spec.categories[0].first);
+	EXPECT_EQ(log::Level::Trace, spec.categories[0].second);
+	EXPECT_EQ("db", spec.categories[1].first);
+	EXPECT_EQ(log::Level::Warning, spec.categories[1].second);
+
+	EXPECT_FALSE(log::parse_levels("net=info").global.has_value());
+	EXPECT_TRUE(log::parse_levels("").categories.empty());
+
+	EXPECT_THROW(log::parse_levels("loud"), std::invalid_argument);
+	EXPECT_THROW(log::parse_levels("net=loud"), std::invalid_argument);
+	EXPECT_THROW(log::parse_levels("=info"), std::invalid_argument);
+	EXPECT_THROW(log::parse_levels("net="), std::invalid_argument);
+}
+
+TEST_F(LogCategory, set_levels)
+{
+	log::set_levels("warning,spec.net=trace");
+	EXPECT_EQ(log::Level::Warning, log::get_level());
+	EXPECT_EQ(log::Level::Trace, log::category("spec.net").level());
+
+	EXPECT_THROW(log::set_levels("error,spec.net=bad"), std::invalid_argument);
+	EXPECT_EQ(log::Level::Warning, log::get_level());  // unchanged
+	EXPECT_EQ(log::Level::Trace, log::category("spec.net").level());
+
+	log::category("spec.net").reset_level();
+}
+
+TEST_F(LogCategory, concurrent_level_changes)
+{
+	log::set_level(log::Level::Warning);
+	auto& category {log::category("concurrent")};
+	std::atomic<bool> done {false};
+	std::vector<std::thread> readers;
+
+	for (int t {0}; t < 4; ++t) {
+		readers.emplace_back([&] {
+			while (!done.load()) {
+				auto const level {category.level()};
+				EXPECT_TRUE(level == log::Level::Warning || level == log::Level::Debug);
+			}
+		});
+	}
+
+	for (int i {0}; i < 10000; ++i) {
+		log::set_level(i % 2 ? log::Level::Warning : log::Level::Debug);
+	}
+	done = true;
+
+	for (auto& reader : readers) {
+		reader.join();
+	}
+}
+
+TEST_F(LogCategory, configure_publishes_snapshot)
+{
+	auto const* const before {log::current_config()};
+	auto const& config {log::configure("debug,config.a=trace,config.b=error")};
+
+	ASSERT_EQ(&config, log::current_config());
+	EXPECT_EQ(before ? before->generation + 1 : 1, config.generation);
+	EXPECT_EQ("debug,config.a=trace,config.b=error", config.spec);
+	EXPECT_EQ(log::Level::Debug, config.global);
+	ASSERT_EQ(2u, config.categories.size());
+	EXPECT_EQ("config.a", config.categories[0].first);
+	EXPECT_EQ(log::Level::Error, config.categories[1].second);
+
+	EXPECT_EQ(log::Level::Debug, log::get_level());
+	EXPECT_EQ(log::Level::Trace, log::category("config.a").level());
+	EXPECT_EQ(log::Level::Error, log::category("config.b").level());
+
+	// The next config replaces the whole of this one, which stays as it was.
+	auto const& next {log::configure("config.b=warning")};
+	EXPECT_EQ(config.generation + 1, next.generation);
+	EXPECT_EQ(log::Level::Debug, next.global);  // kept, as the spec gives none
+	EXPECT_EQ(log::Level::Debug, log::category("config.a").level());
+	EXPECT_EQ(log::Level::Warning, log::category("config.b").level());
+	EXPECT_EQ(2u, config.categories.size());
+
+	EXPECT_THROW(log::configure("info,config.a=bad"), std::invalid_argument);
+	EXPECT_EQ(&next, log::current_config());
+	EXPECT_EQ(log::Level::Debug, log::category("config.a").level());
+
+	log::configure("");  // config.b follows the global level again
+	EXPECT_EQ(log::Level::Debug, log::category("config.b").level());
+}
+
+TEST_F(LogCategory, concurrent_configure)
+{
+	std::atomic<bool> done {false};
+	std::vector<std::thread> readers;
+
+	for (int t {0}; t < 4; ++t) {
+		readers.emplace_back([&] {
+			std::uint64_t seen {0};
+			while (!done.load()) {
+				if (auto const* const config {log::current_config()}) {
+					EXPECT_LE(seen, config->generation);
+					EXPECT_TRUE(config->global == log::Level::Warning || config->global == log::Level::Debug);
+					seen = config->generation;
+				}
+			}
+		});
+	}
+
+	for (int i {0}; i < 1000; ++i) {
+		log::configure(i % 2 ? "warning,concurrent.config=trace" : "debug");
+	}
+	done = true;
+
+	for (auto& reader : readers) {
+		reader.join();
+	}
+	log::configure("");
+}
@@ -0,0 +1,252 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <log_compress.hxx>
+#include <log_sink.hxx>
+
+using namespace project;
+
+namespace {
+auto compress(std::string const& text) -> std::string
+{
+	fmt::memory_buffer out;
+	log::detail::compress(text.data(), text.size(), out);
+	return {out.data(), out.size()};
+}
+
+auto decompress(std::string const& data, std::size_t const size, bool& ok) -> std::string
+{
+	std::string text(size, '\0');
+	ok = log::detail::decompress(data.data(), data.size(), text.data(), text.size());
+	return text;
+}
+
+auto read(std::FILE* file) -> std::string
+{
+	std::string result;
+	std::rewind(file);
+	char buffer[4096];
+	while (auto const size {std::fread(buffer, 1, sizeof buffer, file)}) {
+		result.append(buffer, size);
+	}
+	return result;
+}
+
+void write(log::Sink& sink, std::string const& message)
+{
+	sink.write(log::Event {log::Level::Info, nullptr, 0, 0, message, {}, nullptr});
+}
+}  // namespace
+
+class LogCompress : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		_file = std::tmpfile();
+		ASSERT_NE(nullptr, _file);
+	}
+
+	void TearDown() override
+	{
+		std::fclose(_file);
+	}
+
+	/// Write \p count records through a CompressedSink with small blocks; return their text.
+	auto write_log(int const count, std::size_t const block_size = 1024) -> std::string
+	{
+		std::string text;
+		log::CompressedSink sink {_file, {block_size, std::chrono::hours {1}, 2}};
+		for (int i {0}; i < count; ++i) {
+			auto const message {fmt::format("request {} served in {} us", i, i * 7 % 1000)};
+			write(sink, message);
+			text += "Info: " + message + "\n";
+		}
+		return text;
+	}
+
+	/// Decode \p data, returning the text and whether it decoded cleanly.
+	static auto decode(std::string const& data, bool& ok) -> std::string
+	{
+		std::FILE* in {std::tmpfile()};
+		std::FILE* out {std::tmpfile()};
+		std::fwrite(data.data(), 1, data.size(), in);
+		std::rewind(in);
+
+		ok = log::decode_compressed(in, out);
+		auto text {read(out)};
+
+		std::fclose(in);
+		std::fclose(out);
+		return text;
+	}
+
+	std::FILE* _file {nullptr};
+};
+
+TEST(LogCodec, round_trip)
+{
+	std::mt19937 random {7};
+	std::string noise(100'000, '\0');
+	for (auto& c : noise) {
+		c = static_cast<char>(random());
+	}
+
+	std::vector<std::string> const inputs {
+	    "",
+	    "a",
+	    "abc",
+	    std::string(1000, 'x'),  // one long overlapping match
+	    std::string(70'000, 'y') + "tail",
+	    "Info: connected\nInfo: connected\nInfo: disconnected\n",
+	    noise,
+	    noise + noise.substr(0, 5000),  // a repeat beyond the reach of an offset
+	};
+
+	for (auto const& input : inputs) {
+		bool ok {false};
+		ASSERT_EQ(input, decompress(compress(input), input.size(), ok));
+		ASSERT_TRUE(ok) << input.size();
+	}
+
+	ASSERT_LT(compress(std::string(1000, 'x')).size(), 20u);
+}
+
+TEST(LogCodec, rejects_damage)
+{
+	std::string const text {"the same words, the same words, the same words"};
+	auto const data {compress(text)};
+	bool ok {true};
+
+	decompress(data.substr(0, data.size() - 1), text.size(), ok);
+	ASSERT_FALSE(ok);
+
+	decompress(data, text.size() + 1, ok);  // wrong size
+	ASSERT_FALSE(ok);
+
+	decompress(std::string {"\x00\x05\x00", 3}, 4, ok);  // offset before the start
+	ASSERT_FALSE(ok);
+
+	decompress("", 0, ok);
+	ASSERT_FALSE(ok);
+}
+
+TEST_F(LogCompress, round_trip)
+{
+	auto const text {write_log(1000)};
+	auto const data {read(_file)};
+
+	bool ok {false};
+	ASSERT_EQ(text, decode(data, ok));
+	ASSERT_TRUE(ok);
+	ASSERT_LT(data.size() * 3, text.size());
+}
+
+TEST_F(LogCompress, stores_what_does_not_shrink)
+{
+	{
+		log::CompressedSink sink {_file};
+		write(sink, "x");
+	}
+
+	bool ok {false};
+	ASSERT_EQ("Info: x\n", decode(read(_file), ok));
+	ASSERT_TRUE(ok);
+	ASSERT_EQ(4u + 12u + 8u, read(_file).size());  // header, frame, text
+}
+
+TEST_F(LogCompress, flush_writes_partial_block)
+{
+	log::CompressedSink sink {_file};
+	write(sink, "first");
+	sink.flush();
+
+	bool ok {false};
+	ASSERT_EQ("Info: first\n", decode(read(_file), ok));
+	ASSERT_TRUE(ok);
+}
+
+TEST_F(LogCompress, reads_truncated_up_to_last_block)
+{
+	auto const text {write_log(1000)};
+	auto const data {read(_file)};
+
+	std::size_t previous {0};
+	for (std::size_t size {0}; size < data.size(); size += 97) {
+		bool ok {true};
+		auto const decoded {decode(data.substr(0, size), ok)};
+
+		ASSERT_FALSE(ok);
+		ASSERT_EQ(text.substr(0, decoded.size()), decoded);
+		ASSERT_TRUE(decoded.empty() || decoded.back() == '\n');  // whole blocks, so whole lines
+		ASSERT_GE(decoded.size(), previous);
+		previous = decoded.size();
+	}
+	ASSERT_GT(previous, text.size() / 2);
+}
+
+TEST_F(LogCompress, detects_damage)
+{
+	auto const text {write_log(1000)};
+	auto data {read(_file)};
+
+	data[data.size() / 2] ^= 0x10;
+
+	bool ok {true};
+	auto const decoded {decode(data, ok)};
+	ASSERT_FALSE(ok);
+	ASSERT_EQ(text.substr(0, decoded.size()), decoded);
+	ASSERT_LT(decoded.size(), text.size());
+}
+
+TEST_F(LogCompress, rejects_other_files)
+{
+	bool ok {true};
+	ASSERT_EQ("", decode("PLOG....", ok));
+	ASSERT_FALSE(ok);
+
+	ASSERT_EQ("", decode("", ok));
+	ASSERT_FALSE(ok);
+}
+
+TEST_F(LogCompress, reader_streams)
+{
+	auto const text {write_log(500)};
+	auto const data {read(_file)};
+
+	log::CompressedReader reader;
+	fmt::memory_buffer out;
+	std::vector<std::size_t> sizes;
+
+	for (std::size_t at {0}; at < data.size(); at += 7) {
+		auto const piece {data.substr(at, 7)};
+		ASSERT_TRUE(reader.feed(piece.data(), piece.size(), out));
+		sizes.push_back(out.size());
+	}
+
+	ASSERT_TRUE(reader.started());
+	ASSERT_EQ(0u, reader.pending());
+	ASSERT_EQ(text, std::string(out.data(), out.size()));
+	ASSERT_LT(sizes.front(), sizes.back());  // text appeared as blocks completed
+}
+
+TEST_F(LogCompress, writers_wait_for_compressor)
+{
+	std::string text;
+	{
+		log::CompressedSink sink {_file, {64, std::chrono::hours {1}, 1}};  // a block per record or two
+		for (int i {0}; i < 2000; ++i) {
+			auto const message {fmt::format("record {}", i)};
+			write(sink, message);
+			text += "Info: " + message + "\n";
+		}
+	}
+
+	bool ok {false};
+	ASSERT_EQ(text, decode(read(_file), ok));
+	ASSERT_TRUE(ok);
+}
@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL  // test every level regardless of the configured floor
+#include <log_async.hxx>
+#include <log_compress.hxx>
+#include <log_crash.hxx>
+#include <log_fd.hxx>
+#undef ENABLE_LOGGING
+
+using namespace project;
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+
+class LogCrash : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		auto const* test {::testing::UnitTest::GetInstance()->current_test_info()};
+		_path = (fs::temp_directory_path() / fmt::format("log_crash-{}-{}.log", test->name(), ::getpid())).string();
+		fs::remove(_path);
+	}
+
+	void TearDown() override
+	{
+		fs::remove(_path);
+	}
+
+	/// Run \p crash in a child process; return its wait status.
+	template <typename Function>
+	static auto in_child(Function&& crash) -> int
+	{
+		auto const pid {::fork()};
+
+		if (pid == 0) {
+			::rlimit const no_core {0, 0};
+			::setrlimit(RLIMIT_CORE, &no_core);
+			crash();
+			::_exit(0);  // should not get here
+		}
+
+		int status {0};
+		::waitpid(pid, &status, 0);
+		return status;
+	}
+
+	/// Log \p count records to the log target, a fully-buffered file, in the child.
+	auto log_to_file(int const count) const -> void
+	{
+		log::set_target(std::fopen(_path.c_str(), "w"));
+		log::set_level(log::Level::Trace);
+		log::install_crash_handlers();
+
+		for (int i {0}; i < count; ++i) {
+			log::info("record {}", i);
+		}
+	}
+
+	auto contents() const -> std::string
+	{
+		std::ifstream file {_path, std::ios::binary};
+		std::ostringstream text;
+		text << file.rdbuf();
+		return text.str();
+	}
+
+	std::string _path;
+};
+
+TEST_F(LogCrash, abort_writes_target)
+{
+	auto const status {in_child([&] {
+		log_to_file(3);
+		std::abort();
+	})};
+
+	ASSERT_TRUE(WIFSIGNALED(status));
+	ASSERT_EQ(SIGABRT, WTERMSIG(status));
+	ASSERT_EQ("Info: record 0\nInfo: record 1\nInfo: record 2\nError: fatal signal SIGABRT\n", contents());
+}
+
+TEST_F(LogCrash, signal_drains_backend)
+{
+	auto const status {in_child([&] {
+		log::start_backend();
+		log_to_file(1000);
+		std::raise(SIGSEGV);
+	})};
+
+	ASSERT_TRUE(WIFSIGNALED(status));
+	ASSERT_EQ(SIGSEGV, WTERMSIG(status));
+
+	auto const text {contents()};
+	EXPECT_NE(std::string::npos, text.find("Info: record 0\n"));
+	EXPECT_NE(std::string::npos, text.find("Info: record 999\n"));
+	EXPECT_NE(std::string::npos, text.find("Error: fatal signal SIGSEGV\n"));
+}
+
+TEST_F(LogCrash, terminate_drains_sinks)
+{
+	auto const status {in_child([&] {
+		int const fd {::open(_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)};
+		log::set_sink(std::make_shared<log::FdSink>(fd, true, log::FdSinkOptions {64, 1 << 20, 1h}));
+		log::set_level(log::Level::Trace);
+		log::install_crash_handlers();
+
+		log::warning("pending {}", 1);
+		log::warning("pending {}", 2);
+		std::terminate();
+	})};
+
+	ASSERT_TRUE(WIFSIGNALED(status));
+	ASSERT_EQ(SIGABRT, WTERMSIG(status));
+	ASSERT_EQ("Warning: pending 1\nWarning: pending 2\n", contents());
+}
+
+TEST_F(LogCrash, abort_writes_file_sink)
+{
+	auto const status {in_child([&] {
+		log::set_sink(std::make_shared<log::FileSink>(std::fopen(_path.c_str(), "w")));
+		log::set_level(log::Level::Trace);
+		log::install_crash_handlers();
+
+		log::info("record {}", 0);
+		log::info("record {}", 1);
+		std::abort();
+	})};
+
+	ASSERT_TRUE(WIFSIGNALED(status));
+	ASSERT_EQ(SIGABRT, WTERMSIG(status));
+	ASSERT_EQ("Info: record 0\nInfo: record 1\n", contents());
+}
+
+TEST_F(LogCrash, signal_drains_compressed_sink)
+{
+	auto const status {in_child([&] {
+		auto* const out {std::fopen(_path.c_str(), "wb")};
+		log::set_sink(std::make_shared<log::CompressedSink>(out, log::CompressedSinkOptions {1 << 20, 1h}));
+		log::set_level(log::Level::Trace);
+		log::install_crash_handlers();
+
+		log::info("record {}", 0);
+		log::info("record {}", 1);
+		std::raise(SIGSEGV);
+	})};
+
+	ASSERT_TRUE(WIFSIGNALED(status));
+	ASSERT_EQ(SIGSEGV, WTERMSIG(status));
+
+	auto* const in {std::fopen(_path.c_str(), "rb")};
+	auto* const text {std::tmpfile()};
+	ASSERT_TRUE(log::decode_compressed(in, text));
+	std::fclose(in);
+
+	std::rewind(text);
+	char buffer[256] {};
+	auto const size {std::fread(buffer, 1, sizeof buffer, text)};
+	std::fclose(text);
+	ASSERT_EQ("Info: record 0\nInfo: record 1\n", std::string(buffer, size));
+}
+
+TEST_F(LogCrash, uninstall_restores_stdio)
+{
+	log::install_crash_handlers();
+	log::install_crash_handlers();  // no effect
+	log::uninstall_crash_handlers();
+
+	auto const status {in_child([&] { std::raise(SIGSEGV); })};
+
+	ASSERT_TRUE(WIFSIGNALED(status));
+	ASSERT_EQ(SIGSEGV, WTERMSIG(status));
+	ASSERT_FALSE(fs::exists(_path));
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL  // test every level regardless of the configured floor
+#include <log_fd.hxx>
+#undef ENABLE_LOGGING
+
+using namespace project;
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+
+class LogFd : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		ASSERT_EQ(0, ::pipe(_pipe));
+		::fcntl(_pipe[0], F_SETFL, O_NONBLOCK);
+		log::set_level(log::Level::Trace);
+	}
+
+	void TearDown() override
+	{
+		log::set_sink(nullptr);
+		log::set_level(log::Level::None);
+		::close(_pipe[0]);
+		::close(_pipe[1]);
+	}
+
+	/// Everything written to the pipe so far.
+	auto drain() -> std::string
+	{
+		std::string result;
+		char buffer[256];
+		::ssize_t size;
+		while ((size = ::read(_pipe[0], buffer, sizeof buffer)) > 0) {
+			result.append(buffer, static_cast<std::size_t>(size));
+		}
+		return result;
+	}
+
+	int _pipe[2] {-1, -1};
+};
+
+TEST_F(LogFd, writes_full_batch)
+{
+	log::set_sink(std::make_shared<log::FdSink>(_pipe[1], false, log::FdSinkOptions {3, 1 << 20, 1h}));
+
+	log::info("1");
+	log::info("2");
+	ASSERT_EQ("", drain());
+
+	log::info("3");
+	ASSERT_EQ("Info: 1\nInfo: 2\nInfo: 3\n", drain());
+}
+
+TEST_F(LogFd, writes_by_size)
+{
+	log::set_sink(std::make_shared<log::FdSink>(_pipe[1], false, log::FdSinkOptions {64, 16, 1h}));
+
+	log::info("12345");
+	ASSERT_EQ("", drain());
+
+	log::info("67890");
+	ASSERT_EQ("Info: 12345\nInfo: 67890\n", drain());
+}
+
+TEST_F(LogFd, writes_by_age)
+{
+	log::set_sink(std::make_shared<log::FdSink>(_pipe[1], false, log::FdSinkOptions {64, 1 << 20, 0ns}));
+
+	log::info("now");
+	ASSERT_EQ("Info: now\n", drain());
+}
+
+TEST_F(LogFd, flush_writes_pending)
+{
+	auto const sink {std::make_shared<log::FdSink>(_pipe[1], false, log::FdSinkOptions {64, 1 << 20, 1h})};
+	log::set_sink(sink);
+
+	log::warning("pending");
+	ASSERT_EQ("", drain());
+
+	sink->flush();
+	ASSERT_EQ("Warning: pending\n", drain());
+}
+
+TEST_F(LogFd, connects_to_unix_socket)
+{
+	auto const path {(fs::temp_directory_path() / fmt::format("log_fd-{}.sock", ::getpid())).string()};
+	fs::remove(path);
+
+	int const listener {::socket(AF_UNIX, SOCK_STREAM, 0)};
+	ASSERT_LE(0, listener);
+
+	::sockaddr_un address {};
+	address.sun_family = AF_UNIX;
+	path.copy(address.sun_path, sizeof address.sun_path - 1);
+	ASSERT_EQ(0, ::bind(listener, reinterpret_cast<::sockaddr const*>(&address), sizeof address));
+	ASSERT_EQ(0, ::listen(listener, 1));
+
+	auto const sink {log::FdSink::connect(path)};
+	int const peer {::accept(listener, nullptr, nullptr)};
+	ASSERT_LE(0, peer);
+
+	log::add_sink(sink, log::Level::Error);
+	log::error("collected");
+	log::info("skipped");
+	sink->flush();
+
+	char buffer[64] {};
+	ASSERT_LT(0, ::recv(peer, buffer, sizeof buffer - 1, 0));
+	ASSERT_STREQ("Error: collected\n", buffer);
+
+	log::set_sink(nullptr);
+	::close(peer);
+	::close(listener);
+	fs::remove(path);
+}
+
+TEST_F(LogFd, connect_throws_without_listener)
+{
+	auto const path {(fs::temp_directory_path() / fmt::format("log_fd-missing-{}.sock", ::getpid())).string()};
+	ASSERT_THROW(log::FdSink::connect(path), std::system_error);
+}
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL  // test every level regardless of the configured floor
+#include <collect.hxx>
+#include <log_fields.hxx>
+#include <log_pattern.hxx>
+#include <log_sink.hxx>
+#undef ENABLE_LOGGING
+
+using namespace project;
+using test::Collect;
+using log::kv;
+
+namespace {
+
+auto escaped(std::string_view const text) -> std::string
+{
+	fmt::memory_buffer buffer;
+	log::detail::escape_json(buffer, text);
+	return {buffer.data(), buffer.size()};
+}
+
+auto logfmt(std::string_view const text) -> std::string
+{
+	fmt::memory_buffer buffer;
+	log::detail::quote_logfmt(buffer, text);
+	return {buffer.data(), buffer.size()};
+}
+
+}  // namespace
+
+class LogFields : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		log::set_sink(_sink);
+		log::set_level(log::Level::Trace);
+	}
+
+	void TearDown() override
+	{
+		log::set_encoding(log::Encoding::Text);
+		log::set_sink(nullptr);
+		log::set_level(log::Level::None);
+	}
+
+	std::shared_ptr<Collect> _sink {std::make_shared<Collect>()};
+};
+
+TEST(LogFieldsEscape, json)
+{
+	ASSERT_EQ("", escaped(""));
+	ASSERT_EQ("plain text longer than one block", escaped("plain text longer than one block"));
+	ASSERT_EQ(R"(a\"b\\c\n\t\u0001)", escaped("a\"b\\c\n\t\x01"));
+	ASSERT_EQ(R"(0123456\"89abcdef\n)", escaped("0123456\"89abcdef\n"));
+	ASSERT_EQ("caf\xc3\xa9", escaped("caf\xc3\xa9"));  // UTF-8 passes through
+}
+
+TEST(LogFieldsEscape, logfmt)
+{
+	ASSERT_EQ("bare", logfmt("bare"));
+	ASSERT_EQ(R"("")", logfmt(""));
+	ASSERT_EQ(R"("two words")", logfmt("two words"));
+	ASSERT_EQ(R"("a=b")", logfmt("a=b"));
+	ASSERT_EQ(R"("say \"hi\"")", logfmt("say \"hi\""));
+}
+
+TEST_F(LogFields, text_appends_fields)
+{
+	std::string const path {"/index.html"};
+	log::info("request {}", "done", kv("latency_us", 12), kv("path", path), kv("ok", true), kv("note", "a b"));
+
+	ASSERT_EQ((std::vector<std::string> {"Info: request done latency_us=12 path=/index.html ok=true note=\"a b\"\n"}),
+	          _sink->lines);
+}
+
+TEST_F(LogFields, text_with_pattern)
+{
+	log::set_pattern("[{level}] {message} <");
+	log::warning("low", kv("free", 3));
+	log::set_pattern("{level}: {message}");
+
+	ASSERT_EQ((std::vector<std::string> {"[Warning] low free=3 <\n"}), _sink->lines);
+}
+
+TEST_F(LogFields, json)
+{
+	log::set_encoding(log::Encoding::Json);
+	log::info("request \"{}\"", "done", kv("latency_us", 12), kv("ratio", 0.5), kv("path", "/a\\b"),
+	          kv("nan", std::numeric_limits<double>::quiet_NaN()));
+
+	ASSERT_EQ(1u, _sink->lines.size());
+	auto const& line {_sink->lines[0]};
+	ASSERT_EQ(0u, line.find(R"({"time":")"));
+	ASSERT_NE(std::string::npos, line.find(R"(","level":"Info","thread":)"));
+	ASSERT_NE(std::string::npos,
+	          line.find(R"(,"message":"request \"done\"","latency_us":12,"ratio":0.5,"path":"/a\\b","nan":null})"
+	                    "\n"));
+}
+
+TEST_F(LogFields, json_without_fields)
+{
+	log::set_encoding(log::Encoding::Json);
+	log::error("{} {}", 1, "two");
+
+	ASSERT_EQ(1u, _sink->lines.size());
+	auto const& line {_sink->lines[0]};
+	ASSERT_EQ(R"("message":"1 two"})"
+	          "\n",
+	          line.substr(line.find("\"message\"")));
+}
+
+TEST_F(LogFields, logfmt_with_site)
+{
+	log::set_encoding(log::Encoding::Logfmt);
+	PROJECT_LOG_DEBUG("cache miss", kv("key", "user:1"));
+
+	ASSERT_EQ(1u, _sink->lines.size());
+	auto const& line {_sink->lines[0]};
+	ASSERT_EQ(0u, line.find("time=\""));
+	ASSERT_NE(std::string::npos, line.find("\" level=debug thread="));
+	ASSERT_NE(std::string::npos, line.find(" msg=\"cache miss\" file="));
+	ASSERT_NE(std::string::npos, line.find(" function=TestBody key=user:1\n"));
+}
+
+TEST_F(LogFields, target_gets_encoded_lines)
+{
+	std::FILE* file {std::tmpfile()};
+	ASSERT_NE(nullptr, file);
+	log::set_sink(nullptr);
+	log::set_target(file);
+
+	log::info("to target", kv("n", 1));
+	log::set_encoding(log::Encoding::Logfmt);
+	log::info("to target", kv("n", 2));
+
+	char buffer[256] {};
+	std::rewind(file);
+	std::fread(buffer, 1, sizeof buffer - 1, file);
+	std::string const text {buffer};
+
+	ASSERT_EQ(0u, text.find("Info: to target n=1\ntime=\""));
+	ASSERT_NE(std::string::npos, text.find(" msg=\"to target\" n=2\n"));
+
+	log::set_target(stderr);
+	std::fclose(file);
+}
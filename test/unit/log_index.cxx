@@ -0,0 +1,253 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>  // for std::count, std::min
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <log_index.hxx>
+#include <log_pattern.hxx>
+#include <log_sink.hxx>
+
+using namespace project;
+
+namespace {
+std::uint64_t constexpr Second {1'000'000'000};
+std::uint64_t constexpr Start {1'700'000'000 * Second};
+
+log::Level constexpr Levels[] {log::Level::Info, log::Level::Debug, log::Level::Warning, log::Level::Info,
+                               log::Level::Error, log::Level::Trace};
+
+auto read(std::FILE* file) -> std::string
+{
+	std::string result;
+	std::rewind(file);
+	char buffer[4096];
+	while (auto const size {std::fread(buffer, 1, sizeof buffer, file)}) {
+		result.append(buffer, size);
+	}
+	return result;
+}
+}  // namespace
+
+class LogIndex : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		_pattern = log::get_pattern();
+		log::set_pattern("{time} {level}: {message}");
+
+		_log = std::tmpfile();
+		_index = std::tmpfile();
+		ASSERT_NE(nullptr, _log);
+		ASSERT_NE(nullptr, _index);
+	}
+
+	void TearDown() override
+	{
+		log::set_pattern(_pattern);
+		std::fclose(_log);
+		std::fclose(_index);
+	}
+
+	/// Write \p count records, one a second, through an indexed FileSink.
+	void write_log(int const count, std::size_t const every = 100)
+	{
+		log::FileSink sink {_log, _index, every};
+		for (int i {0}; i < count; ++i) {
+			auto const message {fmt::format("request {} from host-{}", i, i % 7)};
+			auto const level {Levels[static_cast<std::size_t>(i) % std::size(Levels)]};
+			sink.write(log::Event {level, nullptr, Start + static_cast<std::uint64_t>(i) * Second, 1, message, {},
+			                       nullptr});
+		}
+		sink.flush();
+	}
+
+	/// Run \p query over the log, returning the lines written.
+	auto search(log::Query const& query, bool const indexed = true) -> std::string
+	{
+		_text = read(_log);
+		_entries = read(_index);
+
+		std::size_t count {0};
+		auto const* entries {indexed ? log::index_entries(_entries, count) : nullptr};
+		EXPECT_TRUE(!indexed || entries);
+
+		std::FILE* out {std::tmpfile()};
+		_stats = log::search(_text, entries, count, query, out);
+		auto result {read(out)};
+		std::fclose(out);
+		return result;
+	}
+
+	static auto lines(std::string const& text) -> std::size_t
+	{
+		return static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n'));
+	}
+
+	std::string _pattern;
+	std::FILE* _log {nullptr};
+	std::FILE* _index {nullptr};
+	std::string _text;
+	std::string _entries;  // kept for alignment: entries point into it
+	log::QueryStats _stats {};
+};
+
+TEST(LogFind, matches_string_view)
+{
+	std::mt19937 random {11};
+	std::string text(5000, '\0');
+	for (auto& c : text) {
+		c = static_cast<char>('a' + random() % 4);  // many partial matches
+	}
+
+	for (std::size_t size {1}; size <= 40; ++size) {
+		for (int trial {0}; trial < 20; ++trial) {
+			auto const at {random() % (text.size() - size)};
+			auto const needle {std::string_view {text}.substr(at, size)};
+			for (auto const length : {text.size(), at + size, at + size + 3, std::size_t {100}}) {
+				auto const haystack {std::string_view {text}.substr(0, std::min(length, text.size()))};
+				ASSERT_EQ(haystack.find(needle), log::detail::find(haystack, needle)) << size << " " << length;
+			}
+		}
+	}
+
+	ASSERT_EQ(std::string_view::npos, log::detail::find("abc", "abcd"));
+	ASSERT_EQ(0u, log::detail::find("abc", ""));
+	ASSERT_EQ(std::string_view::npos, log::detail::find(std::string(100, 'x'), "xy"));
+}
+
+TEST_F(LogIndex, writes_entry_per_block)
+{
+	write_log(250);  // the sink is destroyed, indexing the open block
+
+	auto const data {read(_index)};
+	std::size_t count {0};
+	auto const* entries {log::index_entries(data, count)};
+	ASSERT_NE(nullptr, entries);
+	ASSERT_EQ(3u, count);
+
+	auto const text {read(_log)};
+	ASSERT_EQ(0u, entries[0].begin);
+	ASSERT_EQ(entries[0].end, entries[1].begin);
+	ASSERT_EQ(text.size(), entries[2].end);
+	ASSERT_EQ(100u, entries[0].records);
+	ASSERT_EQ(50u, entries[2].records);
+
+	ASSERT_EQ(Start, entries[0].first);
+	ASSERT_EQ(Start + 99 * Second, entries[0].last);
+	ASSERT_EQ(Start + 100 * Second, entries[1].first);
+
+	ASSERT_EQ(0b111110, entries[0].levels);
+	ASSERT_EQ('\n', text[entries[0].end - 1]);
+}
+
+TEST_F(LogIndex, rejects_other_files)
+{
+	std::size_t count {0};
+	ASSERT_EQ(nullptr, log::index_entries("", count));
+	ASSERT_EQ(nullptr, log::index_entries("PLOG\x01\x00\x02\x01", count));
+}
+
+TEST_F(LogIndex, finds_text)
+{
+	write_log(1000);
+
+	log::Query query;
+	query.text = "from host-3";
+	auto const found {search(query)};
+
+	ASSERT_EQ(143u, lines(found));  // i % 7 == 3
+	ASSERT_EQ(143u, _stats.lines);
+	ASSERT_NE(std::string::npos, found.find("request 3 from host-3\n"));
+	ASSERT_EQ(std::string::npos, found.find("host-4"));
+}
+
+TEST_F(LogIndex, filters_level)
+{
+	write_log(600);
+
+	log::Query query;
+	query.level = log::Level::Warning;
+	auto const found {search(query)};
+
+	ASSERT_EQ(200u, lines(found));  // Warning and Error, one each in six
+	ASSERT_EQ(std::string::npos, found.find(" Info: "));
+	ASSERT_NE(std::string::npos, found.find(" Error: request 4 "));
+}
+
+TEST_F(LogIndex, skips_blocks_by_level)
+{
+	{
+		log::FileSink sink {_log, _index, 10};
+		for (int i {0}; i < 100; ++i) {
+			auto const level {i < 90 ? log::Level::Debug : log::Level::Error};
+			sink.write(log::Event {level, nullptr, Start, 1, "message", {}, nullptr});
+		}
+	}
+
+	log::Query query;
+	query.level = log::Level::Error;
+	ASSERT_EQ(10u, lines(search(query)));
+	ASSERT_EQ(_text.size() / 10, _stats.scanned);
+}
+
+TEST_F(LogIndex, filters_time_with_index)
+{
+	write_log(1000);
+
+	log::Query query;
+	query.since = Start + 420 * Second;
+	query.until = Start + 479 * Second;
+	auto const found {search(query)};
+
+	ASSERT_EQ(60u, lines(found));
+	ASSERT_NE(std::string::npos, found.find("request 420 "));
+	ASSERT_NE(std::string::npos, found.find("request 479 "));
+	ASSERT_LT(_stats.scanned, _text.size() / 5);  // the one block of 100 records holding them
+
+	ASSERT_EQ(found, search(query, false));
+	ASSERT_EQ(_text.size(), _stats.scanned);
+}
+
+TEST_F(LogIndex, threads_keep_order)
+{
+	write_log(60'000, 1000);  // several chunks
+
+	log::Query query;
+	query.text = "host-5";
+	query.threads = 1;
+	auto const one {search(query)};
+
+	query.threads = 4;
+	ASSERT_EQ(one, search(query));
+	ASSERT_GT(_text.size(), std::size_t {2} << 20);
+
+	query.text = {};
+	ASSERT_EQ(_text, search(query));
+}
+
+TEST_F(LogIndex, searches_beyond_index)
+{
+	write_log(150);
+
+	auto const data {read(_index)};
+	std::size_t count {0};
+	auto const* entries {log::index_entries(data, count)};
+	ASSERT_EQ(2u, count);
+
+	auto const text {read(_log)};
+	std::FILE* out {std::tmpfile()};
+
+	// The records after the last entry are searched too.
+	ASSERT_EQ(150u, log::search(text, entries, 1, log::Query {}, out).lines);
+
+	// Entries past the end of the log, as if it were not flushed yet, are ignored.
+	auto const flushed {std::string_view {text}.substr(0, text.find("request 120 "))};
+	ASSERT_EQ(120u, log::search(flushed.substr(0, flushed.rfind('\n') + 1), entries, count, log::Query {}, out).lines);
+
+	std::fclose(out);
+}
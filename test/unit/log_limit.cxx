@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL  // test every level regardless of the configured floor
+#include <collect.hxx>
+#include <log_async.hxx>  // for flush
+#include <log_limit.hxx>
+#include <log_sink.hxx>
+#undef ENABLE_LOGGING
+
+using namespace project;
+using test::Collect;
+
+namespace {
+std::uint64_t constexpr Second {1'000'000'000};
+}  // namespace
+
+class LogLimit : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		log::set_sink(_sink);
+		log::set_level(log::Level::Trace);
+	}
+
+	void TearDown() override
+	{
+		log::set_sink(nullptr);
+		log::set_level(log::Level::None);
+	}
+
+	std::shared_ptr<Collect> _sink {std::make_shared<Collect>(Collect::Format::Message)};
+};
+
+TEST(LogSampler, admits_one_in_n)
+{
+	log::Sampler sampler {3};
+	std::vector<bool> admitted;
+	for (int i {0}; i < 7; ++i) {
+		admitted.push_back(sampler.admit());
+	}
+	ASSERT_EQ((std::vector<bool> {true, false, false, true, false, false, true}), admitted);
+}
+
+TEST(LogRateLimiter, admits_burst_then_rate)
+{
+	log::RateLimiter limiter {10, 2};  // one token per 100 ms
+	auto const start {100 * Second};
+
+	ASSERT_TRUE(limiter.admit(start));
+	ASSERT_TRUE(limiter.admit(start));
+	ASSERT_FALSE(limiter.admit(start));
+	ASSERT_FALSE(limiter.admit(start + Second / 20));
+	ASSERT_EQ(2u, limiter.take_suppressed());
+	ASSERT_EQ(0u, limiter.take_suppressed());
+
+	ASSERT_TRUE(limiter.admit(start + Second / 10));
+	ASSERT_FALSE(limiter.admit(start + Second / 10));
+
+	// A quiet period refills the bucket, but never beyond the burst.
+	ASSERT_TRUE(limiter.admit(start + 10 * Second));
+	ASSERT_TRUE(limiter.admit(start + 10 * Second));
+	ASSERT_FALSE(limiter.admit(start + 10 * Second));
+}
+
+TEST(LogDeduplicator, counts_repeats)
+{
+	log::Deduplicator deduplicator;
+	std::uint64_t ended {0};
+
+	ASSERT_FALSE(deduplicator.repeated("a", ended));
+	ASSERT_EQ(0u, ended);
+	ASSERT_TRUE(deduplicator.repeated("a", ended));
+	ASSERT_TRUE(deduplicator.repeated("a", ended));
+	ASSERT_FALSE(deduplicator.repeated("b", ended));
+	ASSERT_EQ(2u, ended);
+}
+
+TEST_F(LogLimit, every_n)
+{
+	for (int i {0}; i < 7; ++i) {
+		PROJECT_LOG_EVERY_N(log::Level::Info, 3, "{}", i);
+	}
+	ASSERT_EQ((std::vector<std::string> {"0", "3", "6"}), _sink->lines);
+}
+
+TEST_F(LogLimit, every_n_skips_disabled_levels)
+{
+	log::set_level(log::Level::Info);
+	for (int i {0}; i < 3; ++i) {
+		PROJECT_LOG_EVERY_N(log::Level::Debug, 2, "{}", i);
+	}
+	log::set_level(log::Level::Trace);
+	for (int i {0}; i < 3; ++i) {
+		PROJECT_LOG_EVERY_N(log::Level::Debug, 2, "{}", i);
+	}
+	ASSERT_EQ((std::vector<std::string> {"0", "2"}), _sink->lines);
+}
+
+TEST_F(LogLimit, rate_limited)
+{
+	int evaluated {0};
+	auto const value {[&] { return ++evaluated; }};
+
+	for (int i {0}; i < 100; ++i) {
+		PROJECT_LOG_RATE_LIMITED(log::Level::Warning, 0.001, 3, "{}", value());  // one token per 1000 s
+	}
+
+	ASSERT_EQ((std::vector<std::string> {"1", "2", "3"}), _sink->lines);
+	ASSERT_EQ(3, evaluated);
+
+	// The count still pending is reported on flush, once.
+	log::flush();
+	log::flush();
+	ASSERT_EQ((std::vector<std::string> {"1", "2", "3", "97 messages suppressed"}), _sink->lines);
+}
+
+TEST_F(LogLimit, rate_limited_reports_at_exit)
+{
+	log::set_sink(nullptr);  // to stderr, which the death test reads
+
+	auto const burst_then_exit {[] {
+		for (int i {0}; i < 3; ++i) {
+			PROJECT_LOG_RATE_LIMITED(log::Level::Warning, 0.001, 1, "burst {}", i);
+		}
+		std::exit(0);
+	}};
+
+	EXPECT_EXIT(burst_then_exit(), ::testing::ExitedWithCode(0), "Warning: burst 0\nWarning: 2 messages suppressed\n");
+}
+
+TEST_F(LogLimit, deduplicated)
+{
+	auto const emit {[](int const value) { PROJECT_LOG_DEDUPLICATED(log::Level::Error, "value {}", value); }};
+
+	for (int const value : {1, 1, 1, 1, 2, 3, 3}) {
+		emit(value);
+	}
+
+	ASSERT_EQ((std::vector<std::string> {"value 1", "last message repeated 3 times", "value 2", "value 3"}),
+	          _sink->lines);
+
+	// The run still going is reported on flush, once.
+	log::flush();
+	log::flush();
+	ASSERT_EQ("last message repeated 1 times", _sink->lines.back());
+	ASSERT_EQ(5u, _sink->lines.size());
+
+	emit(3);
+	log::flush();
+	ASSERT_EQ("last message repeated 1 times", _sink->lines.back());
+	ASSERT_EQ(6u, _sink->lines.size());
+}
+
+TEST_F(LogLimit, deduplicated_reports_at_exit)
+{
+	log::set_sink(nullptr);  // to stderr, which the death test reads
+
+	auto const repeat_then_exit {[] {
+		for (int i {0}; i < 3; ++i) {
+			PROJECT_LOG_DEDUPLICATED(log::Level::Error, "same");
+		}
+		std::exit(0);
+	}};
+
+	EXPECT_EXIT(repeat_then_exit(), ::testing::ExitedWithCode(0),
+	            "Error: same\nError: last message repeated 2 times\n");
+}
+
+TEST_F(LogLimit, rate_limited_without_rate)
+{
+	std::atomic<int> evaluated {0};
+	auto const emit {[&] {
+		for (int i {0}; i < 100; ++i) {
+			PROJECT_LOG_RATE_LIMITED(log::Level::Warning, 0, 1, "{}", ++evaluated);  // unlimited
+		}
+	}};
+
+	std::vector<std::thread> threads;
+	for (int t {0}; t < 4; ++t) {
+		threads.emplace_back(emit);
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	ASSERT_EQ(400, evaluated.load());
+	ASSERT_EQ(400u, _sink->lines.size());
+
+	// A call timed before one another thread had admitted is admitted too, as is any at a rate too high to limit.
+	for (double const rate : {0.0, -1.0, 2e9}) {
+		log::RateLimiter limiter {rate, 1};
+		ASSERT_TRUE(limiter.admit(2 * Second));
+		ASSERT_TRUE(limiter.admit(Second));
+		ASSERT_EQ(0u, limiter.take_suppressed());
+	}
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL  // test every level regardless of the configured floor
+#include <log.hxx>
+#undef ENABLE_LOGGING
+
+using namespace project;
+
+class LogMacros : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		log::set_target(stderr);
+		log::set_level(log::Level::Info);
+	}
+
+	void TearDown() override
+	{
+		log::set_level(log::Level::None);
+	}
+
+	auto evaluate() -> int
+	{
+		return ++_evaluated;
+	}
+
+	int _evaluated {0};
+};
+
+TEST_F(LogMacros, enabled)
+{
+	::testing::internal::CaptureStderr();
+	PROJECT_LOG_ERROR("{} {}", "message", evaluate());
+	PROJECT_LOG_WARNING("{} {}", "message", evaluate());
+	PROJECT_LOG_INFO("{} {}", "message", evaluate());
+	std::string const result {::testing::internal::GetCapturedStderr()};
+
+	EXPECT_EQ("Error: message 1\nWarning: message 2\nInfo: message 3\n", result);
+	EXPECT_EQ(3, _evaluated);
+}
+
+TEST_F(LogMacros, one_arg)
+{
+	::testing::internal::CaptureStderr();
+	PROJECT_LOG_INFO("message");
+	std::string const result {::testing::internal::GetCapturedStderr()};
+	EXPECT_EQ("Info: message\n", result);
+}
+
+TEST_F(LogMacros, disabled_skips_arguments)
+{
+	::testing::internal::CaptureStderr();
+	PROJECT_LOG_DEBUG("{}", evaluate());
+	PROJECT_LOG_TRACE("{}", evaluate());
+	std::string const result {::testing::internal::GetCapturedStderr()};
+
+	EXPECT_TRUE(result.empty());
+	EXPECT_EQ(0, _evaluated);
+}
+
+TEST_F(LogMacros, runtime_level)
+{
+	log::set_level(log::Level::Trace);
+	::testing::internal::CaptureStderr();
+	PROJECT_LOG_TRACE("{}", evaluate());
+	std::string const result {::testing::internal::GetCapturedStderr()};
+
+	EXPECT_EQ("Trace: 1\n", result);
+	EXPECT_EQ(1, _evaluated);
+}
+
+TEST_F(LogMacros, statement)
+{
+	// Each macro is a single statement, so it nests under an unbraced if/else.
+	::testing::internal::CaptureStderr();
+	if (_evaluated == 0)
+		PROJECT_LOG_INFO("then");
+	else
+		PROJECT_LOG_INFO("else");
+	std::string const result {::testing::internal::GetCapturedStderr()};
+	EXPECT_EQ("Info: then\n", result);
+}
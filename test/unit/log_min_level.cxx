@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL
+#define PROJECT_LOG_MIN_LEVEL 3  // Level::Info
+#include <log.hxx>
+#undef ENABLE_LOGGING
+
+using namespace project;
+
+namespace {
+// Local to this file, so every log template instantiated with it sees this file's floor.
+struct Counted
+{
+	int* formatted;
+};
+}  // namespace
+
+template <>
+struct fmt::formatter<Counted> : fmt::formatter<int>
+{
+	auto format(Counted const& counted, format_context& ctx) const
+	{
+		return fmt::formatter<int>::format(++*counted.formatted, ctx);
+	}
+};
+
+class LogMinLevel : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		log::set_target(stderr);
+		log::set_level(log::Level::Trace);
+	}
+
+	void TearDown() override
+	{
+		log::set_level(log::Level::None);
+	}
+
+	int _formatted {0};
+};
+
+TEST_F(LogMinLevel, compiled)
+{
+	static_assert(log::MinLevel == log::Level::Info);
+	static_assert(log::compiled(log::Level::Error));
+	static_assert(log::compiled(log::Level::Warning));
+	static_assert(log::compiled(log::Level::Info));
+	static_assert(!log::compiled(log::Level::Debug));
+	static_assert(!log::compiled(log::Level::Trace));
+	static_assert(!log::compiled(log::Level::None));
+}
+
+TEST_F(LogMinLevel, above_floor)
+{
+	::testing::internal::CaptureStderr();
+	log::info("{}", Counted {&_formatted});
+	std::string const result {::testing::internal::GetCapturedStderr()};
+	EXPECT_EQ("Info: 1\n", result);
+	EXPECT_EQ(1, _formatted);
+}
+
+TEST_F(LogMinLevel, below_floor)
+{
+	::testing::internal::CaptureStderr();
+	log::debug("{}", Counted {&_formatted});
+	log::trace("{}", Counted {&_formatted});
+	log::print(log::Level::Trace, "{}", Counted {&_formatted});
+	std::string const result {::testing::internal::GetCapturedStderr()};
+	EXPECT_TRUE(result.empty());
+	EXPECT_EQ(0, _formatted);
+}
+
+TEST_F(LogMinLevel, macro_below_floor)
+{
+	int evaluated {0};
+	::testing::internal::CaptureStderr();
+	PROJECT_LOG_DEBUG("{}", ++evaluated);
+	PROJECT_LOG_TRACE("{}", ++evaluated);
+	PROJECT_LOG_INFO("{}", ++evaluated);
+	std::string const result {::testing::internal::GetCapturedStderr()};
+	EXPECT_EQ("Info: 1\n", result);
+	EXPECT_EQ(1, evaluated);
+}
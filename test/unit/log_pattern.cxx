@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>  // for std::abs
+#include <cstdio>
+#include <memory>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL  // test every level regardless of the configured floor
+#include <log_async.hxx>
+#include <log_binary.hxx>
+#include <log_category.hxx>
+#include <log_pattern.hxx>
+#undef ENABLE_LOGGING
+
+using namespace project;
+
+class LogPattern : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		_file = std::tmpfile();
+		ASSERT_NE(nullptr, _file);
+		log::set_target(_file);
+		log::set_level(log::Level::Trace);
+	}
+
+	void TearDown() override
+	{
+		log::stop_backend();
+		log::set_sink(nullptr);
+		log::set_pattern("{level}: {message}");
+		log::set_target(stderr);
+		log::set_level(log::Level::None);
+		std::fclose(_file);
+	}
+
+	auto contents() -> std::string
+	{
+		log::flush();
+		std::string result;
+		std::rewind(_file);
+		char buffer[4096];
+		while (auto const size {std::fread(buffer, 1, sizeof buffer, _file)}) {
+			result.append(buffer, size);
+		}
+		return result;
+	}
+
+	std::FILE* _file {nullptr};
+};
+
+TEST_F(LogPattern, default_pattern)
+{
+	ASSERT_EQ("{level}: {message}", log::get_pattern());
+	log::info("{}", "message");
+	ASSERT_EQ("Info: message\n", contents());
+}
+
+TEST_F(LogPattern, fields)
+{
+	log::set_pattern("[{level}] {message} ({thread}) {{literal}}");
+	log::warning("{} {}", "message", 1);
+
+	auto const expected {fmt::format("[Warning] message 1 ({}) {{literal}}\n", log::detail::thread_id())};
+	ASSERT_EQ(expected, contents());
+}
+
+TEST_F(LogPattern, time)
+{
+	log::set_pattern("{time} {message}");
+	log::info("message");
+
+	std::regex const layout {R"(\d{4}-\d\d-\d\d \d\d:\d\d:\d\d\.\d{6} message\n)"};
+	auto const text {contents()};
+	ASSERT_TRUE(std::regex_match(text, layout)) << text;
+}
+
+TEST_F(LogPattern, call_site)
+{
+	log::set_pattern("{file}:{line} {function} {category}|{message}");
+	log::info("plain");
+	PROJECT_LOG_INFO("macro");
+	auto const line {__LINE__ - 1};
+	PROJECT_LOG_CATEGORY_INFO("net", "category");
+
+	auto const text {contents()};
+	ASSERT_EQ(0u, text.find(":  |plain\n"));  // no call site
+	ASSERT_NE(std::string::npos, text.find(fmt::format("log_pattern.cxx:{} TestBody |macro\n", line)));
+	ASSERT_NE(std::string::npos, text.find(" TestBody net|category\n"));
+}
+
+TEST_F(LogPattern, backend_and_binary)
+{
+	log::set_pattern("{thread} {level} {message}");
+	auto const thread {log::detail::thread_id()};
+
+	log::start_backend();
+	std::thread {[] { log::info("other"); }}.join();
+	log::info("async {}", 1);
+	log::stop_backend();
+
+	auto const text {contents()};
+	ASSERT_NE(std::string::npos, text.find(fmt::format("{} Info async 1\n", thread)));
+	ASSERT_EQ(std::string::npos, text.find(fmt::format("{} Info other\n", thread)));  // stamped by its own thread
+
+	std::FILE* binary {std::tmpfile()};
+	ASSERT_NE(nullptr, binary);
+	log::set_sink(std::make_shared<log::BinarySink>(binary));
+	PROJECT_LOG_ERROR("binary {}", 2);
+	log::set_sink(nullptr);
+
+	std::FILE* decoded {std::tmpfile()};
+	ASSERT_NE(nullptr, decoded);
+	log::set_pattern("{function} {thread} {level} {message}");
+	std::rewind(binary);
+	ASSERT_TRUE(log::decode_binary(binary, decoded));
+
+	char buffer[256] {};
+	std::rewind(decoded);
+	std::fread(buffer, 1, sizeof buffer - 1, decoded);
+	ASSERT_EQ(fmt::format("TestBody {} Error binary 2\n", thread), buffer);
+
+	std::fclose(decoded);
+	std::fclose(binary);
+}
+
+TEST_F(LogPattern, invalid)
+{
+	ASSERT_THROW(log::set_pattern("no message"), std::invalid_argument);
+	ASSERT_THROW(log::set_pattern("{message} {message}"), std::invalid_argument);
+	ASSERT_THROW(log::set_pattern("{unknown} {message}"), std::invalid_argument);
+	ASSERT_THROW(log::set_pattern("{message"), std::invalid_argument);
+	ASSERT_THROW(log::set_pattern("message}"), std::invalid_argument);
+	ASSERT_EQ("{level}: {message}", log::get_pattern());  // unchanged
+}
+
+TEST(LogClock, now)
+{
+	using namespace std::chrono;
+
+	auto const wall {duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count()};
+	auto const first {log::detail::now()};
+	auto const second {log::detail::now()};
+
+	ASSERT_LE(first, second);  // monotonic
+	ASSERT_LT(std::abs(static_cast<long long>(first) - static_cast<long long>(wall)), 1'000'000'000);
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>  // for std::mkstemp
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <log_category.hxx>
+#include <log_reload.hxx>
+
+using namespace project;
+
+namespace {
+/// Wait up to five seconds for a config newer than \p generation.
+auto wait_for_config(std::uint64_t const generation) -> log::LevelConfig const*
+{
+	auto const deadline {std::chrono::steady_clock::now() + std::chrono::seconds {5}};
+	while (std::chrono::steady_clock::now() < deadline) {
+		auto const* const config {log::current_config()};
+		if (config && config->generation > generation) {
+			return config;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds {5});
+	}
+	return nullptr;
+}
+}  // namespace
+
+class LogReload : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		char name[] {"/tmp/log_reload_XXXXXX"};
+		int const fd {::mkstemp(name)};
+		ASSERT_GE(fd, 0);
+		::close(fd);
+		_path = name;
+	}
+
+	void TearDown() override
+	{
+		log::stop_reload();
+		log::configure("");
+		log::set_level(log::Level::None);
+		std::remove(_path.c_str());
+	}
+
+	void write(char const* text)
+	{
+		std::FILE* out {std::fopen(_path.c_str(), "w")};
+		ASSERT_NE(nullptr, out);
+		std::fputs(text, out);
+		std::fclose(out);
+	}
+
+	auto generation() -> std::uint64_t
+	{
+		auto const* const config {log::current_config()};
+		return config ? config->generation : 0;
+	}
+
+	std::string _path;
+};
+
+TEST_F(LogReload, applies_file)
+{
+	write("# levels\nwarning\nreload.a = trace  # comment\n\n");
+	log::start_reload({_path, false, false});
+
+	auto const* const config {log::current_config()};
+	ASSERT_NE(nullptr, config);
+	EXPECT_EQ(log::Level::Warning, config->global);
+	EXPECT_EQ(log::Level::Trace, log::category("reload.a").level());
+}
+
+TEST_F(LogReload, rejects_missing_and_invalid_files)
+{
+	EXPECT_THROW(log::start_reload({_path + ".missing"}), std::system_error);
+
+	write("loud\n");
+	auto const before {generation()};
+	EXPECT_THROW(log::reload(_path), std::invalid_argument);
+	EXPECT_EQ(before, generation());
+}
+
+TEST_F(LogReload, reloads_when_written)
+{
+	write("info\n");
+	log::start_reload({_path, true, false});
+	auto const before {generation()};
+
+	write("debug,reload.b=error\n");
+	auto const* const config {wait_for_config(before)};
+	ASSERT_NE(nullptr, config);
+	EXPECT_EQ(log::Level::Debug, config->global);
+	EXPECT_EQ(log::Level::Error, log::category("reload.b").level());
+}
+
+TEST_F(LogReload, reloads_on_sighup)
+{
+	write("info\n");
+	log::start_reload({_path, false, true});
+	auto const before {generation()};
+
+	write("error\n");
+	std::raise(SIGHUP);
+	auto const* const config {wait_for_config(before)};
+	ASSERT_NE(nullptr, config);
+	EXPECT_EQ(log::Level::Error, config->global);
+}
+
+TEST_F(LogReload, keeps_levels_when_reload_fails)
+{
+	std::FILE* target {std::tmpfile()};
+	ASSERT_NE(nullptr, target);
+	log::set_target(target);
+
+	write("warning\n");
+	log::start_reload({_path, false, true});
+	auto const before {generation()};
+
+	write("warning,reload.c=bad\n");
+	std::raise(SIGHUP);
+
+	struct ::stat status {};
+	auto const deadline {std::chrono::steady_clock::now() + std::chrono::seconds {5}};
+	while (::fstat(::fileno(target), &status) == 0 && status.st_size == 0
+	       && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds {5});
+	}
+	log::stop_reload();
+	log::set_target(stderr);
+	EXPECT_EQ(before, generation());
+
+	std::string text(256, '\0');
+	std::rewind(target);
+	text.resize(std::fread(text.data(), 1, text.size(), target));
+	std::fclose(target);
+	EXPECT_NE(std::string::npos, text.find("cannot reload log levels")) << text;
+}
@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>  // for O_* constants
+#include <sys/mman.h>  // for shm_open
+#include <unistd.h>  // for getpid, ftruncate
+
+#define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL  // test every level regardless of the configured floor
+#include <log_shm.hxx>
+#undef ENABLE_LOGGING
+
+using namespace project;
+using Status = log::SharedMemoryReader::Status;
+
+class LogShm : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		auto const* test {::testing::UnitTest::GetInstance()->current_test_info()};
+		_name = fmt::format("/log_shm-{}-{}", test->name(), ::getpid());
+		log::set_level(log::Level::Trace);
+	}
+
+	void TearDown() override
+	{
+		log::set_sink(nullptr);
+		log::set_level(log::Level::None);
+		::shm_unlink(_name.c_str());
+	}
+
+	void make_sink(std::size_t slot_count = 16, std::size_t slot_size = 64)
+	{
+		log::set_sink(std::make_shared<log::SharedMemorySink>(log::SharedMemoryOptions {_name, slot_size, slot_count}));
+	}
+
+	/// Read until the ring is empty or closed; return that status.
+	static auto read_all(log::SharedMemoryReader& reader, std::string& text) -> Status
+	{
+		fmt::memory_buffer buffer;
+		Status status;
+		while ((status = reader.next(buffer)) == Status::Line) {
+		}
+		text.assign(buffer.data(), buffer.size());
+		return status;
+	}
+
+	std::string _name;
+};
+
+TEST_F(LogShm, reads_lines)
+{
+	make_sink();
+	log::SharedMemoryReader reader {_name};
+
+	log::info("{} {}", "message", 1);
+	log::error("second");
+
+	std::string text;
+	ASSERT_EQ(Status::Empty, read_all(reader, text));
+	ASSERT_EQ("Info: message 1\nError: second\n", text);
+	ASSERT_EQ(0u, reader.lost());
+
+	log::info("third");
+	ASSERT_EQ(Status::Empty, read_all(reader, text));
+	ASSERT_EQ("Info: third\n", text);
+}
+
+TEST_F(LogShm, truncates_long_lines)
+{
+	make_sink(16, 64);
+	log::SharedMemoryReader reader {_name};
+
+	log::info("{}", std::string(200, 'x'));
+
+	std::string text;
+	read_all(reader, text);
+	ASSERT_LT(text.size(), 64u);
+	ASSERT_EQ(0u, text.find("Info: xxx"));
+	ASSERT_EQ('\n', text.back());
+}
+
+TEST_F(LogShm, reports_overrun)
+{
+	make_sink(16);
+	log::SharedMemoryReader reader {_name};
+
+	for (int i {0}; i < 40; ++i) {
+		log::info("message {:02}", i);
+	}
+
+	// The reader fell more than a lap behind: the oldest 24 lines are gone, the rest intact.
+	std::string text;
+	read_all(reader, text);
+	ASSERT_EQ(24u, reader.lost());
+
+	std::string expected;
+	for (int i {24}; i < 40; ++i) {
+		expected += fmt::format("Info: message {:02}\n", i);
+	}
+	ASSERT_EQ(expected, text);
+}
+
+TEST_F(LogShm, starts_at_oldest_line)
+{
+	make_sink(4);
+	for (int i {0}; i < 6; ++i) {
+		log::info("message {}", i);
+	}
+
+	log::SharedMemoryReader reader {_name};
+	std::string text;
+	read_all(reader, text);
+	ASSERT_EQ("Info: message 2\nInfo: message 3\nInfo: message 4\nInfo: message 5\n", text);
+	ASSERT_EQ(0u, reader.lost());
+}
+
+TEST_F(LogShm, closed_after_sink)
+{
+	// Routed sinks are kept alive once removed, so write to this one directly.
+	auto sink {std::make_unique<log::SharedMemorySink>(log::SharedMemoryOptions {_name, 64, 16})};
+	log::SharedMemoryReader reader {_name};
+
+	sink->write(log::Event {log::Level::Info, nullptr, 0, 0, "last", {}, nullptr});
+	sink.reset();  // unlinks the object
+
+	std::string text;
+	ASSERT_EQ(Status::Closed, read_all(reader, text));
+	ASSERT_EQ("Info: last\n", text);
+	ASSERT_THROW(log::SharedMemoryReader {_name}, std::system_error);
+}
+
+TEST_F(LogShm, concurrent_writers)
+{
+	make_sink(1024);
+	log::SharedMemoryReader reader {_name};
+
+	std::vector<std::thread> threads;
+	for (int t {0}; t < 4; ++t) {
+		threads.emplace_back([t] {
+			for (int i {0}; i < 100; ++i) {
+				log::info("thread {} message {:03}", t, i);
+			}
+		});
+	}
+
+	// Read while the writers run; every line is either read whole or counted lost.
+	fmt::memory_buffer buffer;
+	std::size_t lines {0};
+	while (lines + reader.lost() < 400) {
+		if (reader.next(buffer) == Status::Line) {
+			++lines;
+		}
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	std::string const text {buffer.data(), buffer.size()};
+	std::size_t count {0};
+	for (std::size_t start {0}, end; (end = text.find('\n', start)) != std::string::npos; start = end + 1) {
+		ASSERT_EQ(0u, text.compare(start, 13, "Info: thread "));
+		ASSERT_EQ(26u, end - start);
+		++count;
+	}
+	ASSERT_EQ(lines, count);
+}
+
+TEST_F(LogShm, more_writers_than_slots)
+{
+	// Writers a lap apart meet on the same slot; each line must still be one writer's, whole.
+	auto const sink {std::make_shared<log::SharedMemorySink>(log::SharedMemoryOptions {_name, 64, 2})};
+	log::set_sink(sink);
+	log::SharedMemoryReader reader {_name};
+
+	int constexpr Threads {8};
+	int constexpr Messages {2000};
+	std::atomic<int> running {Threads};
+	std::vector<std::thread> threads;
+	for (int t {0}; t < Threads; ++t) {
+		threads.emplace_back([t, &running] {
+			std::string const text(40, static_cast<char>('a' + t));
+			for (int i {0}; i < Messages; ++i) {
+				log::info("{}", text);
+			}
+			running.fetch_sub(1);
+		});
+	}
+
+	fmt::memory_buffer buffer;
+	std::size_t lines {0};
+	while (running.load() > 0) {
+		if (reader.next(buffer) == Status::Line) {
+			++lines;
+		}
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	while (reader.next(buffer) == Status::Line) {
+		++lines;
+	}
+
+	std::string const text {buffer.data(), buffer.size()};
+	std::size_t count {0};
+	for (std::size_t start {0}, end; (end = text.find('\n', start)) != std::string::npos; start = end + 1) {
+		ASSERT_EQ(46u, end - start);
+		ASSERT_EQ(0u, text.compare(start, 6, "Info: "));
+		ASSERT_EQ(std::string(40, text[start + 6]), text.substr(start + 6, 40));
+		++count;
+	}
+	ASSERT_EQ(lines, count);
+	ASSERT_LE(lines + sink->dropped(), std::size_t {Threads * Messages});
+}
+
+TEST_F(LogShm, rejects_other_objects)
+{
+	ASSERT_THROW(log::SharedMemoryReader {_name}, std::system_error);  // missing
+
+	int const fd {::shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600)};
+	ASSERT_GE(fd, 0);
+	ASSERT_EQ(0, ::ftruncate(fd, 4096));
+	::close(fd);
+
+	ASSERT_THROW(log::SharedMemoryReader {_name}, std::runtime_error);  // zero-filled: no magic
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define ENABLE_LOGGING 1
+#undef PROJECT_LOG_MIN_LEVEL  // test every level regardless of the configured floor
+#include <collect.hxx>
+#include <log_async.hxx>  // for log::flush
+#include <log_category.hxx>
+#include <log_sink.hxx>
+#undef ENABLE_LOGGING
+
+using namespace project;
+using test::Collect;
+
+class LogSink : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		log::set_level(log::Level::Trace);
+	}
+
+	void TearDown() override
+	{
+		log::set_sink(nullptr);
+		log::set_level(log::Level::None);
+	}
+};
+
+TEST_F(LogSink, receives_events)
+{
+	auto const sink {std::make_shared<Collect>()};
+	log::set_sink(sink);
+	ASSERT_EQ(sink, log::get_sink());
+
+	log::info("{}", 1);
+	PROJECT_LOG_ERROR("{}", 2);
+
+	ASSERT_EQ((std::vector<std::string> {"Info: 1\n", "Error: 2\n"}), sink->lines);
+	ASSERT_EQ((std::vector<bool> {false, false}), sink->packed);
+	ASSERT_EQ(nullptr, sink->sites[0]);
+	ASSERT_NE(nullptr, sink->sites[1]);
+	ASSERT_EQ(log::Level::Error, sink->sites[1]->level);
+}
+
+TEST_F(LogSink, deferred_sink_receives_arguments)
+{
+	auto const sink {std::make_shared<Collect>(Collect::Format::Text, true)};
+	log::set_sink(sink);
+
+	log::info("{} {}", "a", 1);
+
+	ASSERT_EQ((std::vector<std::string> {"Info: a 1\n"}), sink->lines);
+	ASSERT_EQ((std::vector<bool> {true}), sink->packed);
+}
+
+TEST_F(LogSink, reset_restores_target)
+{
+	std::FILE* file {std::tmpfile()};
+	ASSERT_NE(nullptr, file);
+	log::set_target(file);
+
+	auto const sink {std::make_shared<Collect>(Collect::Format::Text, true)};
+	log::set_sink(sink);
+	log::info("to sink");
+	log::set_sink(nullptr);
+	log::info("{}", "to target");
+
+	char buffer[64] {};
+	std::rewind(file);
+	std::fread(buffer, 1, sizeof buffer - 1, file);
+
+	ASSERT_STREQ("Info: to target\n", buffer);
+	ASSERT_EQ(1u, sink->lines.size());
+
+	log::set_target(stderr);
+	std::fclose(file);
+}
+
+TEST_F(LogSink, routes_by_sink_level)
+{
+	auto const errors {std::make_shared<Collect>()};
+	auto const all {std::make_shared<Collect>()};
+	log::add_sink(errors, log::Level::Error);
+	auto const id {log::add_sink(all, log::Level::Debug)};
+
+	log::error("1");
+	log::info("2");
+	log::trace("3");
+
+	ASSERT_EQ((std::vector<std::string> {"Error: 1\n"}), errors->lines);
+	ASSERT_EQ((std::vector<std::string> {"Error: 1\n", "Info: 2\n"}), all->lines);
+
+	log::set_sink_level(id, log::Level::Warning);
+	log::info("4");
+	log::warning("5");
+
+	ASSERT_EQ((std::vector<std::string> {"Error: 1\n"}), errors->lines);
+	ASSERT_EQ((std::vector<std::string> {"Error: 1\n", "Info: 2\n", "Warning: 5\n"}), all->lines);
+
+	log::remove_sink(id);
+	log::error("6");
+
+	ASSERT_EQ(3u, all->lines.size());
+	ASSERT_EQ((std::vector<std::string> {"Error: 1\n", "Error: 6\n"}), errors->lines);
+}
+
+TEST_F(LogSink, unwanted_levels_are_disabled)
+{
+	auto& category {log::category("LogSink.unwanted_levels_are_disabled")};
+	category.set_level(log::Level::Trace);
+
+	auto const id {log::add_sink(std::make_shared<Collect>(), log::Level::Warning)};
+
+	ASSERT_EQ(log::Level::Trace, log::get_level());
+	ASSERT_TRUE(log::enabled(log::Level::Warning));
+	ASSERT_FALSE(log::enabled(log::Level::Info));
+	ASSERT_EQ(log::Level::Warning, category.level());
+
+	log::remove_sink(id);
+
+	ASSERT_TRUE(log::enabled(log::Level::Trace));
+	ASSERT_EQ(log::Level::Trace, category.level());
+	category.reset_level();
+}
+
+TEST_F(LogSink, set_sink_replaces_all)
+{
+	auto const first {std::make_shared<Collect>()};
+	auto const second {std::make_shared<Collect>()};
+	log::add_sink(first, log::Level::Error);
+	log::add_sink(second, log::Level::Error);
+	ASSERT_EQ(first, log::get_sink());
+
+	auto const only {std::make_shared<Collect>()};
+	log::set_sink(only);
+	log::trace("1");
+
+	ASSERT_EQ(only, log::get_sink());
+	ASSERT_TRUE(first->lines.empty());
+	ASSERT_TRUE(second->lines.empty());
+	ASSERT_EQ(1u, only->lines.size());
+}
+
+TEST_F(LogSink, add_rejects_null_and_overflow)
+{
+	ASSERT_THROW(log::add_sink(nullptr), std::invalid_argument);
+
+	auto const sink {std::make_shared<Collect>()};
+	for (std::size_t i {0}; i < log::MaxSinks; ++i) {
+		log::add_sink(sink);
+	}
+	ASSERT_THROW(log::add_sink(sink), std::length_error);
+}
+
+TEST_F(LogSink, file_sink_writes_text)
+{
+	std::FILE* file {std::tmpfile()};
+	ASSERT_NE(nullptr, file);
+
+	auto const collect {std::make_shared<Collect>()};
+	log::add_sink(std::make_shared<log::FileSink>(file), log::Level::Error);
+	log::add_sink(collect, log::Level::Trace);
+
+	log::error("both");
+	log::debug("one");
+	log::flush();
+
+	char buffer[64] {};
+	std::rewind(file);
+	std::fread(buffer, 1, sizeof buffer - 1, file);
+
+	ASSERT_STREQ("Error: both\n", buffer);
+	ASSERT_EQ(2u, collect->lines.size());
+
+	log::set_sink(nullptr);
+	std::fclose(file);
+}
@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>  // for std::count, std::find, std::find_if
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#define ENABLE_METRICS 1
+#include <collect.hxx>
+#include <log_sink.hxx>
+#include <metrics.hxx>
+#undef ENABLE_METRICS
+
+using namespace project;
+using test::Collect;
+
+namespace {
+auto counted(std::string_view const name) -> std::uint64_t
+{
+	auto const data {metrics::snapshot()};
+	auto const found {std::find_if(data.counters.begin(), data.counters.end(),
+	                               [&](auto const& counter) { return counter.name == name; })};
+	return found == data.counters.end() ? 0 : found->value;
+}
+
+auto histogram(std::string_view const name) -> metrics::HistogramValue
+{
+	auto data {metrics::snapshot()};
+	for (auto& value : data.histograms) {
+		if (value.name == name) {
+			return std::move(value);
+		}
+	}
+	return {name, 0, 0, 0, 0, {}};
+}
+}  // namespace
+
+TEST(Metrics, buckets)
+{
+	using namespace metrics::detail;
+
+	static_assert(bucket_of(0) == 0);
+	static_assert(bucket_of(15) == 15);
+	static_assert(bucket_of(16) == 16);
+	static_assert(bucket_of(32) == 32);
+	static_assert(bucket_of(~std::uint64_t {0}) == BucketCount - 1);
+
+	for (std::size_t b {0}; b < BucketCount; ++b) {
+		auto const floor {bucket_floor(b)};
+		ASSERT_EQ(b, bucket_of(floor));
+		if (b > 0) {
+			ASSERT_EQ(b - 1, bucket_of(floor - 1));
+		}
+		if (b + 1 < BucketCount) {
+			ASSERT_LE(bucket_floor(b + 1) - floor, std::max<std::uint64_t>(floor / 16, 1));  // 1/16 wide at most
+		}
+	}
+}
+
+TEST(Metrics, counter)
+{
+	auto& counter {metrics::counter("metrics.counter")};
+	ASSERT_EQ(&counter, &metrics::counter("metrics.counter"));
+	ASSERT_EQ("metrics.counter", counter.name());
+
+	counter.add();
+	counter.add(4);
+	ASSERT_EQ(5u, counted("metrics.counter"));
+}
+
+TEST(Metrics, counts_exited_threads)
+{
+	auto& counter {metrics::counter("metrics.threads")};
+
+	std::vector<std::thread> threads;
+	for (int t {0}; t < 4; ++t) {
+		threads.emplace_back([&counter] {
+			for (int i {0}; i < 1000; ++i) {
+				counter.add();
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	ASSERT_EQ(4000u, counted("metrics.threads"));
+
+	// Shards of exited threads are reused, without their counts.
+	std::thread {[&counter] { counter.add(); }}.join();
+	ASSERT_EQ(4001u, counted("metrics.threads"));
+}
+
+TEST(Metrics, histogram)
+{
+	auto& histogram {metrics::histogram("metrics.histogram")};
+	for (std::uint64_t i {1}; i <= 1000; ++i) {
+		histogram.record(i);
+	}
+
+	auto const value {::histogram("metrics.histogram")};
+	ASSERT_EQ(1000u, value.count);
+	ASSERT_EQ(500500u, value.sum);
+	ASSERT_EQ(1u, value.min);
+	ASSERT_EQ(1000u, value.max);
+	ASSERT_NEAR(500.0, static_cast<double>(value.percentile(0.5)), 500.0 / 16);
+	ASSERT_NEAR(990.0, static_cast<double>(value.percentile(0.99)), 990.0 / 16);
+	ASSERT_EQ(1u, value.percentile(0.0));
+	ASSERT_EQ(1000u, value.percentile(1.0));
+}
+
+TEST(Metrics, macros)
+{
+	for (int i {0}; i < 3; ++i) {
+		PROJECT_METRICS_COUNT("metrics.macro.count", 2);
+		PROJECT_METRICS_RECORD("metrics.macro.record", 7);
+		PROJECT_METRICS_SPAN("metrics.macro.span");
+		std::this_thread::sleep_for(std::chrono::milliseconds {1});
+	}
+
+	ASSERT_EQ(6u, counted("metrics.macro.count"));
+	ASSERT_EQ(3u, histogram("metrics.macro.record").count);
+	ASSERT_EQ(7u, histogram("metrics.macro.record").max);
+
+	auto const span {histogram("metrics.macro.span")};
+	ASSERT_EQ(3u, span.count);
+	ASSERT_GE(span.min, 1'000'000u);  // nanoseconds
+}
+
+TEST(Metrics, report)
+{
+	auto sink {std::make_shared<Collect>()};
+	log::set_sink(sink);
+	log::set_level(log::Level::Info);
+
+	metrics::counter("metrics.report.count").add(3);
+	metrics::histogram("metrics.report.latency").record(42);
+	metrics::report(log::Level::Info);
+	metrics::report(log::Level::Debug);  // disabled
+
+	log::set_sink(nullptr);
+	log::set_level(log::Level::None);
+
+	auto const has = [&](std::string const& line) {
+		return std::find(sink->lines.begin(), sink->lines.end(), line) != sink->lines.end();
+	};
+	ASSERT_TRUE(has("Info: counter name=metrics.report.count value=3\n"));
+	ASSERT_TRUE(has("Info: histogram name=metrics.report.latency count=1 min=42 p50=42 p90=42 p99=42 max=42\n"));
+	ASSERT_EQ(metrics::snapshot().counters.size() + metrics::snapshot().histograms.size(), sink->lines.size());
+}
+
+TEST(Metrics, dump)
+{
+	metrics::counter("metrics.dump").add(9);
+
+	std::FILE* file {std::tmpfile()};
+	ASSERT_NE(nullptr, file);
+	metrics::dump(file);
+
+	std::string text(4096 * 4, '\0');
+	std::rewind(file);
+	text.resize(std::fread(text.data(), 1, text.size(), file));
+	std::fclose(file);
+
+	ASSERT_NE(std::string::npos, text.find("counter metrics.dump 9\n"));
+}
+
+TEST(Metrics, reports_periodically)
+{
+	auto sink {std::make_shared<Collect>()};
+	log::set_sink(sink);
+	log::set_level(log::Level::Info);
+
+	metrics::counter("metrics.periodic").add();
+	metrics::start_reporting(std::chrono::milliseconds {10});
+	std::this_thread::sleep_for(std::chrono::milliseconds {100});
+	metrics::stop_reporting();
+
+	log::set_sink(nullptr);
+	log::set_level(log::Level::None);
+
+	auto const reports {
+	    std::count(sink->lines.begin(), sink->lines.end(), "Info: counter name=metrics.periodic value=1\n")};
+	ASSERT_GE(reports, 2);
+}
+
+TEST(Metrics, too_many)  // last: later tests could not add counters
+{
+	for (std::size_t i {0}; metrics::snapshot().counters.size() < metrics::MaxCounters; ++i) {
+		metrics::counter(fmt::format("metrics.many.{}", i));
+	}
+	ASSERT_THROW(metrics::counter("metrics.one.too.many"), std::length_error);
+}
@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>  // for std::none_of
+
+#undef ENABLE_METRICS
+#define ENABLE_METRICS 0
+#include <metrics.hxx>
+
+using namespace project;
+
+TEST(MetricsDisabled, macros_compile_to_nothing)
+{
+	int evaluated {0};
+
+	PROJECT_METRICS_COUNT("metrics.disabled.count", ++evaluated);
+	PROJECT_METRICS_RECORD("metrics.disabled.record", ++evaluated);
+	PROJECT_METRICS_SPAN("metrics.disabled.span");
+
+	ASSERT_EQ(0, evaluated);
+
+	// Nor were the metrics created.
+	auto const data {metrics::snapshot()};
+	ASSERT_TRUE(std::none_of(data.counters.begin(), data.counters.end(),
+	                         [](auto const& counter) { return counter.name == "metrics.disabled.count"; }));
+	ASSERT_TRUE(std::none_of(data.histograms.begin(), data.histograms.end(),
+	                         [](auto const& histogram) { return histogram.name.substr(0, 16) == "metrics.disabled"; }));
+}
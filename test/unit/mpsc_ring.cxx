@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mpsc_ring.hxx>
+
+using project::detail::MpscRing;
+
+TEST(MpscRing, capacity_rounds_up)
+{
+	MpscRing<int> const ring {5};
+	ASSERT_EQ(8, ring.capacity());
+}
+
+TEST(MpscRing, fifo)
+{
+	MpscRing<int> ring {4};
+	ASSERT_TRUE(ring.try_push(1));
+	ASSERT_TRUE(ring.try_push(2));
+
+	int value {};
+	ASSERT_TRUE(ring.try_pop(value));
+	EXPECT_EQ(1, value);
+	ASSERT_TRUE(ring.try_pop(value));
+	EXPECT_EQ(2, value);
+	EXPECT_FALSE(ring.try_pop(value));
+}
+
+TEST(MpscRing, full)
+{
+	MpscRing<int> ring {2};
+	ASSERT_TRUE(ring.try_push(1));
+	ASSERT_TRUE(ring.try_push(2));
+	EXPECT_FALSE(ring.try_push(3));
+
+	int value {};
+	ASSERT_TRUE(ring.try_pop(value));
+	EXPECT_TRUE(ring.try_push(3));
+	EXPECT_EQ(3, ring.claimed());
+}
+
+TEST(MpscRing, in_place)
+{
+	MpscRing<std::string> ring {2};
+	std::string const text(100, 'x');
+	std::vector<char const*> storage;
+
+	for (int lap {0}; lap < 2; ++lap) {
+		for (int i {0}; i < 2; ++i) {
+			ASSERT_TRUE(ring.try_push_with([&](std::string& slot) { slot.assign(text); }));
+		}
+		for (int i {0}; i < 2; ++i) {
+			ASSERT_TRUE(ring.try_pop_with([&](std::string& slot) {
+				EXPECT_EQ(text, slot);
+				storage.push_back(slot.data());
+			}));
+		}
+	}
+
+	EXPECT_EQ(storage[0], storage[2]);  // slots keep their storage between laps
+	EXPECT_EQ(storage[1], storage[3]);
+}
+
+TEST(MpscRing, wraps_around)
+{
+	MpscRing<int> ring {4};
+	int value {};
+
+	for (int i {0}; i < 100; ++i) {
+		ASSERT_TRUE(ring.try_push(i));
+		ASSERT_TRUE(ring.try_pop(value));
+		ASSERT_EQ(i, value);
+	}
+}
+
+TEST(MpscRing, peek_pending)
+{
+	MpscRing<int> ring {4};
+	int value {};
+
+	for (int i {0}; i < 6; ++i) {
+		ASSERT_TRUE(ring.try_push(i));
+		if (i < 3) {
+			ASSERT_TRUE(ring.try_pop(value));
+		}
+	}
+
+	std::vector<int> pending;
+	ring.peek_pending([&](int const& queued) { pending.push_back(queued); });
+
+	EXPECT_EQ((std::vector<int> {3, 4, 5}), pending);
+	ASSERT_TRUE(ring.try_pop(value));
+	EXPECT_EQ(3, value);  // peeking leaves values queued
+}
+
+TEST(MpscRing, multiple_producers)
+{
+	struct Item
+	{
+		int producer;
+		int sequence;
+	};
+
+	int constexpr producers {4};
+	int constexpr per_producer {20000};
+
+	MpscRing<Item> ring {64};
+	std::vector<std::thread> threads;
+
+	for (int p {0}; p < producers; ++p) {
+		threads.emplace_back([&ring, p] {
+			for (int i {0}; i < per_producer; ++i) {
+				while (!ring.try_push(Item {p, i})) {
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+
+	std::vector<int> next(producers, 0);
+	int received {0};
+	Item item {};
+
+	while (received < producers * per_producer) {
+		if (ring.try_pop(item)) {
+			ASSERT_EQ(next[item.producer], item.sequence);  // each producer's items stay in order
+			++next[item.producer];
+			++received;
+		}
+	}
+
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	EXPECT_FALSE(ring.try_pop(item));
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <utility>  // for std::swap
+#include <vector>
+
+#include <spsc_ring.hxx>
+
+using project::SpscRing;
+
+TEST(SpscRing, capacity_rounds_up)
+{
+	SpscRing<int> const ring {5};
+	ASSERT_EQ(8, ring.capacity());
+}
+
+TEST(SpscRing, fifo)
+{
+	SpscRing<int> ring {4};
+	ASSERT_TRUE(ring.try_push(1));
+	ASSERT_TRUE(ring.try_push(2));
+	EXPECT_EQ(2, ring.size());
+
+	int value {};
+	ASSERT_TRUE(ring.try_pop(value));
+	EXPECT_EQ(1, value);
+	ASSERT_TRUE(ring.try_pop(value));
+	EXPECT_EQ(2, value);
+	EXPECT_FALSE(ring.try_pop(value));
+	EXPECT_EQ(0, ring.size());
+}
+
+TEST(SpscRing, full)
+{
+	SpscRing<int> ring {2};
+	ASSERT_TRUE(ring.try_push(1));
+	ASSERT_TRUE(ring.try_push(2));
+	EXPECT_FALSE(ring.try_push(3));
+	EXPECT_EQ(2, ring.size());
+
+	int value {};
+	ASSERT_TRUE(ring.try_pop(value));
+	EXPECT_TRUE(ring.try_push(3));
+	ASSERT_TRUE(ring.try_pop(value));
+	ASSERT_TRUE(ring.try_pop(value));
+	EXPECT_EQ(3, value);
+}
+
+TEST(SpscRing, swaps_storage)
+{
+	SpscRing<std::string> ring {2};
+	std::string text(100, 'x');
+	auto const* const storage {text.data()};
+
+	ASSERT_TRUE(ring.try_push_with([&](std::string& slot) { std::swap(slot, text); }));
+	ASSERT_TRUE(ring.try_pop_with([&](std::string& slot) { std::swap(slot, text); }));
+
+	EXPECT_EQ(std::string(100, 'x'), text);
+	EXPECT_EQ(storage, text.data());  // buffers travel through the ring without copies
+}
+
+TEST(SpscRing, wraps_around)
+{
+	SpscRing<int> ring {4};
+	int value {};
+
+	for (int i {0}; i < 100; ++i) {
+		ASSERT_TRUE(ring.try_push(i));
+		ASSERT_TRUE(ring.try_pop(value));
+		ASSERT_EQ(i, value);
+	}
+}
+
+TEST(SpscRing, threads)
+{
+	int constexpr count {100000};
+	SpscRing<int> ring {64};
+
+	std::thread producer {[&ring] {
+		for (int i {0}; i < count; ++i) {
+			while (!ring.try_push(i)) {
+				std::this_thread::yield();
+			}
+		}
+	}};
+
+	int value {};
+	for (int expected {0}; expected < count;) {
+		if (ring.try_pop(value)) {
+			ASSERT_EQ(expected, value);
+			++expected;
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+
+	producer.join();
+	EXPECT_FALSE(ring.try_pop(value));
+}
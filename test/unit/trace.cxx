@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <set>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#define ENABLE_METRICS 1
+#include <log_sink.hxx>  // for thread_id
+#include <metrics.hxx>
+#include <trace.hxx>
+#undef ENABLE_METRICS
+
+using namespace project;
+
+namespace {
+auto written() -> std::string
+{
+	std::FILE* file {std::tmpfile()};
+	trace::write(file);
+
+	std::string text(1 << 20, '\0');
+	std::rewind(file);
+	text.resize(std::fread(text.data(), 1, text.size(), file));
+	std::fclose(file);
+	return text;
+}
+
+auto occurrences(std::string const& text, std::string const& part) -> std::size_t
+{
+	std::size_t count {0};
+	for (auto at {text.find(part)}; at != std::string::npos; at = text.find(part, at + 1)) {
+		++count;
+	}
+	return count;
+}
+}  // namespace
+
+class Trace : public ::testing::Test
+{
+protected:
+	void TearDown() override
+	{
+		trace::stop();
+	}
+};
+
+TEST_F(Trace, writes_scopes)
+{
+	trace::start();
+	{
+		trace::Scope const outer {"outer"};
+		trace::Scope const inner {"in \"quotes\""};
+	}
+	trace::stop();
+
+	auto const text {written()};
+	ASSERT_EQ(0u, text.find(R"({"displayTimeUnit":"ns","traceEvents":[)"));
+	ASSERT_EQ("\n]}\n", text.substr(text.size() - 4));
+	ASSERT_EQ(1u, occurrences(text, R"({"name":"outer","ph":"X","ts":)"));
+	ASSERT_EQ(1u, occurrences(text, R"({"name":"in \"quotes\"","ph":"X","ts":)"));
+	ASSERT_EQ(2u, occurrences(text, fmt::format(R"("tid":{}}})", log::detail::thread_id())));
+}
+
+TEST_F(Trace, records_only_while_tracing)
+{
+	{
+		trace::Scope const before {"before"};
+	}
+	trace::start();
+	{
+		trace::Scope const during {"during"};
+	}
+	trace::stop();
+	{
+		trace::Scope const after {"after"};
+	}
+
+	auto const text {written()};
+	ASSERT_EQ(1u, occurrences(text, R"("name":"during")"));
+	ASSERT_EQ(0u, occurrences(text, R"("name":"before")"));
+	ASSERT_EQ(0u, occurrences(text, R"("name":"after")"));
+}
+
+TEST_F(Trace, start_discards)
+{
+	trace::start();
+	{
+		trace::Scope const first {"first"};
+	}
+	trace::start();
+	{
+		trace::Scope const second {"second"};
+	}
+
+	auto const text {written()};
+	ASSERT_EQ(0u, occurrences(text, R"("name":"first")"));
+	ASSERT_EQ(1u, occurrences(text, R"("name":"second")"));
+}
+
+TEST_F(Trace, one_track_per_thread)
+{
+	trace::start();
+
+	std::vector<std::thread> threads;
+	for (int t {0}; t < 4; ++t) {
+		threads.emplace_back([] {
+			for (int i {0}; i < 10; ++i) {
+				trace::Scope const scope {"work"};
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	// Written after the threads exit.
+	auto const text {written()};
+	ASSERT_EQ(40u, occurrences(text, R"("name":"work")"));
+
+	std::set<std::string> tracks;
+	for (auto at {text.find(R"("tid":)")}; at != std::string::npos; at = text.find(R"("tid":)", at + 1)) {
+		tracks.insert(text.substr(at, text.find('}', at) - at));
+	}
+	ASSERT_EQ(5u, tracks.size());  // the threads, and tid 0 naming the process
+}
+
+TEST_F(Trace, drops_when_full)
+{
+	trace::start(4);
+	for (int i {0}; i < 10; ++i) {
+		trace::Scope const scope {"scope"};
+	}
+
+	ASSERT_EQ(6u, trace::dropped());
+	ASSERT_EQ(4u, occurrences(written(), R"("name":"scope")"));
+}
+
+TEST_F(Trace, includes_metrics_spans)
+{
+	trace::start();
+	{
+		PROJECT_METRICS_SPAN("trace.span");
+		PROJECT_TRACE_SCOPE("trace.scope");
+	}
+
+	auto const text {written()};
+	ASSERT_EQ(1u, occurrences(text, R"("name":"trace.span")"));
+	ASSERT_EQ(1u, occurrences(text, R"("name":"trace.scope")"));
+}
+
+TEST_F(Trace, write_fails)
+{
+	ASSERT_THROW(trace::write(std::string {"/nonexistent/trace.json"}), std::system_error);
+}
@@ -0,0 +1,107 @@
+#include <cstdio>
+#include <stdexcept>
+#include <string_view>
+
+#ifdef _WIN32
+#include <fcntl.h>  // for _O_BINARY
+#include <io.h>  // for _setmode
+#endif
+
+#include <log_binary.hxx>
+#include <log_compress.hxx>
+#include <log_pattern.hxx>
+
+namespace {
+void usage(char const* program)
+{
+	std::fprintf(stderr,
+	             "Usage: %s [--pattern PATTERN] [FILE]\n"
+	             "       %s --compressed [--follow] [FILE]\n"
+	             "Expand a binary or compressed log to text. Reads standard input by default.\n"
+	             "PATTERN lays out each line, e.g. \"{time} [{thread}] {level}: {message}\".\n"
+	             "--follow waits for more blocks at the end of the log, like tail -f.\n",
+	             program,
+	             program);
+}
+}  // namespace
+
+/** @brief Expand a binary log written by project::log::BinarySink, or a
+           compressed log written by project::log::CompressedSink, to text.
+
+    Usage: log-decode [--pattern PATTERN] [FILE]
+           log-decode --compressed [--follow] [FILE]
+
+    Reads standard input if no FILE is given. Writes text to standard output,
+    laid out by PATTERN (see project::log::set_pattern()); compressed logs
+    hold text already laid out. With --follow, waits at the end of the log for
+    more blocks until interrupted.
+    Exits with 1 if the log is damaged; records before the damage are still written.
+ */
+int main(int const argc, char const* argv[])
+{
+	char const* path {nullptr};
+	bool compressed {false};
+	bool follow {false};
+
+	for (int i {1}; i < argc; ++i) {
+		std::string_view const argument {argv[i]};
+
+		if (argument == "-h" || argument == "--help") {
+			usage(argv[0]);
+			return 0;
+		}
+		if (argument == "--pattern" && i + 1 < argc) {
+			try {
+				project::log::set_pattern(argv[++i]);
+			} catch (std::invalid_argument const& e) {
+				std::fprintf(stderr, "%s: %s\n", argv[0], e.what());
+				return 2;
+			}
+		}
+		else if (argument == "--compressed") {
+			compressed = true;
+		}
+		else if (argument == "--follow" || argument == "-f") {
+			follow = true;
+		}
+		else if (!path && argument.substr(0, 1) != "-") {
+			path = argv[i];
+		}
+		else {
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (follow && !compressed) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	std::FILE* in {stdin};
+
+	if (path) {
+		in = std::fopen(path, "rb");
+		if (!in) {
+			std::perror(path);
+			return 2;
+		}
+	}
+#ifdef _WIN32
+	else {
+		_setmode(_fileno(stdin), _O_BINARY);
+	}
+#endif
+
+	bool const ok {compressed ? project::log::decode_compressed(in, stdout, follow)
+	                          : project::log::decode_binary(in, stdout)};
+
+	if (in != stdin) {
+		std::fclose(in);
+	}
+	if (!ok) {
+		std::fprintf(stderr, "%s: not a %s log, or truncated\n", argv[0], compressed ? "compressed" : "binary");
+		return 1;
+	}
+	return 0;
+}
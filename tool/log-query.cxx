@@ -0,0 +1,209 @@
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>  // for std::strtoul
+#include <cstring>  // for std::strerror
+#include <ctime>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <log.hxx>
+#include <log_index.hxx>
+
+namespace {
+void usage(char const* program)
+{
+	std::fprintf(stderr,
+	             "Usage: %s [--since TIME] [--until TIME] [--level LEVEL] [--threads N] [--index FILE] [--stats]\n"
+	             "       LOG [TEXT]\n"
+	             "Write the lines of LOG which contain TEXT, using the index written alongside it by a FileSink.\n"
+	             "TIME is local time, \"YYYY-MM-DD HH:MM:SS[.ffffff]\"; --until includes the whole of TIME.\n"
+	             "LEVEL keeps lines at that and more-severe levels. N threads search, one per CPU by default.\n"
+	             "FILE is the index, \"LOG.idx\" by default; without one, the whole log is searched.\n"
+	             "--stats reports lines found, bytes searched and time taken on standard error.\n",
+	             program);
+}
+
+/// A file mapped read-only; empty if it could not be.
+struct Mapping
+{
+	explicit Mapping(char const* path)
+	{
+		int const fd {::open(path, O_RDONLY | O_CLOEXEC)};
+		if (fd < 0) {
+			return;
+		}
+		struct ::stat status {};
+		if (::fstat(fd, &status) == 0 && status.st_size > 0) {
+			size = static_cast<std::size_t>(status.st_size);
+			void* const address {::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)};
+			if (address != MAP_FAILED) {
+				data = static_cast<char const*>(address);
+			}
+		}
+		opened = true;
+		::close(fd);
+	}
+
+	~Mapping()
+	{
+		if (data) {
+			::munmap(const_cast<char*>(data), size);
+		}
+	}
+
+	Mapping(Mapping const&) = delete;
+	auto operator=(Mapping const&) -> Mapping& = delete;
+
+	auto view() const -> std::string_view
+	{
+		return data ? std::string_view {data, size} : std::string_view {};
+	}
+
+	char const* data {nullptr};
+	std::size_t size {0};
+	bool opened {false};
+};
+
+/// Parse local time "YYYY-MM-DD HH:MM:SS[.ffffff]" (or with a 'T') into nanoseconds since the epoch.
+auto parse_time(std::string_view const text, bool const until) -> std::optional<std::uint64_t>
+{
+	std::tm time {};
+	int consumed {0};
+	std::string const copy {text};
+
+	if (std::sscanf(copy.c_str(), "%d-%d-%d%*1[ T]%d:%d:%d%n", &time.tm_year, &time.tm_mon, &time.tm_mday,
+	                &time.tm_hour, &time.tm_min, &time.tm_sec, &consumed) != 6) {
+		return std::nullopt;
+	}
+	time.tm_year -= 1900;
+	time.tm_mon -= 1;
+	time.tm_isdst = -1;
+
+	auto const seconds {std::mktime(&time)};
+	if (seconds < 0) {
+		return std::nullopt;
+	}
+
+	std::uint64_t fraction {0};
+	std::uint64_t scale {1'000'000'000};
+	auto rest {text.substr(static_cast<std::size_t>(consumed))};
+
+	if (!rest.empty() && rest.front() == '.') {
+		rest.remove_prefix(1);
+		for (; !rest.empty() && rest.front() >= '0' && rest.front() <= '9' && scale > 1; rest.remove_prefix(1)) {
+			scale /= 10;
+			fraction += static_cast<std::uint64_t>(rest.front() - '0') * scale;
+		}
+	}
+	if (!rest.empty()) {
+		return std::nullopt;
+	}
+
+	return static_cast<std::uint64_t>(seconds) * 1'000'000'000 + fraction + (until ? scale - 1 : 0);
+}
+}  // namespace
+
+/** @brief Search a text log written by project::log::FileSink, narrowed by its index.
+
+    Usage: log-query [--since TIME] [--until TIME] [--level LEVEL] [--threads N]
+                     [--index FILE] [--stats] LOG [TEXT]
+
+    Maps the log and its index, skips the blocks which cannot match by time
+    or level, then searches the rest on several threads (see
+    project::log::search()). Lines are written in log order.
+    Exits with 1 if no line matched, or 2 on error, like grep.
+ */
+int main(int const argc, char const* argv[])
+{
+	using project::log::Query;
+
+	Query query;
+	char const* log_path {nullptr};
+	std::string index_path;
+	bool stats {false};
+
+	for (int i {1}; i < argc; ++i) {
+		std::string_view const argument {argv[i]};
+		bool const has_value {i + 1 < argc};
+
+		if (argument == "-h" || argument == "--help") {
+			usage(argv[0]);
+			return 0;
+		}
+		if ((argument == "--since" || argument == "--until") && has_value) {
+			auto const time {parse_time(argv[++i], argument == "--until")};
+			if (!time) {
+				std::fprintf(stderr, "%s: invalid time: %s\n", argv[0], argv[i]);
+				return 2;
+			}
+			(argument == "--since" ? query.since : query.until) = *time;
+		}
+		else if (argument == "--level" && has_value) {
+			auto const level {project::log::detail::parse_level(argv[++i])};
+			if (!level || *level == project::log::Level::None) {
+				std::fprintf(stderr, "%s: invalid level: %s\n", argv[0], argv[i]);
+				return 2;
+			}
+			query.level = *level;
+		}
+		else if (argument == "--threads" && has_value) {
+			query.threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (argument == "--index" && has_value) {
+			index_path = argv[++i];
+		}
+		else if (argument == "--stats") {
+			stats = true;
+		}
+		else if (argument.substr(0, 1) != "-" && !log_path) {
+			log_path = argv[i];
+		}
+		else if (argument.substr(0, 1) != "-" && query.text.empty()) {
+			query.text = argument;
+		}
+		else {
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (!log_path) {
+		usage(argv[0]);
+		return 2;
+	}
+	if (index_path.empty()) {
+		index_path = std::string {log_path} + ".idx";
+	}
+
+	auto const started {std::chrono::steady_clock::now()};
+
+	Mapping const log {log_path};
+	if (!log.opened) {
+		std::fprintf(stderr, "%s: %s: %s\n", argv[0], log_path, std::strerror(errno));
+		return 2;
+	}
+
+	Mapping const index {index_path.c_str()};
+	std::size_t count {0};
+	auto const* entries {project::log::index_entries(index.view(), count)};
+	if (index.opened && !entries) {
+		std::fprintf(stderr, "%s: %s is not a log index; searching the whole log\n", argv[0], index_path.c_str());
+	}
+
+	auto const found {project::log::search(log.view(), entries, entries ? count : 0, query, stdout)};
+
+	if (stats) {
+		auto const elapsed {std::chrono::duration<double, std::milli> {std::chrono::steady_clock::now() - started}};
+		std::fprintf(stderr, "%zu lines, %llu of %zu bytes searched, %.3f ms\n", found.lines,
+		             static_cast<unsigned long long>(found.scanned), log.size, elapsed.count());
+	}
+	return found.lines > 0 ? 0 : 1;
+}
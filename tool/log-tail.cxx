@@ -0,0 +1,127 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <fmt/format.h>
+
+#include <log_shm.hxx>
+
+namespace {
+void usage(char const* program)
+{
+	std::fprintf(stderr,
+	             "Usage: %s [--name NAME] [--output FILE] [--once]\n"
+	             "Copy the lines logged to a shared-memory ring to standard output, or append them to FILE.\n"
+	             "NAME is the ring's shared-memory object name, \"/project-log\" by default.\n"
+	             "--once stops when every line written so far has been read, instead of\n"
+	             "waiting for more until the writer goes away.\n",
+	             program);
+}
+
+auto write_all(fmt::memory_buffer& lines, std::FILE* out) -> bool
+{
+	bool const ok {std::fwrite(lines.data(), 1, lines.size(), out) == lines.size() && std::fflush(out) == 0};
+	lines.clear();
+	return ok;
+}
+}  // namespace
+
+/** @brief Copy the lines written by project::log::SharedMemorySink in another process.
+
+    Usage: log-tail [--name NAME] [--output FILE] [--once]
+
+    Starts at the oldest line still in the ring, then follows it until the
+    writer destroys the sink. Lines which were overwritten before they could be
+    copied are counted, and the count reported on standard error, never
+    written out partially.
+    Exits with 1 if any lines were lost.
+ */
+int main(int const argc, char const* argv[])
+{
+	using project::log::SharedMemoryReader;
+
+	std::string name {project::log::SharedMemoryOptions {}.name};
+	char const* path {nullptr};
+	bool once {false};
+
+	for (int i {1}; i < argc; ++i) {
+		std::string_view const argument {argv[i]};
+
+		if (argument == "-h" || argument == "--help") {
+			usage(argv[0]);
+			return 0;
+		}
+		if (argument == "--name" && i + 1 < argc) {
+			name = argv[++i];
+		}
+		else if (argument == "--output" && i + 1 < argc) {
+			path = argv[++i];
+		}
+		else if (argument == "--once") {
+			once = true;
+		}
+		else {
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	std::FILE* out {stdout};
+
+	if (path) {
+		out = std::fopen(path, "ab");
+		if (!out) {
+			std::perror(path);
+			return 2;
+		}
+	}
+
+	std::uint64_t reported {0};
+	int result {0};
+
+	try {
+		SharedMemoryReader reader {name};
+		fmt::memory_buffer lines;
+
+		for (;;) {
+			auto const status {reader.next(lines)};
+
+			if (reader.lost() != reported) {
+				std::fprintf(stderr, "%s: lost %llu lines\n", argv[0],
+				             static_cast<unsigned long long>(reader.lost() - reported));
+				reported = reader.lost();
+			}
+
+			if (status == SharedMemoryReader::Status::Line && lines.size() < 64 * 1024) {
+				continue;  // write in batches while there is more to read
+			}
+			if (!write_all(lines, out)) {
+				std::perror(path ? path : "stdout");
+				result = 2;
+				break;
+			}
+			if (status == SharedMemoryReader::Status::Closed
+			    || (status == SharedMemoryReader::Status::Empty && once)) {
+				break;
+			}
+			if (status == SharedMemoryReader::Status::Empty) {
+				std::this_thread::sleep_for(std::chrono::milliseconds {1});
+			}
+		}
+	} catch (std::runtime_error const& e) {  // cannot open the ring, or not a log ring
+		std::fprintf(stderr, "%s: %s\n", argv[0], e.what());
+		result = 2;
+	}
+
+	if (out != stdout) {
+		std::fclose(out);
+	}
+	if (result == 0 && reported > 0) {
+		result = 1;
+	}
+	return result;
+}
@@ -0,0 +1,50 @@
+set(source_dir "${CMAKE_CURRENT_LIST_DIR}")
+
+################
+#  log-decode  #
+################
+
+set(target "log-decode")
+
+add_executable(${target}
+	${source_dir}/log-decode.cxx
+)
+target_link_libraries(${target}
+	PRIVATE
+		project
+)
+
+###############
+#  log-query  #
+###############
+
+if(UNIX)
+	set(target "log-query")
+
+	add_executable(${target}
+		${source_dir}/log-query.cxx  # maps the log with mmap
+	)
+	target_link_libraries(${target}
+		PRIVATE
+			project
+	)
+endif()
+
+##############
+#  log-tail  #
+##############
+
+if(UNIX)
+	set(target "log-tail")
+
+	add_executable(${target}
+		${source_dir}/log-tail.cxx
+	)
+	target_link_libraries(${target}
+		PRIVATE
+			project
+	)
+endif()
+
+unset(source_dir)
+unset(target)